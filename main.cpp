@@ -6,17 +6,347 @@
 #include "CoreIncludes.hpp"
 #include "solver/CG.hpp"
 #include "solver/BiCGstab_l_.hpp"
+#include "solver/autotune.hpp"
 #include "mesh/mesh.hpp"
+#include "mesh/assembly.hpp"
+#include "mesh/boundary.hpp"
 #include "mesh/valueSource.hpp"
+#include "mesh/adaptive.hpp"
+#include "mesh/stencilOperator.hpp"
+#include "mesh/ordering.hpp"
+#include "transient/heat.hpp"
+#include "io/tiledFile.hpp"
+#include "io/sparseFile.hpp"
+#include "post/derivedFields.hpp"
+#include "service/server.hpp"
+#include "core/parallel.hpp"
+#include "core/profiler.hpp"
+#include "core/simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sched.h>
+#include <thread>
+
+
+/************************************************************************************************************************
+ * Solve -div(grad(u)) = f around a point source (a narrow Gaussian of unit mass), on an adaptive grid: every cycle solves
+ * on the current patches, and refines those with the largest error indicator, until the finest level is reached where
+ * needed. The uniform grid of the finest level would need ~17M unknowns.
+ ************************************************************************************************************************/
+static int adaptiveExample(){
+
+    const f64 width = 2e-3;                     /**< standard deviation of the source */
+    const f64 x0 = 0.3, y0 = 0.6;               /**< position of the source */
+    auto pointSource = [=](f64 x, f64 y){ return std::exp(-((x-x0)*(x-x0) + (y-y0)*(y-y0))/(2.*width*width))/(2.*EIGEN_PI*width*width); };
+    auto zero        = [](f64, f64){ return 0.; };
+
+    // Base grid of 4x4 patches of 16x16 cells, refined down to 6 levels (4096x4096 cells)
+    Mesh::gridStruct base;
+    base.x.setLinSpaced(65, 0., 1.);
+    base.y.setLinSpaced(65, 0., 1.);
+    Mesh::adaptiveGrid grid(base, zero, 16, 6);
+
+    Eigen::SparseMatrix<f64> A;
+    EigenDefs::Vector<f64>   u, b;
+    KrylovSolver::convergenceCriteria criteria;
+    criteria.relative    = 1e-8;
+    criteria.maxiter     = 20000;
+    criteria.replacement = 200;
+    for (u32 cycle=0; ; cycle++){
+        grid.assemble(pointSource, A, b);
+        u.setZero(grid.size());
+
+        // The coarse-fine interpolation makes A non-symmetric
+        KrylovSolver::BiCGstab<4> solver(A);
+        KrylovSolver::solveReport report = solver.solve(u, b, criteria);
+        INFO_MSG("AMR cycle %u: %u patches, depth %u, %u unknowns (%.2f%% of uniform), solve %s after %u iterations",
+                 cycle, grid.leaves(), grid.depth(), grid.size(), 100.*grid.size()/grid.uniformSize(),
+                 KrylovSolver::statusName(report.status), report.iterations);
+
+        if (grid.refine(grid.indicator(u), 0.1) == 0) break;
+    }
+
+    // Sampled onto a tensor grid for post.py
+    Mesh::gridStruct output;
+    output.x.setLinSpaced(513, 0., 1.);
+    output.y.setLinSpaced(513, 0., 1.);
+    std::vector<IO::namedField> fields(1);
+    fields[0].name = "u";
+    grid.sample(u, output, fields[0].values);
+    IO::writeTiles("data.bin", output, fields, IO::tileSettings{.codec = IO::CODEC_LOSSLESS});
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/************************************************************************************************************************
+ * Step du/dt = div(grad(u)) + f from a hot spot, with the boundary values of the steady problem, using Crank-Nicolson:
+ * the operator and its preconditioner are set up once, every step only runs CG from the extrapolated previous steps,
+ * and snapshots are written by the background thread of the exporter while the next steps run.
+ ************************************************************************************************************************/
+static int heatExample(){
+
+    // Declared first, such that it is destroyed last (after every snapshot is written)
+    IO::tileSettings tiles;
+    tiles.codec = IO::CODEC_LOSSLESS;
+    IO::asyncExport exporter(tiles);
+
+    const u32 imax = 257, jmax = 257;
+    Mesh::gridStruct grid;
+    grid.x.setLinSpaced(imax, 0., EIGEN_PI);
+    grid.y.setLinSpaced(jmax, 0., EIGEN_PI);
+    Mesh::boundaryStruct boundaries;
+    boundaries.North.setZero(imax);
+    boundaries.West = Eigen::sin(grid.y);
+    boundaries.South.setZero(imax);
+    boundaries.East.setZero(jmax);
+
+    Parallel::executionPolicy policy;
+    Transient::heatSettings settings;
+    settings.dt = 1e-3;
+    Transient::heatSolver heat(grid, boundaries, valueSource, settings, &policy);
+    heat.initial([](f64 x, f64 y){ return std::exp(-8.*((x-2.)*(x-2.) + (y-1.)*(y-1.))); });
+
+    const u32 nSteps = 400, every = 100;
+    u32 iterations = 0;
+    for (u32 s=1; s<=nSteps; s++){
+        KrylovSolver::solveReport report = heat.step();
+        iterations += report.iterations;
+        DEBUG_MSG("Step %u, t = %1.4e: %s after %u iterations", s, heat.time(), KrylovSolver::statusName(report.status), report.iterations);
+        if (s % every == 0){
+            char fileName[32];
+            snprintf(fileName, sizeof(fileName), "heat_%04u.bin", s/every);
+            heat.snapshot(exporter, fileName);
+            INFO_MSG("t = %1.4e: %u iterations per step on average, snapshot %s queued", heat.time(), iterations/every, fileName);
+            iterations = 0;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+
+/************************************************************************************************************************
+ * Number of distinct cpus the threads of a policy run on, asked from every thread itself: a policy built on a thread
+ * pinned by another one would stack all its threads on a single cpu, and the timings would say nothing about them.
+ ************************************************************************************************************************/
+static u32 distinctCpus(const Parallel::executionPolicy &policy){
+    std::vector<i32> cpus(policy.threads(), -1);
+    auto where = [&](u32 t){ cpus[t] = sched_getcpu(); };
+    policy.run(where);
+    std::sort(cpus.begin(), cpus.end());
+    return std::unique(cpus.begin(), cpus.end()) - cpus.begin();
+}
+
+
+
+/************************************************************************************************************************
+ * Compare the reduction modes of the execution policy: the time of a dot product in both modes over a range of sizes,
+ * then CG solves of one system (files A.bin b.bin written by --save-system when given, 401x401 gridpoints otherwise)
+ * on 1, 2, 4, ... threads, checking in which mode the solution is bitwise the same for every thread count.
+ ************************************************************************************************************************/
+static int reductionBenchmark(int argc, char* argv[]){
+    using clock = std::chrono::steady_clock;
+    const Parallel::reductionMode modes[2] = {Parallel::REDUCTION_FAST, Parallel::REDUCTION_DETERMINISTIC};
+    const char* names[2] = {"fast", "deterministic"};
+
+    // Dot products, repeated over about 2^26 rows per size and mode
+    {
+        Parallel::executionPolicy policy;
+        const u32 cpus = distinctCpus(policy);
+        if (cpus < policy.threads()) WARN_MSG("The %u thread(s) of the policy share %u cpu(s)", policy.threads(), cpus);
+        INFO_MSG("Dot products on %u thread(s): %-10s %14s %14s %8s %s", policy.threads(), "rows", "fast [ns/row]",
+                 "determ. [ns/row]", "ratio", "|difference|");
+        for (u64 n=1ull << 12; n<=(1ull << 24); n*=4){
+            std::unique_ptr<f64[]> x(new f64[n]), y(new f64[n]);
+            policy.firstTouch(x.get(), n);
+            policy.firstTouch(y.get(), n);
+            for (u64 i=0; i<n; i++) { x[i] = std::sin(0.1*i); y[i] = std::cos(0.3*i); }
+            const u64 repeats = std::max<u64>(1, (1ull << 26)/n);
+            f64 seconds[2], result[2];
+            for (u32 m=0; m<2; m++){
+                policy.reduction(modes[m]);
+                result[m] = policy.dot(x.get(), y.get(), n);
+                const clock::time_point start = clock::now();
+                for (u64 r=0; r<repeats; r++) result[m] = policy.dot(x.get(), y.get(), n);
+                seconds[m] = std::chrono::duration<f64>(clock::now() - start).count();
+            }
+            INFO_MSG("Dot products on %u thread(s): %-10llu %14.4f %14.4f %8.3f %1.3e", policy.threads(), n,
+                     1e9*seconds[0]/(repeats*n), 1e9*seconds[1]/(repeats*n), seconds[1]/seconds[0], std::abs(result[1] - result[0]));
+        }
+    }
+
+    // The system, mapped from the files of --save-system, or assembled
+    Eigen::SparseMatrix<f64> A;
+    EigenDefs::Vector<f64>   b;
+    if (argc > 3){
+        IO::mappedFile matrix, vector;
+        if (!matrix.open(argv[2]) || !vector.open(argv[3]) || !matrix.isMatrix() || matrix.isRowMajor() || !vector.isVector()){
+            ERROR_MSG("Usage: --reductions [A.bin b.bin], a column-major matrix and a vector as written by --save-system");
+            return EXIT_FAILURE;
+        }
+        A = matrix.matrix();
+        b = vector.vector();
+    } else {
+        const u32 imax = 401, jmax = 401;
+        Mesh::gridStruct grid;
+        grid.x.setLinSpaced(imax, 0., EIGEN_PI);
+        grid.y.setLinSpaced(jmax, 0., EIGEN_PI);
+        Mesh::boundaryStruct boundaries;
+        boundaries.North.setZero(imax);
+        boundaries.West = Eigen::sin(grid.y);
+        boundaries.South.setZero(imax);
+        boundaries.East.setZero(jmax);
+        const u32 n = Mesh::dofs(grid, boundaries).size();
+        A.resize(n, n);
+        b.resize(n);
+        Mesh::assemblePoisson(grid, boundaries, valueSource, A, b);
+    }
+    const u32 n = A.cols();
+
+    // CG on 1, 2, 4, ... threads (at least 2, oversubscribed on a single cpu), the solution compared to that of 1 thread
+    KrylovSolver::convergenceCriteria criteria;
+    criteria.relative         = 1e-10;
+    criteria.maxiter          = 20000;
+    criteria.stagnationWindow = 0;
+    std::vector<u32> counts;
+    const u32 available = std::max(2u, std::thread::hardware_concurrency());
+    for (u32 threads=1; threads<available; threads*=2) counts.push_back(threads);
+    counts.push_back(available);
+    EigenDefs::Vector<f64> u(n), reference[2];
+    for (u32 threads : counts){
+        for (u32 m=0; m<2; m++){
+            Parallel::executionPolicy policy(threads);
+            policy.reduction(modes[m]);
+            const u32 cpus = distinctCpus(policy);
+            if (cpus < std::min(threads, std::thread::hardware_concurrency()))
+                WARN_MSG("The %u thread(s) of the policy share %u cpu(s), fewer than available", threads, cpus);
+            Workspace::arena work(KrylovSolver::CG::workspaceBytes(n), &policy);
+            KrylovSolver::CG solver(A, work);
+            u.setZero();
+            const logLevel level = logGetLevel();
+            logSetLevel(LOG_LEVEL_WARN);
+            const clock::time_point start = clock::now();
+            KrylovSolver::solveReport report = solver.solve(u, b, criteria);
+            const f64 seconds = std::chrono::duration<f64>(clock::now() - start).count();
+            logSetLevel(level);
+
+            if (threads == 1) reference[m] = u;
+            const bool identical = std::memcmp(u.data(), reference[m].data(), n*sizeof(f64)) == 0;
+            INFO_MSG("CG on %2u thread(s), %-13s reductions: %u iterations in %.3f s, err = %1.4e, %s",
+                     threads, names[m], report.iterations, seconds, report.residual,
+                     identical ? "bitwise identical to 1 thread" : "differs from 1 thread");
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+
+/************************************************************************************************************************
+ * Check of the exact spectrum of A on uniform Dirichlet grids (Preconditioner::analyticBounds), for both stencils: the
+ * interval needs to hold the extreme eigenvalues CG estimates (and be close to them), Chebyshev iteration on it needs
+ * to converge, and CG preconditioned by the Chebyshev polynomial on its upper end needs fewer iterations than CG.
+ ************************************************************************************************************************/
+static int chebyshevCheck(){
+    const u32 imax = 97, jmax = 65;
+    KrylovSolver::convergenceCriteria criteria;
+    criteria.relative = 1e-10;
+    criteria.maxiter  = 5000;
+
+    bool passed = true;
+    for (Mesh::stencilType stencil : {Mesh::STENCIL_5POINT, Mesh::STENCIL_MEHRSTELLEN}){
+        const char* label = stencil == Mesh::STENCIL_MEHRSTELLEN ? "Mehrstellen" : "5-point";
+        Mesh::gridStruct grid;
+        grid.x.setLinSpaced(imax, 0., EIGEN_PI);
+        grid.y.setLinSpaced(jmax, 0., 2.);
+        Mesh::boundaryStruct boundaries;
+        boundaries.North.setZero(imax);
+        boundaries.West = Eigen::sin(grid.y);
+        boundaries.South.setZero(imax);
+        boundaries.East.setZero(jmax);
+        const u32 n = Mesh::dofs(grid, boundaries).size();
+        Eigen::SparseMatrix<f64> A(n, n);
+        EigenDefs::Vector<f64>   u(n), b(n);
+        Mesh::assemblePoisson(grid, boundaries, valueSource, A, b, stencil);
+        const Mesh::discretizationStruct problem{&grid, &boundaries, stencil};
+
+        f64 lower, upper;
+        if (!Preconditioner::analyticBounds(grid, boundaries, stencil, lower, upper)){
+            ERROR_MSG("Chebyshev check, %s: no spectrum for a uniform Dirichlet grid", label);
+            passed = false;
+            continue;
+        }
+
+        // CG, then Chebyshev iteration and CG + Chebyshev on the exact spectrum, as the autotuner runs them
+        const Autotune::configuration configs[3] = {{Autotune::SOLVER_CG,        Preconditioner::PRECONDITIONER_NONE},
+                                                    {Autotune::SOLVER_CHEBYSHEV, Preconditioner::PRECONDITIONER_NONE},
+                                                    {Autotune::SOLVER_CG,        Preconditioner::PRECONDITIONER_CHEBYSHEV}};
+        KrylovSolver::solveReport reports[3];
+        for (u32 k=0; k<3; k++){
+            Workspace::arena work(Autotune::workspaceBytes(configs[k], n));
+            u.setZero();
+            const logLevel level = logGetLevel();
+            logSetLevel(LOG_LEVEL_WARN);
+            reports[k] = Autotune::solve(configs[k], A, u, b, criteria, work, nullptr, nullptr, &problem);
+            logSetLevel(level);
+        }
+
+        // The Ritz values lie inside the spectrum, and reach its ends after a few hundred iterations
+        const KrylovSolver::spectrumEstimate &ritz = reports[0].spectrum;
+        const bool holds = ritz.lambdaMin >= lower*(1. - 1e-8) && ritz.lambdaMax <= upper*(1. + 1e-8) &&
+                           ritz.lambdaMin <= lower*1.01 && ritz.lambdaMax >= upper*0.99;
+        const bool solved = reports[1].status == KrylovSolver::SOLVE_CONVERGED &&
+                            reports[2].status == KrylovSolver::SOLVE_CONVERGED &&
+                            reports[2].iterations < reports[0].iterations;
+        INFO_MSG("Chebyshev check, %s: spectrum [%1.6e, %1.6e], CG estimate [%1.6e, %1.6e], %s", label, lower, upper,
+                 ritz.lambdaMin, ritz.lambdaMax, holds ? "passed" : "FAILED");
+        INFO_MSG("Chebyshev check, %s: iterations cg %u, chebyshev %u (%s), cg+chebyshev %u (%s), %s", label,
+                 reports[0].iterations, reports[1].iterations, KrylovSolver::statusName(reports[1].status),
+                 reports[2].iterations, KrylovSolver::statusName(reports[2].status), solved ? "passed" : "FAILED");
+        passed = passed && holds && solved;
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 
-#include <vector>
-#include <fstream>
-#include <iostream>
 
 /************************************************************************************************************************
  * Solve -div(grad(u)) = f, using FDM
  ************************************************************************************************************************/
-int main(){
+int main(int argc, char* argv[]){
+
+    // --isa <name> pins the SIMD kernels (sse2, avx2, avx512) instead of the widest the cpu supports, in every mode
+    for (i32 k=1; k<argc; k++){
+        Simd::isaLevel level;
+        if (std::strcmp(argv[k], "--isa") != 0) continue;
+        if (k+1 < argc && Simd::isaFromName(argv[k+1], level)) Simd::force(level);
+        else WARN_MSG("--isa needs one of sse2, avx2, avx512, ignored");
+    }
+
+    // Self-check mode: every SIMD variant of the kernels this cpu supports against the generic one
+    for (i32 k=1; k<argc; k++){
+        if (std::strcmp(argv[k], "--simd-check") == 0) return Simd::selfCheck() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Self-check mode: the exact spectrum of A, and Chebyshev iteration (and preconditioning) on it
+    if (argc > 1 && std::strcmp(argv[1], "--chebyshev-check") == 0) return chebyshevCheck();
+
+    // Server mode: stay resident and solve the problems received over stdin or a Unix domain socket
+    if (Service::requested(argc, argv)) return Service::run(argc, argv);
+
+    // Adaptive mode: a point source on a quadtree of patches, instead of the uniform grid below
+    if (argc > 1 && std::strcmp(argv[1], "--amr") == 0) return adaptiveExample();
+
+    // Transient mode: the heat equation, stepped on the operator of the uniform grid below
+    if (argc > 1 && std::strcmp(argv[1], "--heat") == 0) return heatExample();
+
+    // Benchmark mode: the cost of the deterministic reductions, and whether they reproduce a solve on any thread count
+    if (argc > 1 && std::strcmp(argv[1], "--reductions") == 0) return reductionBenchmark(argc, argv);
 
     //## ================== ##//
     //## Provide parameters ##//
@@ -26,10 +356,15 @@ int main(){
     const f64 Lx[2] = {0., 1.*EIGEN_PI}; /**< domain endpoints in x */
     const f64 Ly[2] = {0., 1.*EIGEN_PI}; /**< domain endpoints in y */
 
-    //## ==================== ##//
-    //## Calculate parameters ##//
-    //## ==================== ##//
-    const u32 n = (imax-2)*(jmax-2);     /**< sparse matrix size component (n,n), boundaries excluded */
+    // 2nd-order 5-point stencil. The 4th-order Mehrstellen stencil (Mesh::STENCIL_MEHRSTELLEN, uniform grids with 
+    // Dirichlet/periodic faces) reaches the same error with far fewer gridpoints
+    const Mesh::stencilType stencil = Mesh::STENCIL_5POINT;
+
+    // Solution export, losslessly compressed (shuffle + deflate of the f32 output). Declared first, such that it is
+    // destroyed last: everything else is torn down while its background thread writes the file
+    IO::tileSettings tiles;
+    tiles.codec = IO::CODEC_LOSSLESS;
+    IO::asyncExport exporter(tiles);
 
     //## ============= ##//
     //## Problem Setup ##//
@@ -39,246 +374,126 @@ int main(){
     grid.x.setLinSpaced(imax, Lx[0], Lx[1]);
     grid.y.setLinSpaced(jmax, Ly[0], Ly[1]);
 
-    // Declare and initialise boundary condition list
+    // Declare and initialise boundary condition list (Dirichlet, unless a face sets e.g. boundaries.NorthBC.type = Mesh::BC_NEUMANN)
     Mesh::boundaryStruct boundaries;
     boundaries.North.setZero(imax);
     boundaries.West = Eigen::sin(grid.y);
     boundaries.South.setZero(imax);
     boundaries.East.setZero(jmax);
 
+    //## ==================== ##//
+    //## Calculate parameters ##//
+    //## ==================== ##//
+    const u32 n = Mesh::dofs(grid, boundaries).size(); /**< sparse matrix size component (n,n), known boundaries excluded */
+
     // Declare problem matrices and vectors to solve: Au = b
     Eigen::SparseMatrix<f64> A(n, n); /**< Sparse weights matrix */
     EigenDefs::Vector<f64>   u(n);    /**< Solution vector */
     EigenDefs::Vector<f64>   b(n);    /**< Forcing vector */
-    b.setZero();
-    
-    // Fill out sparse matrix using a list of triplets (i,j,value)
-    // Internal
-    std::vector<  Eigen::Triplet<f64>  > coefficients; /**< List of triplets to fill out sparse matrix with */
-    for (u32 j=2; j<jmax-2; j++){
-        for (u32 i=2; i<imax-2; i++){
-            // Calculate internal matrix internal index relative to grid position
-            u32 jj = j-1;
-            u32 ii = i-1;
-            u32 iimax = imax-2;
-
-            // Calculate grid spacing necessary from full grid
-            f64 dx1 = grid.x[i]   - grid.x[i-1];
-            f64 dx2 = grid.x[i+1] - grid.x[i];
-            f64 dy1 = grid.y[j]   - grid.y[j-1];
-            f64 dy2 = grid.y[j+1] - grid.y[j];
-
-            // We consider BCs in the sparse matrix problem, fill general pattern in A matrix.
-            const u32 idx = jj*iimax + ii;
-            u32 idx1;
-            idx1 = (jj-1)*iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dy1*(dy1+dy2) ))  );
-            idx1 = (jj)  *iimax + (ii-1); coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dx1*(dx1+dx2) ))  );
-            idx1 = (jj)  *iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1,  2./(dx1*dx2)+2./(dy1*dy2))  );
-            idx1 = (jj)  *iimax + (ii+1); coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dx2*(dx1+dx2) ))  );
-            idx1 = (jj+1)*iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dy2*(dy1+dy2) ))  );
-            
-            // Fill source term in b vector.
-            b[idx] = valueSource(grid.x[i], grid.y[j]);
-        }
-    }
-    // South Boundary
-    u32 j=1;
-    for (u32 i=1; i<imax-1; i++){
-        // Calculate internal matrix internal index relative to grid position
-        u32 jj = j-1;
-        u32 ii = i-1;
-        u32 iimax = imax-2;
-
-        // Calculate grid spacing necessary from full grid
-        f64 dy1 = grid.y[j]   - grid.y[j-1];
-        f64 dy2 = grid.y[j+1] - grid.y[j];
-
-        const u32 idx = jj*iimax + ii;
-        u32 idx1;
-        idx1 = (jj-1)*iimax + (ii)  ; b[idx] -= -2./( dy1*(dy1+dy2) ) * boundaries.South[i];
-        idx1 = (jj)  *iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1,  2./(dy1*dy2)        )  );
-        idx1 = (jj+1)*iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dy2*(dy1+dy2) ))  );
-    
-        // b[idx] += valueSource(grid.x[i], grid.y[j]);
-    }
-    // North Boundary
-    j=jmax-2;
-    for (u32 i=1; i<imax-1; i++){
-        // Calculate internal matrix internal index relative to grid position
-        u32 jj = j-1;
-        u32 ii = i-1;
-        u32 iimax = imax-2;
-
-        // Calculate grid spacing necessary from full grid
-        f64 dy1 = grid.y[j]   - grid.y[j-1];
-        f64 dy2 = grid.y[j+1] - grid.y[j];
-
-        const u32 idx = jj*iimax + ii;
-        u32 idx1;
-        idx1 = (jj-1)*iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dy1*(dy1+dy2) ))  );
-        idx1 = (jj)  *iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1,  2./(dy1*dy2)        )  );
-        idx1 = (jj+1)*iimax + (ii)  ; b[idx] -= -2./( dy2*(dy1+dy2) ) * boundaries.South[i];
-        
-        // b[idx] += valueSource(grid.x[i], grid.y[j]);
-    }
-    // West Boundary
-    i64 i=1;
-    for (u32 j=1; j<jmax-1; j++){
-        // Calculate internal matrix internal index relative to grid position
-        u32 jj = j-1;
-        u32 ii = i-1;
-        u32 iimax = imax-2;
-
-        // Calculate grid spacing necessary from full grid
-        f64 dx1 = grid.x[i]   - grid.x[i-1];
-        f64 dx2 = grid.x[i+1] - grid.x[i];
-
-        const u32 idx = jj*iimax + ii;
-        u32 idx1;
-        idx1 = (jj)  *iimax + (ii-1); b[idx] -= -2./( dx1*(dx1+dx2) ) * boundaries.West[j];
-        idx1 = (jj)  *iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1,  2./(dx1*dx2)        )  );
-        idx1 = (jj)  *iimax + (ii+1); coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dx2*(dx1+dx2) ))  );
-    
-        // b[idx] += valueSource(grid.x[i], grid.y[j]);
-    }
-    // East Boundary
-    i=imax-2;
-    for (u32 j=1; j<jmax-1; j++){
-        // Calculate internal matrix internal index relative to grid position
-        u32 jj = j-1;
-        u32 ii = i-1;
-        u32 iimax = imax-2;
-
-        // Calculate grid spacing necessary from full grid
-        f64 dx1 = grid.x[i]   - grid.x[i-1];
-        f64 dx2 = grid.x[i+1] - grid.x[i];
-
-        const u32 idx = jj*iimax + ii;
-        u32 idx1;
-        idx1 = (jj)  *iimax + (ii-1); coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1, -2./( dx1*(dx1+dx2) ))  );
-        idx1 = (jj)  *iimax + (ii)  ; coefficients.push_back(  Eigen::Triplet<f64>(idx,idx1,  2./(dx1*dx2)        )  );
-        idx1 = (jj)  *iimax + (ii+1); b[idx] -= -2./( dx2*(dx1+dx2) ) * boundaries.East[j];
-        
-        // b[idx] += valueSource(grid.x[i], grid.y[j]);
-    }
-    // Fill out sparse matrix
-    A.setFromTriplets(coefficients.begin(), coefficients.end());
 
-    INFO_MSG("Matrix-Vector setup finished");
+    // Fill out sparse matrix and forcing vector
+    Mesh::assemblePoisson(grid, boundaries, valueSource, A, b, stencil);
 
-    //## ================ ##//
-    //## Solution Routine ##//
-    //## ================ ##//
-    // Initialization    
-    const u8 l = 8;
-    u32 kappa;          /**< iterate number*/
-    u32 kappaMax = 5000;    /**< max iterate allowed */
-    f64 tol = 1e-15;        /**< acceptable tolerance */
-    f64 err = 1/0.0;        /**< residual error */
-
-
-    EigenDefs::Vector<f64> &hx0 = u;
-    EigenDefs::Vector<f64> rk(n);            /**< residual vector */
-    std::vector< EigenDefs::Vector<f64> > hu(l+1);
-    std::vector< EigenDefs::Vector<f64> > hr(l+1);
+    INFO_MSG("Matrix-Vector setup finished");
 
-    EigenDefs::Vector<f64> tr0(n);
-    
-    f64 alpha, beta, omega;                              /**< update coefficients */
-    f64 rho0, rho1;
-    f64 tau[l+1][l+1];  // ignore index 0, hence the +1;
-    f64 sigma[l+1];     // ignore index 0;
-    f64 gam;
-    f64 gamma[l+1];
-    f64 gammap[l+1];
-    f64 gammapp[l+1];
-
-
-
-    rk = b - A*u;
-    kappa=-l;
-    tr0 = rk;
-    for (u8 i=0; i<=l; i++){
-        hu[i].setZero(n);
-        hr[i].setZero(n);
+    // --ordering <natural|rcm|nd|multicolour> renumbers the unknowns of the incomplete Cholesky factor and of the sparse
+    // LU (overriding the ordering of the autotuned configuration), and of the exported system
+    bool ordered = false;
+    Mesh::orderingType orderingType = Mesh::ORDERING_NATURAL;
+    for (i32 k=1; k<argc; k++){
+        if (std::strcmp(argv[k], "--ordering") != 0) continue;
+        ordered = k+1 < argc && Mesh::orderingFromName(argv[k+1], orderingType);
+        if (!ordered) WARN_MSG("--ordering needs one of natural, rcm, nd, multicolour, ignored");
     }
-    hr[0] = b - A*u;
-    rho0 = 1.;
-    alpha = 0.;
-    omega = 1.;
-
-do {
-    kappa += l;
-    rho0 = -omega*rho0;
-    
-    //## ---- ##//
-    //## BiCG ##//
-    //## ---- ##//
-    for (u8 j=0; j<=l-1; j++){
-        rho1 = hr[j].dot(tr0);
-        beta = alpha * rho1/rho0;
-        rho0 = rho1;
-        for (u8 i=0; i<=j; i++){
-            hu[i] = hr[i] - beta*hu[i];
-        }
-        hu[j+1] = A*hu[j];
-        gam = hu[j+1].dot(tr0);
-        alpha = rho0/gam;
-        for (u8 i=0; i<=j; i++){
-            hr[i] = hr[i] - alpha*hu[i+1];
-        }
-        hr[j+1] = A*hr[j];
-        hx0 = hx0 + alpha*hu[0];
+    Mesh::ordering order;
+    Eigen::SparseMatrix<f64> PA;  /**< A renumbered, for the export (and the statistics) only */
+    EigenDefs::Vector<f64>   pb;  /**< b renumbered */
+    if (ordered && orderingType != Mesh::ORDERING_NATURAL){
+        order = Mesh::makeOrdering(A, orderingType);
+        Mesh::assemblePoisson(grid, boundaries, valueSource, PA, pb, stencil, &order);
+        const Mesh::orderingStatistics before = Mesh::statistics(A), after = Mesh::statistics(PA);
+        INFO_MSG("Ordering %s: bandwidth %llu -> %llu, profile %llu -> %llu, Cholesky fill %llu -> %llu",
+                 Mesh::orderingName(orderingType), before.bandwidth, after.bandwidth, before.profile, after.profile,
+                 before.fill, after.fill);
     }
-        
-    //## ------- ##//
-    //## mod.G-S ##//
-    //## ------- ##//
-    sigma[1] = hr[1].dot(hr[1]);
-    gammap[1] = 1/sigma[1] * hr[0].dot(hr[1]);
-    for (u8 j=2; j<=l; j++){
-        for (u8 i=1; i<=j-1; i++){
-            tau[i][j] = 1/sigma[i] * hr[j].dot(hr[i]);
-            hr[j] = hr[j] - tau[i][j]*hr[i];
+    const Eigen::SparseMatrix<f64> &exportA = order.natural() ? A : PA;
+    const EigenDefs::Vector<f64>   &exportb = order.natural() ? b : pb;
+
+    // Export of the system, for other solvers: --save-system maps back (IO::mappedFile), --save-mtx reads anywhere. A
+    // solution of a renumbered system goes back onto the grid with Mesh::scatterSolution(..., &order)
+    for (i32 k=1; k<argc; k++){
+        if (std::strcmp(argv[k], "--save-system") == 0 && IO::writeSparse("A.bin", exportA) && IO::writeVector("b.bin", exportb)){
+            INFO_MSG("System written to A.bin, b.bin");
+        }
+        if (std::strcmp(argv[k], "--save-mtx") == 0 && IO::writeMatrixMarket("A.mtx", exportA, true) && IO::writeMatrixMarket("b.mtx", exportb)){
+            INFO_MSG("System written to A.mtx, b.mtx");
         }
-        sigma[j] = hr[j].dot(hr[j]);
-        gammap[j] = 1/sigma[j] * hr[0].dot(hr[j]); 
     }
 
-    gamma[l] = gammap[l];
-    omega = gamma[l];
+    //## ============= ##//
+    //## Initial guess ##//
+    //## ============= ##//
+    // A single solve has no previous solution to start from, hence u0 = 0. Warm starts (InitialGuess::solutionCache)
+    // belong to the callers solving one problem after the other, such as the server
+    u.setZero();
 
-    for (u8 j=l-1; j>=1; j--){
-        f64 sum = 0;
-        for (u8 i=j+1; i<=l; i++) sum += tau[j][i]*gamma[i];
-        gamma[j] = gammap[j] - sum;
+    //## ================ ##//
+    //## Solution Routine ##//
+    //## ================ ##//
+    // Stop once the algebraic error drowns in the truncation error of the stencil, or when the residual stagnates 
+    // (1e-15 is below what round-off allows on fine grids); the true residual replaces the recursive one every 200 iterations.
+    // The residual of CG can hover for about as many iterations as there are gridpoints across the grid before it drops
+    // again, which is not a stagnation, hence the window spans at least that many
+    KrylovSolver::convergenceCriteria criteria;
+    criteria.absolute         = 1e-15;
+    criteria.discretization   = KrylovSolver::discretizationTolerance(grid, boundaries, valueSource, 0.1, stencil);
+    criteria.maxiter          = 5000;
+    criteria.replacement      = 200;
+    criteria.stagnationWindow = std::max({criteria.stagnationWindow, imax, jmax});
+
+    // The solver (and its preconditioner) is looked up in autotune.db by the signature of the problem, or picked from
+    // timed trial runs and stored there the first time such a problem is seen. Its internal vectors live in one arena,
+    // first-touched by the pinned threads of the policy, following the row partition of the threaded (CG) products.
+    // CG multiplies with the stencil specialised for the grid rather than with A, when one covers its faces. With
+    // --deterministic, the dot products give bitwise the same solution on any number of threads (see --reductions)
+    Parallel::executionPolicy policy;
+    for (i32 k=1; k<argc; k++){
+        if (std::strcmp(argv[k], "--deterministic") == 0) policy.reduction(Parallel::REDUCTION_DETERMINISTIC);
     }
-    for (u8 j=1; j<=l-1; j++){
-        f64 sum = 0;
-        for (u8 i=j+1; i<=l-1; i++) sum += tau[j][i]*gamma[i+1];
-        gammapp[j] = gamma[j+1] + sum;
+    // Chebyshev iteration (and the Chebyshev preconditioner) take the spectrum of A from the discretization
+    std::unique_ptr<Mesh::linearOperator> op = Mesh::makeOperator(grid, boundaries, stencil);
+    const Mesh::discretizationStruct problem{&grid, &boundaries, stencil};
+    Autotune::autotuner       tuner("autotune.db", &policy);
+    Autotune::configuration   config = tuner.select(Autotune::signature(grid, boundaries, stencil, policy.threads()),
+                                                    A, b, criteria, Mesh::isSingular(boundaries), op.get(), &problem);
+    if (ordered && (config.preconditioner == Preconditioner::PRECONDITIONER_IC || config.solver == Autotune::SOLVER_SPARSE_LU)){
+        config.ordering = orderingType;
     }
-
-    //## ------ ##//
-    //## update ##//
-    //## ------ ##//
-    hx0 = hx0 + gamma[1]*hr[0];
-    hr[0] = hr[0] - gammap[l]*hr[l];
-    hu[0] = hu[0] - gamma[l]*hu[l];
-
-    for (u8 j=1; j<=l-1; j++){
-        hu[0] = hu[0] - gamma[j]*hu[j];
-        hx0 = hx0 + gammapp[j]*hr[j];
-        hr[0] = hr[0] - gammap[j]*hr[j];
+    else if (ordered) INFO_MSG("Ordering %s ignored, %s does not factorise A", Mesh::orderingName(orderingType), Autotune::name(config).c_str());
+    Workspace::arena work(Autotune::workspaceBytes(config, n), &policy);
+
+    // --profile counts the kernels of CG (with the hardware counters, where the kernel allows it), and places them on
+    // the roofline of the machine once solved
+    bool profiling = false;
+    for (i32 k=1; k<argc; k++) profiling = profiling || std::strcmp(argv[k], "--profile") == 0;
+    std::unique_ptr<Profiling::profiler> profiler;
+    if (profiling) profiler = std::make_unique<Profiling::profiler>(&policy);
+
+    const f64 r0 = std::sqrt(b.squaredNorm()/n); /**< RMS of the initial residual, b for u0 = 0 */
+    KrylovSolver::solveReport report = Autotune::solve(config, A, u, b, criteria, work, op.get(), profiler.get(), &problem);
+    INFO_MSG("Solve %s after %u iterations, err = %1.4e", KrylovSolver::statusName(report.status), report.iterations, report.residual);
+
+    // The CG bound on the estimated condition number, for the reduction the solve reached, next to the iterations it took
+    if (report.spectrum.steps > 0){
+        INFO_MSG("Spectrum estimate: lambda in [%1.4e, %1.4e], condition number = %1.4e, CG bound = %u iterations",
+                 report.spectrum.lambdaMin, report.spectrum.lambdaMax, report.spectrum.condition(),
+                 KrylovSolver::predictIterations(report.spectrum, report.residual/r0));
     }
+    policy.pageReport("workspace", work.data(), work.used());
+    if (profiler != nullptr) profiler->report(Profiling::measureRoofline(&policy));
 
-    rk = hr[0];
-    err = std::sqrt( rk.dot(rk)/rk.size() );
-    CHECK_FATAL_ITERERROR(kappa, err);
-    INFO_MSG("kappa = %-5u err = %1.4e", kappa, err); 
-    if (tol > err) break;
-
-    } while (kappa < kappaMax); 
+    // Pure Neumann/periodic: u is only defined up to a constant, pick the zero-mean one
+    if (Mesh::isSingular(boundaries)) Mesh::removeNullspace(u);
 
 
 
@@ -359,33 +574,18 @@ do {
     //## =============== ##//
     //## Export solution ##//
     //## =============== ##//
-    std::ofstream dataFile("data.bin", std::ios::out | std::ios::binary | std::ios::trunc); /**< Data output file, not using std::ios::app */ 
-    dataFile.write(reinterpret_cast<const char*>(&jmax), sizeof(jmax));
-    dataFile.write(reinterpret_cast<const char*>(&imax), sizeof(imax));
-
-    u32 idx = 0;
-    for (u32 j=0; j<jmax; j++){
-        for (u32 i=0; i<imax; i++){
-            // Plotting / postprocessing currently does not need to be done in such high precision
-            f32 xPoint = (float) grid.x[i]; /**< f32 x-position */
-            f32 yPoint = (float) grid.y[j]; /**< f32 y-position */
-            f32 uPoint;                     /**< f32 u-solution */
-            if      (i==0     ) {uPoint = (float) boundaries.West[j]; }
-            else if (i==imax-1) {uPoint = (float) boundaries.East[j]; }
-            else if (j==0     ) {uPoint = (float) boundaries.South[i];}
-            else if (j==jmax-1) {uPoint = (float) boundaries.North[i];}
-            else                {uPoint = (float) u[idx]; idx++;      }
-
-            // INFO_MSG("idx=%d, uPoint=%f", idx, uPoint)
-            dataFile.write(reinterpret_cast<const char*>(&xPoint), sizeof(xPoint));
-            dataFile.write(reinterpret_cast<const char*>(&yPoint), sizeof(yPoint));
-            dataFile.write(reinterpret_cast<const char*>(&uPoint), sizeof(uPoint));
+    EigenDefs::Array2D<f64> field; /**< full-grid solution u(j,i), boundaries included */
+    Mesh::scatterSolution(grid, boundaries, u, field);
 
-        }
-    }
-    dataFile.close();
+    // Gradient, residual and curl check are written alongside u, such that post.py only has to plot them
+    PostProcess::derivedFields derived;
+    PostProcess::compute(grid, field, valueSource, nullptr, derived, &policy, stencil);
+    INFO_MSG("max|f + lap(u)| = %1.4e, max|curl(grad(u))| = %1.4e", derived.residualMax, derived.curlMax);
+
+    // Written in tiles by the background thread of the exporter, the fields are handed over rather than copied
+    exporter.submit("data.bin", grid, IO::solutionFields(std::move(field), std::move(derived)));
 
-    INFO_MSG("Solution saved.");
+    INFO_MSG("Solution export started.");
 
     return EXIT_SUCCESS;
 }
@@ -10,19 +10,15 @@ import src.post.filledContour as FilledContour
 ##// ============== //##
 fileName = "./bin/data.bin"
 
-# Get solution
-x, y, u  = BinaryData.read(fileName) # u[j,i], not u[i,j]
+# Get solution, together with the fields derived from it by the C++ postprocessing step
+fields = BinaryData.readFields(fileName) # u[j,i], not u[i,j]
+x, y, u = fields["x"], fields["y"], fields["u"]
 
-# Get gradients of solution
-dudy,    dudx    = np.gradient(u,    y[:,0], x[0,:], edge_order=2)
-d2udydy, d2udydx = np.gradient(dudy, y[:,0], x[0,:], edge_order=2)
-d2udxdy, d2udxdx = np.gradient(dudx, y[:,0], x[0,:], edge_order=2)
+# curl(grad(u)) : should be zero everywhere (or close to it)
+curlgradu = fields["curl"]
 
-# Calculate curl(grad(u)) : should be zero everywhere (or close to it)
-curlgradu = d2udydx - d2udxdy
-
-# Calculate div(grad(u))  : should be source term everywhere (or close to it)
-divgradu  = d2udxdx + d2udydy
+# f + div(grad(u)) : discrete residual, should be zero everywhere (or close to it)
+residual  = fields["residual"]
 
 ##// ======== //##
 ##// Plotting //##
@@ -39,11 +35,18 @@ FilledContour.plot(x,y,ma.log10(  ma.masked_where(curlgradu==0, np.abs(curlgradu
                    title =r'$\log_{10}\,|\nabla\times\nabla u|\,\,[-]$',
                    xlabel=r'$x\,\,[-]$',
                    ylabel=r'$y\,\,[-]$')
-# div(grad(u)) plot
-FilledContour.plot(x,y,-divgradu,  
+# f + div(grad(u)) plot
+FilledContour.plot(x,y,ma.log10(  ma.masked_where(residual==0, np.abs(residual))  ),
                    levels=10,
-                   title =r'$-\nabla\cdot\nabla u\,\,[-]$',
+                   title =r'$\log_{10}\,|f + \nabla\cdot\nabla u|\,\,[-]$',
                    xlabel=r'$x\,\,[-]$',
                    ylabel=r'$y\,\,[-]$')
+# u - u_exact plot, when a manufactured solution was given
+if "error" in fields:
+    FilledContour.plot(x,y,fields["error"],
+                       levels=10,
+                       title =r'$u - u_{exact}\,\,[-]$',
+                       xlabel=r'$x\,\,[-]$',
+                       ylabel=r'$y\,\,[-]$')
 
 plt.show()
\ No newline at end of file
@@ -0,0 +1,37 @@
+import sys
+import numpy as np
+import matplotlib.pyplot as plt
+
+sys.path.insert(0, "./bin") # poisson.<abi>.so, built with cmake -DPYTHON=ON
+import poisson
+import src.post.filledContour as FilledContour
+
+##// ================== //##
+##// Provide parameters //##
+##// ================== //##
+imax, jmax = 1001, 1001
+x = np.linspace(0., np.pi, imax)
+y = np.linspace(0., np.pi, jmax)
+
+##// ================ //##
+##// In-process solve //##
+##// ================ //##
+# Same problem as main.cpp, without the round trip through ./bin/data.bin
+problem = poisson.Problem(x, y, west=np.sin(y), source=-2.2)
+report  = problem.solve("bicgstab", tol=1e-15, disc=0.1)
+print(report)
+
+# Zero-copy view onto the solution the solver wrote, u[j,i] (not u[i,j])
+u = np.asarray(problem.field())
+X, Y = np.meshgrid(x, y)
+
+##// ======== //##
+##// Plotting //##
+##// ======== //##
+FilledContour.plot(X,Y,u,
+                   levels=10,
+                   title =r'$u\,\,[-]$',
+                   xlabel=r'$x\,\,[-]$',
+                   ylabel=r'$y\,\,[-]$')
+
+plt.show()
@@ -0,0 +1,59 @@
+#include "arena.hpp"
+#include "fatals.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+namespace Workspace{
+
+/**< Size of a (transparent) huge page */
+constexpr u64 hugePage = 2*1024*1024;
+
+arena::arena(u64 bytes, const Parallel::executionPolicy* policy) 
+    : bytes((bytes + hugePage-1)/hugePage*hugePage), offset(0), highWater(0), executor(policy) {
+
+    // Over-map by one huge page, such that the slab can start on a huge page boundary
+    mappingBytes = this->bytes + hugePage;
+    mapping = mmap(nullptr, mappingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK_FATAL_ASSERT(mapping != MAP_FAILED, "Could not map the workspace arena.")
+
+    slab = reinterpret_cast<u8*>( (reinterpret_cast<u64>(mapping) + hugePage-1)/hugePage*hugePage );
+#ifdef MADV_HUGEPAGE
+    // Only a hint, not all kernels have transparent huge pages enabled
+    madvise(slab, this->bytes, MADV_HUGEPAGE);
+#endif
+}
+
+arena::~arena(){
+    munmap(mapping, mappingBytes);
+}
+
+VectorMap<f64> arena::vector(u64 n){
+    return VectorMap<f64>(allocate(n, 1), n);
+}
+
+MatrixMap<f64> arena::matrix(u64 n, u64 m){
+    return MatrixMap<f64>(allocate(n, m), n, m);
+}
+
+void arena::release(u64 position){
+    CHECK_FATAL_ASSERT(position <= offset, "Releasing beyond the current position of the arena.")
+    offset = position;
+}
+
+f64* arena::allocate(u64 rows, u64 cols){
+    const u64 size = matrixBytes(rows, cols);
+    CHECK_FATAL_ASSERT(offset + size <= bytes, "Workspace arena is exhausted, size it with the solvers' workspaceBytes.")
+    f64* ptr = reinterpret_cast<f64*>(slab + offset);
+    offset  += size;
+
+    // The policy's threads zero (and so place) the rows they own. Otherwise, fresh pages are zero already (and left 
+    // untouched), only released memory may be dirty
+    if (executor != nullptr)           executor->firstTouch(ptr, rows, cols);
+    else if (offset - size < highWater) std::memset(ptr, 0, std::min(offset, highWater) - (offset - size));
+    highWater = std::max(highWater, offset);
+    return ptr;
+}
+
+} // namespace Workspace
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "definesStandard.hpp"
+#include "definesEigen.hpp"
+#include "parallel.hpp"
+
+/************************************************************************************************************************
+ *  @brief Memory handed out to the solvers (their internal vectors and matrices) is represented in this namespace.
+ *
+ *  @details
+ *  Every solver needs a handful of vectors of size n. Allocating each of them separately scatters them over the heap,
+ *  and any expression that materialises a temporary allocates again inside the iteration. Instead, one slab is mapped
+ *  once, and the solvers get Eigen::Map views into it. The slab is aligned to (and sized in) 2MB, such that the kernel
+ *  can back it with transparent huge pages, and every view is aligned to 64 bytes (a cache line, and an AVX-512
+ *  register). Since the views do not own their memory, an arena outlives every solver using it, and can be reused by
+ *  a new solver once the previous one is done (see mark/release). Given an execution policy, every view is zeroed by the
+ *  threads owning its rows, such that its pages are placed on the NUMA node that later works on them.
+ ************************************************************************************************************************/
+namespace Workspace{
+
+/** Dynamically-sized vector of type Type, living in an arena */
+template<typename Type> using VectorMap = Eigen::Map< EigenDefs::Vector<Type>, Eigen::Aligned64 >;
+/** Dynamically-sized matrix of type Type, living in an arena */
+template<typename Type> using MatrixMap = Eigen::Map< EigenDefs::Matrix<Type>, Eigen::Aligned64 >;
+
+/**< Alignment of every view handed out, in bytes */
+constexpr u64 alignment = 64;
+
+/**< Bytes taken by a vector of n f64 in an arena */
+constexpr u64 vectorBytes(u64 n)        { return (n*sizeof(f64) + alignment-1)/alignment*alignment; }
+/**< Bytes taken by a matrix of (n,m) f64 in an arena */
+constexpr u64 matrixBytes(u64 n, u64 m) { return vectorBytes(n*m); }
+
+
+
+/************************************************************************************************************************
+ *  @brief A bump allocator over one huge-page-friendly memory mapping.
+ ************************************************************************************************************************/
+class arena{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction maps (at least) the requested number of bytes, the only allocation the arena does */
+        arena(u64 bytes, const Parallel::executionPolicy* policy = nullptr);
+
+        /**< Unmaps the slab, every view handed out becomes invalid */
+        ~arena();
+
+        /**< Disabled construction using another arena */
+        arena(const arena&) = delete;
+
+        /**< Disabled construction by equating to another arena */
+        arena& operator =(const arena&) = delete;
+
+
+
+        /**< Hands out a zeroed vector of size n */
+        VectorMap<f64> vector(u64 n);
+
+        /**< Hands out a zeroed matrix of size (n,m) */
+        MatrixMap<f64> matrix(u64 n, u64 m);
+
+        /**< Current position of the arena, to release everything handed out after it */
+        u64 mark() const { return offset; }
+
+        /**< Releases everything handed out after the mark, the memory is reused by the next views */
+        void release(u64 position);
+
+        /**< Number of bytes handed out */
+        u64 used() const { return offset; }
+
+        /**< Number of bytes that can be handed out */
+        u64 capacity() const { return bytes; }
+
+        /**< Start of the memory handed out */
+        const void* data() const { return slab; }
+
+        /**< Execution policy that first-touched the views, nullptr if none */
+        const Parallel::executionPolicy* policy() const { return executor; }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        f64* allocate(u64 rows, u64 cols);
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        void* mapping;      /**< start of the memory mapping */
+        u64   mappingBytes; /**< size of the memory mapping */
+        u8*   slab;         /**< start of the slab, 2MB aligned */
+        u64   bytes;        /**< size of the slab */
+        u64   offset;       /**< bytes handed out */
+        u64   highWater;    /**< max bytes ever handed out, beyond it the pages were never touched */
+        const Parallel::executionPolicy* executor; /**< threads first-touching the views, nullptr if none */
+
+};
+
+} // namespace Workspace
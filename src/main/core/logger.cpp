@@ -5,7 +5,27 @@
 #include <stdarg.h>
 
 
+/**< least severe level that still gets written */
+static logLevel maxLevel = LOG_LEVEL_TRACE;
+
+/**< whether messages go to stderr rather than stdout */
+static b8 toStderr = false;
+
+void logSetLevel(logLevel level){
+    maxLevel = level;
+}
+
+void logUseStderr(b8 enabled){
+    toStderr = enabled;
+}
+
+logLevel logGetLevel(){
+    return maxLevel;
+}
+
 void logOutput(logLevel level, const char* message, ...){
+    if (level > maxLevel) return;
+
     const char* levelStrings[6] = { "[FATAL]: ", 
                                     "[ERROR]: ", 
                                     "[WARN] : ", 
@@ -40,7 +60,7 @@ void logOutput(logLevel level, const char* message, ...){
     sprintf(outMessage2, "%s%s\n", levelStrings[level], outMessage);
     
     // TODO: Platform-specific output
-    printf("%s", outMessage2);
+    fputs(outMessage2, toStderr ? stderr : stdout);
     
 };
 
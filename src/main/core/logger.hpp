@@ -30,6 +30,26 @@ typedef enum logLevel{
 
 
 
+/************************************************************************************************************************
+*  @brief   Sets the least severe level that still gets written, e.g. LOG_LEVEL_WARN silences info/debug/trace messages.
+* 
+*  @details Unlike the LOG_*_ENABLED flags, this is a runtime switch: useful when the console is used for something 
+*           else (e.g. the server protocol), or to keep the per-iteration messages of the solvers out of the way.
+*
+*  @param level a level from the @ref logLevel struct, default is LOG_LEVEL_TRACE (everything is written).
+* 
+*  @return None
+************************************************************************************************************************/
+void logSetLevel(logLevel level);
+
+/**< Least severe level that currently gets written, e.g. to restore it after silencing the console for a while */
+logLevel logGetLevel();
+
+/**< Writes every message to stderr rather than stdout (default false), e.g. when stdout carries the server protocol */
+void logUseStderr(b8 enabled);
+
+
+
 /************************************************************************************************************************
 *  @brief   Writes to the console a log message of \p level severity.
 * 
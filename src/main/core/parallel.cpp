@@ -0,0 +1,313 @@
+#include "parallel.hpp"
+#include "fatals.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Parallel{
+
+/**< Number of f64 in a (small) page, row blocks are aligned to it such that no page is shared by two threads */
+constexpr u64 pageRows = 4096/sizeof(f64);
+
+/**< Parses a sysfs cpu list, e.g. "0-3,8-11" */
+static std::vector<u32> parseCpuList(const char* path){
+    std::vector<u32> cpus;
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) return cpus;
+    u32 first, last;
+    while (fscanf(file, "%u", &first) == 1){
+        last = first;
+        i32 c = fgetc(file);
+        if (c == '-'){
+            if (fscanf(file, "%u", &last) != 1) break;
+            c = fgetc(file);
+        }
+        for (u32 i=first; i<=last; i++) cpus.push_back(i);
+        if (c != ',') break;
+    }
+    fclose(file);
+    return cpus;
+}
+
+/**< Cpus this process may run on, read once before any policy pins a thread (pinning narrows the mask of a thread) */
+static const cpu_set_t& processCpus(){
+    static const cpu_set_t allowed = []{
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(0, sizeof(set), &set);
+        return set;
+    }();
+    return allowed;
+}
+
+executionPolicy::executionPolicy(u32 nThreads)
+    : mode(REDUCTION_FAST), task(nullptr), context(nullptr), generation(0), pending(0), stopping(false) {
+
+    // Cpus this process may run on, not those of the calling thread, which an enclosing policy may have pinned
+    const cpu_set_t &allowed = processCpus();
+
+    // Cpus of every NUMA node, a machine without sysfs node entries is a single node
+    std::vector< std::vector<u32> > nodeCpus;
+    std::vector<u32> nodeIds;
+    u32 k = 0;
+    for (; ; k++){
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", k);
+        if (access(path, R_OK) != 0) break;
+        std::vector<u32> cpus;
+        for (u32 c : parseCpuList(path)) if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        if (!cpus.empty()) { nodeCpus.push_back(cpus); nodeIds.push_back(k); }
+    }
+    if (nodeCpus.empty()){
+        nodeCpus.emplace_back();
+        nodeIds.push_back(0);
+        for (u32 c=0; c<CPU_SETSIZE; c++) if (CPU_ISSET(c, &allowed)) nodeCpus[0].push_back(c);
+    }
+    nNodes = std::max(k, 1u);
+
+    u32 available = 0;
+    for (auto &cpus : nodeCpus) available += cpus.size();
+    this->nThreads = nThreads == 0 ? available : nThreads;
+
+    // Threads are spread evenly over the nodes, consecutive threads (hence consecutive row blocks) on the same node
+    std::vector<u32> next(nodeCpus.size(), 0);
+    for (u32 t=0; t<this->nThreads; t++){
+        u32 k = (u64) t*nodeCpus.size()/this->nThreads;
+        node.push_back(nodeIds[k]);
+        cpu.push_back(nodeCpus[k][next[k]++ % nodeCpus[k].size()]);
+    }
+
+    // The calling thread is thread 0, its own mask is restored on destruction
+    caller = pthread_self();
+    CPU_ZERO(&callerCpus);
+    pthread_getaffinity_np(caller, sizeof(callerCpus), &callerCpus);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu[0], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    for (u32 t=1; t<this->nThreads; t++){
+        workers.emplace_back(&executionPolicy::work, this, t);
+        CPU_ZERO(&set);
+        CPU_SET(cpu[t], &set);
+        pthread_setaffinity_np(workers.back().native_handle(), sizeof(set), &set);
+    }
+}
+
+executionPolicy::~executionPolicy(){
+    stopping.store(true);
+    generation.fetch_add(1);
+    generation.notify_all();
+    for (std::thread &worker : workers) worker.join();
+    pthread_setaffinity_np(caller, sizeof(callerCpus), &callerCpus);
+}
+
+void executionPolicy::range(u32 t, u64 n, u64 &begin, u64 &end) const {
+    u64 pages = (n + pageRows-1)/pageRows;
+    begin = std::min(n, pages* t   /nThreads*pageRows);
+    end   = std::min(n, pages*(t+1)/nThreads*pageRows);
+}
+
+void executionPolicy::dispatch(void (*task)(void*, u32), void* context) const {
+
+    // Single thread, nothing to hand out
+    if (nThreads == 1) { task(context, 0); return; }
+
+    this->task    = task;
+    this->context = context;
+    pending.store(nThreads-1);
+    generation.fetch_add(1);
+    generation.notify_all();
+
+    task(context, 0);
+
+    while (pending.load() != 0) std::this_thread::yield();
+}
+
+void executionPolicy::work(u32 t){
+    u64 seen = 0;
+    while (true){
+        // Spin a little before sleeping, dispatches come in quick succession during a solve
+        u32 spins = 0;
+        while (generation.load() == seen && spins < 4096) { spins++; std::this_thread::yield(); }
+        generation.wait(seen);
+        seen = generation.load();
+        if (stopping.load()) return;
+
+        task(context, t);
+        pending.fetch_sub(1);
+    }
+}
+
+void executionPolicy::firstTouch(f64* data, u64 rows, u64 cols) const {
+    auto touch = [&](u32 t){
+        u64 begin, end;
+        range(t, rows, begin, end);
+        for (u64 c=0; c<cols; c++) std::memset(data + c*rows + begin, 0, (end-begin)*sizeof(f64));
+    };
+    run(touch);
+}
+
+void executionPolicy::symmetricProduct(const Eigen::SparseMatrix<f64> &A, const f64* x, f64* y) const {
+    const i32* outer = A.outerIndexPtr();
+    const i32* inner = A.innerIndexPtr();
+    const f64* value = A.valuePtr();
+    const i32* nnz   = A.innerNonZeroPtr();
+    const Simd::kernelTable &kernels = Simd::kernels();
+    auto product = [&](u32 t){
+        u64 begin, end;
+        range(t, A.outerSize(), begin, end);
+        kernels.symmetricRows(outer, inner, value, nnz, x, y, begin, end);
+    };
+    run(product);
+}
+
+bool isSymmetric(const Eigen::SparseMatrix<f64> &A){
+    if (A.rows() != A.cols()) return false;
+
+    // Every entry against its mirror, found by bisection in the other column (0 if it is not stored)
+    for (i32 k=0; k<A.outerSize(); k++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, k); it; ++it){
+            if (it.row() == k) continue;
+            const f64 mirror = A.coeff(k, it.row());
+            if (std::abs(it.value() - mirror) > 1e-12*std::max(std::abs(it.value()), std::abs(mirror))) return false;
+        }
+    }
+    return true;
+}
+
+/**< Dot product of a page of rows in a fixed order: 4 interleaved sums, added pairwise */
+static f64 pageDot(const f64* x, const f64* y, u64 n){
+    f64 s[4] = {0., 0., 0., 0.};
+    u64 i = 0;
+    for (; i+4<=n; i+=4){
+        s[0] += x[i  ]*y[i  ];
+        s[1] += x[i+1]*y[i+1];
+        s[2] += x[i+2]*y[i+2];
+        s[3] += x[i+3]*y[i+3];
+    }
+    for (; i<n; i++) s[i%4] += x[i]*y[i];
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+f64 executionPolicy::dot(const f64* x, const f64* y, u64 n) const {
+
+    // Sums of the threads one cache line apart (no false sharing), or one sum per page
+    constexpr u64 stride = 64/sizeof(f64);
+    const u64 pages = (n + pageRows-1)/pageRows;
+    const u64 size  = mode == REDUCTION_DETERMINISTIC ? pages : nThreads*stride;
+    if (partials.size() < size) partials.resize(size);
+    f64* sums = partials.data();
+
+    if (mode == REDUCTION_FAST){
+        const Simd::kernelTable &kernels = Simd::kernels();
+        auto sum = [&](u32 t){
+            u64 begin, end;
+            range(t, n, begin, end);
+            sums[t*stride] = kernels.dot(x + begin, y + begin, end - begin);
+        };
+        run(sum);
+        f64 total = 0.;
+        for (u32 t=0; t<nThreads; t++) total += sums[t*stride];
+        return total;
+    }
+
+    // Thread blocks are whole pages (but the last), so every page is summed the same way whichever thread owns it
+    auto sum = [&](u32 t){
+        u64 begin, end;
+        range(t, n, begin, end);
+        for (u64 i=begin; i<end; i+=pageRows) sums[i/pageRows] = pageDot(x + i, y + i, std::min(pageRows, end - i));
+    };
+    run(sum);
+    for (u64 width=1; width<pages; width*=2){
+        for (u64 p=0; p+width<pages; p+=2*width) sums[p] += sums[p + width];
+    }
+    return pages > 0 ? sums[0] : 0.;
+}
+
+f64 executionPolicy::axpyNorm(f64* z, const f64* x, f64 a, const f64* y, u64 n) const {
+    constexpr u64 stride = 64/sizeof(f64);
+    const u64 pages = (n + pageRows-1)/pageRows;
+    const u64 size  = mode == REDUCTION_DETERMINISTIC ? pages : nThreads*stride;
+    if (partials.size() < size) partials.resize(size);
+    f64* sums = partials.data();
+
+    if (mode == REDUCTION_FAST){
+        const Simd::kernelTable &kernels = Simd::kernels();
+        auto sum = [&](u32 t){
+            u64 begin, end;
+            range(t, n, begin, end);
+            sums[t*stride] = kernels.axpyNorm(z + begin, x + begin, a, y + begin, end - begin);
+        };
+        run(sum);
+        f64 total = 0.;
+        for (u32 t=0; t<nThreads; t++) total += sums[t*stride];
+        return total;
+    }
+
+    // The update of a page, then its sum of squares while it is still in cache, both in the order of dot()
+    auto sum = [&](u32 t){
+        u64 begin, end;
+        range(t, n, begin, end);
+        for (u64 i=begin; i<end; i+=pageRows){
+            const u64 m = std::min(pageRows, end - i);
+            for (u64 k=i; k<i+m; k++) z[k] = x[k] + a*y[k];
+            sums[i/pageRows] = pageDot(z + i, z + i, m);
+        }
+    };
+    run(sum);
+    for (u64 width=1; width<pages; width*=2){
+        for (u64 p=0; p+width<pages; p+=2*width) sums[p] += sums[p + width];
+    }
+    return pages > 0 ? sums[0] : 0.;
+}
+
+bool executionPolicy::placement(const void* data, u64 bytes, std::vector<u64> &pages) const {
+
+    // Ask the kernel for the node of every page (move_pages without target nodes only queries)
+    const u64 pageBytes = sysconf(_SC_PAGESIZE);
+    const u64 first     = reinterpret_cast<u64>(data)/pageBytes*pageBytes;
+    const u64 count     = (reinterpret_cast<u64>(data) + bytes - first + pageBytes-1)/pageBytes;
+    const u64 batch     = 1024;
+
+    pages.assign(nNodes+1, 0);
+    void* addresses[batch];
+    i32   status[batch];
+    for (u64 p=0; p<count; p+=batch){
+        u64 m = std::min(batch, count-p);
+        for (u64 q=0; q<m; q++) addresses[q] = reinterpret_cast<void*>(first + (p+q)*pageBytes);
+        if (syscall(SYS_move_pages, 0, m, addresses, nullptr, status, 0) != 0) return false;
+        for (u64 q=0; q<m; q++){
+            // Pages not faulted in yet (-ENOENT), or on an unknown node
+            if (status[q] >= 0 && (u32) status[q] < nNodes) pages[status[q]]++;
+            else                                            pages[nNodes]++;
+        }
+    }
+    return true;
+}
+
+void executionPolicy::pageReport(const char* label, const void* data, u64 bytes) const {
+
+    for (u32 t=0; t<nThreads; t++) DEBUG_MSG("thread %-3u cpu %-4u node %u", t, cpu[t], node[t]);
+
+    std::vector<u64> pages;
+    if (!placement(data, bytes, pages)){
+        WARN_MSG("%s: page placement could not be queried.", label);
+        return;
+    }
+
+    u64 count = 0;
+    for (u64 p : pages) count += p;
+    INFO_MSG("%s: %llu pages over %u node(s), %u thread(s)", label, count, nNodes, nThreads);
+    for (u32 k=0; k<nNodes; k++) INFO_MSG("%s: node %u holds %llu pages (%5.1f%%)", label, k, pages[k], 100.*pages[k]/count);
+    if (pages[nNodes] > 0) INFO_MSG("%s: %llu pages untouched (or on no known node)", label, pages[nNodes]);
+}
+
+} // namespace Parallel
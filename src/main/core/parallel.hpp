@@ -0,0 +1,179 @@
+#pragma once
+
+#include "definesStandard.hpp"
+#include "definesEigen.hpp"
+
+#include <atomic>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+/************************************************************************************************************************
+ *  @brief Where the solvers run (threads, and the memory they touch) is represented in this namespace.
+ *
+ *  @details
+ *  Linux places a page on the NUMA node of the thread that first writes to it. If the main thread zeroes every vector,
+ *  every page ends up on the first socket, and threads on the other socket(s) then stream their part of the vectors
+ *  over the inter-socket link. The execution policy avoids this by:
+ *    - pinning one worker per core, with consecutive threads filling a socket before moving to the next one.
+ *    - splitting the rows of every vector in contiguous, page-aligned blocks, one per thread (the row partition).
+ *    - letting each thread first-touch (zero) exactly the rows it later computes in the sparse matrix-vector product.
+ *  The page placement can be checked with pageReport, which asks the kernel where the pages of a range actually live.
+ ************************************************************************************************************************/
+namespace Parallel{
+
+/* list of the ways the reductions (dot products) of the policy combine the sums of the threads */
+typedef enum reductionMode{
+    REDUCTION_FAST          = 0, /**< one sum per thread, added in thread order: reproducible for a given thread count only */
+    REDUCTION_DETERMINISTIC = 1, /**< one sum per page of rows, added by a fixed pairwise tree: the same for any thread count */
+} reductionMode;
+
+/************************************************************************************************************************
+ *  @brief A pool of pinned threads, together with the row partition every parallel kernel follows.
+ ************************************************************************************************************************/
+class executionPolicy{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction pins nThreads threads (the calling thread being thread 0), 0 takes every available cpu */
+        executionPolicy(u32 nThreads = 0);
+
+        /**< Stops and joins the workers, and gives the calling thread its affinity back */
+        ~executionPolicy();
+
+        /**< Disabled construction using another policy */
+        executionPolicy(const executionPolicy&) = delete;
+
+        /**< Disabled construction by equating to another policy */
+        executionPolicy& operator =(const executionPolicy&) = delete;
+
+
+
+        /**< Number of threads, the calling thread included */
+        u32 threads() const { return nThreads; }
+
+        /**< Number of NUMA nodes (sockets) found */
+        u32 nodes() const { return nNodes; }
+
+        /**< Rows [begin, end) of a vector of size n owned by thread t, blocks start on page boundaries */
+        void range(u32 t, u64 n, u64 &begin, u64 &end) const;
+
+        /************************************************************************************************************************
+         *  @brief Runs task(t) on every thread t, and returns once all of them are done. Does not allocate.
+         *
+         *  @param task callable taking the thread index (u32).
+         ************************************************************************************************************************/
+        template<typename Task> void run(Task &task) const {
+            dispatch([](void* context, u32 t){ (*static_cast<Task*>(context))(t); }, &task);
+        }
+
+        /************************************************************************************************************************
+         *  @brief Zeroes a column-major matrix of size (rows, cols), every thread writing the rows it owns in every column.
+         *
+         *  @param data pointer to the (not yet touched) memory.
+         *  @param rows number of rows, the size of the vectors.
+         *  @param cols number of columns, 1 for a vector.
+         ************************************************************************************************************************/
+        void firstTouch(f64* data, u64 rows, u64 cols = 1) const;
+
+        /************************************************************************************************************************
+         *  @brief Sparse matrix-vector product y = A x for a symmetric A, every thread computing the rows it owns.
+         *
+         *  @details
+         *  A is stored column-major, so row i of A is not contiguous. For a symmetric A, row i equals column i, hence
+         *  y(i) = A(:,i)^T x, which needs nothing but the columns of the rows owned by the thread (and no atomics).
+         *  For any other A, this is A^T x: callers check isSymmetric(A) once, and multiply by A serially otherwise.
+         *
+         *  @param A symmetric sparse matrix.
+         *  @param x vector to multiply.
+         *  @param y result, may not alias x.
+         ************************************************************************************************************************/
+        void symmetricProduct(const Eigen::SparseMatrix<f64> &A, const f64* x, f64* y) const;
+
+        /**< Sets how the reductions combine the sums of the threads, REDUCTION_FAST by default */
+        void reduction(reductionMode mode) { this->mode = mode; }
+
+        /**< How the reductions combine the sums of the threads */
+        reductionMode reduction() const { return mode; }
+
+        /************************************************************************************************************************
+         *  @brief Dot product x^T y, every thread summing the rows it owns.
+         *
+         *  @details
+         *  Floating-point addition is not associative: how the sum is split over the threads decides its last bits. With
+         *  REDUCTION_FAST, every thread sums its rows (with the SIMD kernel of the cpu, see Simd::kernels) and the sums
+         *  of the threads are added in thread order, which reproduces a result run after run on the same number of
+         *  threads (on any cpu, the SIMD levels agree bitwise), but not on others. With REDUCTION_DETERMINISTIC, every
+         *  page of rows (512) is summed in a fixed order (by baseline code, never dispatched), and the page sums are
+         *  added by a pairwise tree whose shape only depends on n: the result is bitwise the same for any number of
+         *  threads (one included) of the same build, on any cpu, at the cost of a store per page and a serial tree of
+         *  n/512 additions.
+         *
+         *  @param x first vector, of n rows.
+         *  @param y second vector, of n rows.
+         *  @param n number of rows.
+         *
+         *  @return x^T y.
+         ************************************************************************************************************************/
+        f64 dot(const f64* x, const f64* y, u64 n) const;
+
+        /**< z = x + a y (z may alias x), returning z^T z in one pass, reduced as dot() is */
+        f64 axpyNorm(f64* z, const f64* x, f64 a, const f64* y, u64 n) const;
+
+        /************************************************************************************************************************
+         *  @brief Counts on which NUMA node the pages of [data, data+bytes) live.
+         *
+         *  @param data  start of the memory range.
+         *  @param bytes size of the memory range.
+         *  @param pages number of pages per node, the last entry (index nodes()) counts the pages not yet touched.
+         *
+         *  @return false if the kernel could not be queried.
+         ************************************************************************************************************************/
+        bool placement(const void* data, u64 bytes, std::vector<u64> &pages) const;
+
+        /************************************************************************************************************************
+         *  @brief Logs the thread pinning, and on which NUMA node the pages of [data, data+bytes) live.
+         *
+         *  @param label name of the memory range, used in the report.
+         *  @param data  start of the memory range.
+         *  @param bytes size of the memory range.
+         ************************************************************************************************************************/
+        void pageReport(const char* label, const void* data, u64 bytes) const;
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        void dispatch(void (*task)(void*, u32), void* context) const;
+        void work(u32 t);
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        u32 nThreads;                               /**< number of threads, the calling thread included */
+        u32 nNodes;                                 /**< number of NUMA nodes, cpu-less ones included */
+        std::vector<u32> cpu;                       /**< cpu each thread is pinned to */
+        std::vector<u32> node;                      /**< NUMA node each thread is pinned to */
+        std::vector<std::thread> workers;           /**< threads 1 .. nThreads-1 */
+        pthread_t caller;                           /**< calling thread (thread 0) */
+        cpu_set_t callerCpus;                       /**< affinity of the calling thread before it was pinned */
+        reductionMode mode;                         /**< how the reductions combine the sums of the threads */
+        mutable std::vector<f64> partials;          /**< sums of the threads (one cache line apart) or of the pages */
+
+        mutable void (*task)(void*, u32);           /**< task of the current dispatch */
+        mutable void* context;                      /**< context of the current dispatch */
+        mutable std::atomic<u64> generation;        /**< dispatch counter, workers wait for it to change */
+        mutable std::atomic<u32> pending;           /**< workers that have not finished the current dispatch */
+        std::atomic<bool> stopping;                 /**< set when the workers need to exit */
+
+};
+
+/**< Whether A is symmetric up to rounding (every A(i,j) within 1e-12 of A(j,i), relatively), i.e. whether
+     executionPolicy::symmetricProduct computes A x. The 5-point A of a stretched grid is not */
+bool isSymmetric(const Eigen::SparseMatrix<f64> &A);
+
+} // namespace Parallel
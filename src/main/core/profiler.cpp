@@ -0,0 +1,267 @@
+#include "profiler.hpp"
+#include "logger.hpp"
+#include "fatals.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Profiling{
+
+/**< Event of every counter, as (type, config) of perf_event_open */
+static const u64 events[COUNTER_COUNT][2] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+/**< Bytes per cache line, the traffic of one last-level cache miss */
+constexpr f64 lineBytes = 64.;
+
+/**< Opens a counter of the calling thread (user space only, which unprivileged processes may count), -1 on failure */
+static i32 openCounter(counterType counter, i32 leader){
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = events[counter][0];
+    attr.config         = events[counter][1];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+/**< Value of /proc/sys/kernel/perf_event_paranoid, or a large value when it cannot be read */
+static i32 paranoidLevel(){
+    i32 level = 99;
+    FILE* file = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    if (file == nullptr) return level;
+    if (fscanf(file, "%d", &level) != 1) level = 99;
+    fclose(file);
+    return level;
+}
+
+profiler::profiler(const Parallel::executionPolicy* policy) : active(-1), startCounts{} {
+
+    // Every thread opens the counters of itself (the pinned workers live as long as the policy)
+    const u32 nThreads = policy != nullptr ? policy->threads() : 1;
+    groups.resize(nThreads);
+    std::vector<i32> failure(nThreads, 0);
+    auto open = [&](u32 t){
+        counterGroup &group = groups[t];
+        for (u32 c=0; c<COUNTER_COUNT; c++){
+            const i32 descriptor = openCounter(counterType(c), group.leader);
+            if (descriptor < 0){
+                if (failure[t] == 0) failure[t] = errno;
+                continue;
+            }
+            if (group.leader < 0) group.leader = descriptor;
+            group.descriptor[c] = descriptor;
+            group.slot[c]       = group.size++;
+        }
+    };
+    if (policy != nullptr) policy->run(open);
+    else                   open(0);
+
+    for (u32 c=0; c<COUNTER_COUNT; c++){
+        present[c] = true;
+        for (const counterGroup &group : groups) present[c] = present[c] && group.descriptor[c] >= 0;
+    }
+
+    // Without counters the timings and the model still place the kernels on the roofline
+    if (failure[0] != 0){
+        WARN_MSG("Hardware counters %s (%s, perf_event_paranoid = %d): %s",
+                 groups[0].leader < 0 ? "unavailable" : "partly unavailable", std::strerror(failure[0]), paranoidLevel(),
+                 groups[0].leader < 0 ? "profiling time and modelled traffic only" : "missing counters are left out");
+    }
+}
+
+profiler::~profiler(){
+    for (counterGroup &group : groups){
+        for (i32 descriptor : group.descriptor){
+            if (descriptor >= 0) close(descriptor);
+        }
+    }
+}
+
+void profiler::read(std::array<u64, COUNTER_COUNT> &values) const{
+
+    // One read per thread returns its whole group: {nr, time enabled, time running, value[nr]}
+    values.fill(0);
+    u64 buffer[3 + COUNTER_COUNT];
+    for (const counterGroup &group : groups){
+        if (group.leader < 0) continue;
+        const ssize_t bytes = ::read(group.leader, buffer, sizeof(buffer));
+        if (bytes < (ssize_t) (3*sizeof(u64)) || buffer[0] != group.size) continue;
+
+        // Counters multiplexed with other users of the PMU only run part of the time, extrapolate them
+        const f64 scale = buffer[2] > 0 ? f64(buffer[1])/f64(buffer[2]) : 1.;
+        for (u32 c=0; c<COUNTER_COUNT; c++){
+            if (group.slot[c] >= 0) values[c] += u64(scale*f64(buffer[3 + group.slot[c]]));
+        }
+    }
+}
+
+u32 profiler::region(const std::string &name, f64 bytes, f64 flops){
+    u32 id = 0;
+    while (id < regions.size() && regions[id].name != name) id++;
+    if (id == regions.size()){
+        regions.emplace_back();
+        regions[id].name = name;
+    }
+    regions[id].bytes = bytes;
+    regions[id].flops = flops;
+    return id;
+}
+
+void profiler::begin(u32 id){
+    CHECK_FATAL_ASSERT(active < 0, "Profiled regions do not nest.")
+    CHECK_FATAL_ASSERT(id < regions.size(), "Unknown profiled region.")
+    active = id;
+    read(startCounts);
+    startTime = std::chrono::steady_clock::now();
+}
+
+void profiler::end(u32 id, f64 units){
+    const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+    std::array<u64, COUNTER_COUNT> endCounts;
+    read(endCounts);
+    CHECK_FATAL_ASSERT(active == (i32) id, "Ending a profiled region that is not active.")
+
+    regionTotals &totals = regions[id];
+    totals.calls++;
+    totals.units   += units;
+    totals.seconds += std::chrono::duration<f64>(endTime - startTime).count();
+    for (u32 c=0; c<COUNTER_COUNT; c++) totals.counts[c] += endCounts[c] - std::min(endCounts[c], startCounts[c]);
+    active = -1;
+}
+
+void profiler::reset(){
+    for (regionTotals &totals : regions){
+        totals.calls   = 0;
+        totals.units   = 0.;
+        totals.seconds = 0.;
+        totals.counts.fill(0);
+    }
+}
+
+void profiler::report(const machineRoofline &roofline) const{
+
+    if (roofline.bandwidth > 0.){
+        INFO_MSG("Roofline: %.2f GB/s, %.2f GFLOP/s, balance %.3f flop/byte",
+                 roofline.bandwidth*1e-9, roofline.flops*1e-9, roofline.balance());
+    }
+    INFO_MSG("%-10s %8s %10s %8s %8s %8s %8s %6s %10s %6s %s", "region", "calls", "time [s]", "GB/s", "GFLOP/s",
+             "AI model", "AI LLC", "IPC", "roof GF/s", "% roof", "bound");
+
+    for (const regionTotals &totals : regions){
+        if (totals.calls == 0 || totals.seconds <= 0.) continue;
+
+        // Achieved rates, from the model of the kernel
+        const f64 bytes = totals.units*totals.bytes;
+        const f64 flops = totals.units*totals.flops;
+        const f64 bandwidth = bytes/totals.seconds;
+        const f64 rate      = flops/totals.seconds;
+
+        // Arithmetic intensity: over the modelled bytes, and over the lines missed in the LLC (a lower bound of the
+        // traffic, prefetched lines mostly being left out) when that counter is open
+        const f64 modelIntensity = bytes > 0. ? flops/bytes : 0.;
+        const bool counted       = present[COUNTER_LLC_MISSES] && totals.counts[COUNTER_LLC_MISSES] > 0;
+        const f64 llcIntensity   = counted ? flops/(lineBytes*totals.counts[COUNTER_LLC_MISSES]) : 0.;
+        const bool ipc           = present[COUNTER_CYCLES] && present[COUNTER_INSTRUCTIONS] && totals.counts[COUNTER_CYCLES] > 0;
+
+        char llc[16] = "n/a", instructions[16] = "n/a", roof[16] = "n/a", fraction[16] = "n/a";
+        const char* bound = "";
+        if (counted) snprintf(llc, sizeof(llc), "%8.3f", llcIntensity);
+        if (ipc)     snprintf(instructions, sizeof(instructions), "%6.2f", f64(totals.counts[COUNTER_INSTRUCTIONS])/totals.counts[COUNTER_CYCLES]);
+
+        // Position on the roofline, at the intensity of the model (the traffic the kernel cannot avoid)
+        if (roofline.bandwidth > 0. && roofline.flops > 0. && modelIntensity > 0.){
+            const f64 attainable = std::min(roofline.flops, modelIntensity*roofline.bandwidth);
+            snprintf(roof, sizeof(roof), "%10.3f", attainable*1e-9);
+            snprintf(fraction, sizeof(fraction), "%6.1f", 100.*rate/attainable);
+            bound = modelIntensity < roofline.balance() ? "memory" : "compute";
+        }
+        INFO_MSG("%-10s %8llu %10.4f %8.2f %8.3f %8.3f %8s %6s %10s %6s %s", totals.name.c_str(),
+                 (unsigned long long) totals.calls, totals.seconds, bandwidth*1e-9, rate*1e-9, modelIntensity, llc,
+                 instructions, roof, fraction, bound);
+    }
+}
+
+
+
+machineRoofline measureRoofline(const Parallel::executionPolicy* policy){
+    using clock = std::chrono::steady_clock;
+    machineRoofline roofline;
+    const u32 nThreads = policy != nullptr ? policy->threads() : 1;
+    auto parallel = [&](auto &task){
+        if (policy != nullptr) policy->run(task);
+        else                   task(0);
+    };
+
+    // Triad over 3 x 32 MiB, every thread first-touching and then streaming the rows it owns
+    const u64 n = (32ull << 20)/sizeof(f64);
+    std::unique_ptr<f64[]> a(new f64[n]), b(new f64[n]), c(new f64[n]);
+    auto rows = [&](u32 t, u64 &begin, u64 &end){
+        if (policy != nullptr) policy->range(t, n, begin, end);
+        else                   begin = 0, end = n;
+    };
+    auto fill = [&](u32 t){
+        u64 begin, end;
+        rows(t, begin, end);
+        for (u64 i=begin; i<end; i++){
+            a[i] = 0.;
+            b[i] = 1.;
+            c[i] = 2.;
+        }
+    };
+    parallel(fill);
+    const f64 s = 0.5;
+    auto triad = [&](u32 t){
+        u64 begin, end;
+        rows(t, begin, end);
+        f64* __restrict x = a.get();
+        const f64* __restrict y = b.get();
+        const f64* __restrict z = c.get();
+        for (u64 i=begin; i<end; i++) x[i] = y[i] + s*z[i];
+    };
+    f64 best = 1./0.;
+    for (u32 repeat=0; repeat<5; repeat++){
+        const clock::time_point start = clock::now();
+        parallel(triad);
+        best = std::min(best, std::chrono::duration<f64>(clock::now() - start).count());
+    }
+    roofline.bandwidth = 3.*sizeof(f64)*n/best;
+
+    // Independent fma chains, enough of them to hide the latency of the floating-point pipeline
+    constexpr u32 chains = 32;
+    const u64 steps = 1ull << 20;
+    std::vector<f64> sink(nThreads, 0.);
+    auto chain = [&](u32 t){
+        f64 acc[chains];
+        for (u32 j=0; j<chains; j++) acc[j] = j;
+        const f64 x = 0.999999, y = 1e-6;
+        for (u64 k=0; k<steps; k++){
+            for (u32 j=0; j<chains; j++) acc[j] = acc[j]*x + y;
+        }
+        for (u32 j=0; j<chains; j++) sink[t] += acc[j];
+    };
+    best = 1./0.;
+    for (u32 repeat=0; repeat<3; repeat++){
+        const clock::time_point start = clock::now();
+        parallel(chain);
+        best = std::min(best, std::chrono::duration<f64>(clock::now() - start).count());
+    }
+    roofline.flops = 2.*chains*steps*nThreads/best;
+
+    DEBUG_MSG("Roofline measured on %u thread(s): %.2f GB/s, %.2f GFLOP/s (checksum %g, %g)",
+              nThreads, roofline.bandwidth*1e-9, roofline.flops*1e-9, a[n/2], sink[0]);
+    return roofline;
+}
+
+} // namespace Profiling
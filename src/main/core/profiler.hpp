@@ -0,0 +1,189 @@
+#pragma once
+
+#include "definesStandard.hpp"
+#include "parallel.hpp"
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/************************************************************************************************************************
+ *  @brief Where the time of the solver kernels goes (memory traffic, or stalls) is represented in this namespace.
+ *
+ *  @details
+ *  A sparse matrix-vector product, a dot product or an axpy do about one flop per 4 to 12 bytes, far less than the
+ *  flops per byte (the balance) a core sustains: on paper all of them are bound by memory bandwidth. Whether they
+ *  actually run at that bandwidth, or stall on the indirection x[inner[k]] of the product, is measured here by the
+ *  hardware counters of Linux (perf_event_open): cycles, instructions retired and last-level cache misses, read on
+ *  entry and exit of every named kernel region. Next to the counters, every region knows the bytes and flops its kernel
+ *  nominally needs per call (the model), from which the report derives per region:
+ *    - the achieved bandwidth and flop rate, against the triad bandwidth and fma rate of measureRoofline.
+ *    - the arithmetic intensity, flops over the bytes of the model, or over the cache lines missed in the LLC.
+ *    - the position on the roofline, min(flop rate, intensity x bandwidth), and which of both bounds the kernel.
+ *    - the instructions per cycle, low when the kernel stalls (memory latency) rather than streams.
+ *
+ *  Unprivileged processes may count their own user-space events when /proc/sys/kernel/perf_event_paranoid <= 2 (the
+ *  default on most distributions), which is all the profiler asks for. When the counters cannot be opened (a higher
+ *  paranoid level, a seccomp filter, a virtual machine without a virtual PMU), the profiler says so once and carries on
+ *  with the timings and the model: the achieved bandwidth alone still places the kernels on the roofline.
+ ************************************************************************************************************************/
+namespace Profiling{
+
+/* list of hardware counters recorded per region */
+typedef enum counterType{
+    COUNTER_CYCLES       = 0, /**< cpu cycles, user space */
+    COUNTER_INSTRUCTIONS = 1, /**< instructions retired, user space */
+    COUNTER_LLC_MISSES   = 2, /**< last-level cache misses (demand misses, hardware prefetches are mostly not counted) */
+    COUNTER_COUNT        = 3, /**< number of counters */
+} counterType;
+
+/**< Simplistic structure holding the roofline of the machine: how fast memory streams, and how fast the cores compute */
+struct machineRoofline{
+    f64 bandwidth = 0.; /**< bytes per second, of a triad too large for the caches */
+    f64 flops     = 0.; /**< flops per second, of independent fma chains */
+
+    /**< Machine balance, the arithmetic intensity (flop/byte) above which a kernel is compute bound */
+    f64 balance() const { return bandwidth > 0. ? flops/bandwidth : 0.; }
+};
+
+/************************************************************************************************************************
+ *  @brief Measures the roofline of the machine, on the threads of a policy.
+ *
+ *  @details
+ *  The bandwidth is the best of a few STREAM triads a = b + s c over 3 x 32 MiB (beyond the last-level cache of most
+ *  sockets), every thread streaming the rows it owns, counted as 24 bytes per row (write-allocate not included). The
+ *  flop rate is the best of a few runs of independent fma chains held in registers, i.e. what this build reaches, not
+ *  the peak of the datasheet. Takes about a tenth of a second.
+ *
+ *  @param policy threads to measure with, nullptr: the calling thread only.
+ *
+ *  @return roofline of the machine.
+ ************************************************************************************************************************/
+machineRoofline measureRoofline(const Parallel::executionPolicy* policy = nullptr);
+
+
+
+/************************************************************************************************************************
+ *  @brief Accumulates the hardware counters and the time of named kernel regions, and reports their roofline position.
+ *
+ *  @details
+ *  Counters are opened per thread of the policy (every thread counting itself), and summed over the threads on every
+ *  read. Regions do not nest: a region ends before the next one begins. Entering and leaving a region costs a read of
+ *  every thread's counters (a system call each, about a microsecond), noise for the kernels of large problems only.
+ ************************************************************************************************************************/
+class profiler{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction opens the counters of every thread of the policy (nullptr: the calling thread only) */
+        profiler(const Parallel::executionPolicy* policy = nullptr);
+
+        /**< Closes the counters */
+        ~profiler();
+
+        /**< Disabled construction using another profiler */
+        profiler(const profiler&) = delete;
+
+        /**< Disabled construction by equating to another profiler */
+        profiler& operator =(const profiler&) = delete;
+
+        /**< Whether a hardware counter could be opened on every thread */
+        bool available(counterType counter) const { return present[counter]; }
+
+
+
+        /************************************************************************************************************************
+         *  @brief Finds (or adds) a named region, and sets the model of the traffic and work of one unit of its kernel.
+         *
+         *  @param name  name of the region, e.g. "spmv".
+         *  @param bytes bytes one unit of the kernel moves from/to memory.
+         *  @param flops floating-point operations of one unit of the kernel.
+         *
+         *  @return identifier of the region.
+         ************************************************************************************************************************/
+        u32 region(const std::string &name, f64 bytes, f64 flops);
+
+        /**< Starts counting a region, none may be active */
+        void begin(u32 id);
+
+        /**< Stops counting the active region, crediting it with units of its kernel (e.g. 2 for two dot products) */
+        void end(u32 id, f64 units = 1.);
+
+        /**< Clears the totals of every region, keeping the regions and their models */
+        void reset();
+
+        /************************************************************************************************************************
+         *  @brief Logs a table of the totals of every region, and their position on the roofline.
+         *
+         *  @details
+         *  A region beyond 100% of its roof streams (part of) its data from the caches rather than from memory, i.e.
+         *  its working set fits in the last-level cache. A memory-bound kernel well below its roof, at a low IPC, stalls.
+         *
+         *  @param roofline roofline of the machine (see measureRoofline), the positions are skipped when it is zero.
+         ************************************************************************************************************************/
+        void report(const machineRoofline &roofline) const;
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        void read(std::array<u64, COUNTER_COUNT> &values) const;
+
+        /**< Simplistic structure holding the counters of one thread, a group led by its first open counter */
+        struct counterGroup{
+            i32 leader = -1;                                     /**< descriptor of the group leader, -1 if none opened */
+            std::array<i32, COUNTER_COUNT> descriptor = {-1, -1, -1}; /**< descriptor of every counter, -1 if not opened */
+            std::array<i32, COUNTER_COUNT> slot = {-1, -1, -1};  /**< position of every counter in a group read */
+            u32 size = 0;                                        /**< number of counters in the group */
+        };
+
+        /**< Simplistic structure holding the model and the totals of one region */
+        struct regionTotals{
+            std::string name;                                    /**< name of the region */
+            f64 bytes = 0., flops = 0.;                          /**< model of one unit of the kernel */
+            u64 calls = 0;                                       /**< number of times the region was entered */
+            f64 units = 0.;                                      /**< units of the kernel run */
+            f64 seconds = 0.;                                    /**< wall time spent in the region */
+            std::array<u64, COUNTER_COUNT> counts = {0, 0, 0};   /**< counters summed over the threads */
+        };
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        std::vector<counterGroup> groups;                        /**< counters of every thread */
+        std::array<bool, COUNTER_COUNT> present;                 /**< whether a counter is open on every thread */
+        std::vector<regionTotals> regions;                       /**< regions, by identifier */
+        i32 active;                                              /**< identifier of the active region, -1 if none */
+        std::array<u64, COUNTER_COUNT> startCounts;              /**< counters when the active region began */
+        std::chrono::steady_clock::time_point startTime;         /**< time when the active region began */
+
+};
+
+/**< Counts a region over the lifetime of a scope, does nothing when the profiler is nullptr */
+class scope{
+
+    public:
+        /**< Default construction begins the region, credited with units of its kernel when the scope ends */
+        scope(profiler* p, u32 id, f64 units = 1.) : p(p), id(id), units(units) { if (p != nullptr) p->begin(id); }
+
+        /**< Ends the region */
+        ~scope() { if (p != nullptr) p->end(id, units); }
+
+        /**< Disabled construction using another scope */
+        scope(const scope&) = delete;
+
+        /**< Disabled construction by equating to another scope */
+        scope& operator =(const scope&) = delete;
+
+    private:
+        profiler* p;  /**< profiler, nullptr when not profiling */
+        u32 id;       /**< identifier of the region */
+        f64 units;    /**< units of the kernel run in the scope */
+
+};
+
+} // namespace Profiling
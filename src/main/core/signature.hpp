@@ -0,0 +1,27 @@
+#pragma once
+
+#include "definesStandard.hpp"
+
+/************************************************************************************************************************ 
+ *  @brief Hashes a block of memory using 64-bit FNV-1a, seeded with a previous hash so blocks can be chained.
+ * 
+ *  @details
+ *  Used to build cheap signatures of grids and problems (e.g. cache keys). It is not a cryptographic hash, only a
+ *  fingerprint: two different problems colliding is possible, but vanishingly unlikely for our use.
+ *  @link https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+ * 
+ *  @param data  pointer to the first byte to hash.
+ *  @param bytes number of bytes to hash.
+ *  @param seed  hash to continue from, default is the FNV-1a offset basis.
+ * 
+ *  @return 64-bit hash of the memory block.
+ ************************************************************************************************************************/ 
+inline u64 hashBytes(const void* data, u64 bytes, u64 seed = 14695981039346656037ull){
+    const u8* ptr = static_cast<const u8*>(data);
+    u64 hash = seed;
+    for (u64 i=0; i<bytes; i++){
+        hash ^= ptr[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,251 @@
+#include "simd.hpp"
+#include "logger.hpp"
+#include "fatals.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+namespace Simd{
+
+/**< Kernel bodies are written once, and inlined into one function per instruction set by SIMD_VARIANT */
+#define SIMD_BODY static inline __attribute__((always_inline))
+
+SIMD_BODY void symmetricRowsBody(const i32* outer, const i32* inner, const f64* value, const i32* nnz,
+                                 const f64* x, f64* y, u64 begin, u64 end){
+    for (u64 i=begin; i<end; i++){
+        f64 sum = 0.;
+        const i32 last = nnz ? outer[i] + nnz[i] : outer[i+1];
+        for (i32 k=outer[i]; k<last; k++) sum += value[k]*x[inner[k]];
+        y[i] = sum;
+    }
+}
+
+// The sums run in 8 interleaved lanes (one AVX-512 register, two AVX2 or four SSE2 registers), added pairwise
+SIMD_BODY f64 dotBody(const f64* x, const f64* y, u64 n){
+    f64 s[8] = {0., 0., 0., 0., 0., 0., 0., 0.};
+    u64 i = 0;
+    for (; i+8<=n; i+=8){
+        for (u32 l=0; l<8; l++) s[l] += x[i+l]*y[i+l];
+    }
+    for (; i<n; i++) s[i%8] += x[i]*y[i];
+    return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+}
+
+SIMD_BODY f64 axpyNormBody(f64* z, const f64* x, f64 a, const f64* y, u64 n){
+    f64 s[8] = {0., 0., 0., 0., 0., 0., 0., 0.};
+    u64 i = 0;
+    for (; i+8<=n; i+=8){
+        for (u32 l=0; l<8; l++){
+            const f64 zl = x[i+l] + a*y[i+l];
+            z[i+l] = zl;
+            s[l]  += zl*zl;
+        }
+    }
+    for (; i<n; i++){
+        z[i] = x[i] + a*y[i];
+        s[i%8] += z[i]*z[i];
+    }
+    return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+}
+
+// Same expressions (and order) as stencilOperator::point
+SIMD_BODY void stencil5Body(f64* y, const f64* d, const f64* c, const f64* u, f64 centre, f64 sideX, f64 sideY, u64 a, u64 b){
+    for (u64 i=a; i<b; i++) y[i] = centre*c[i] + sideX*(c[i-1] + c[i+1]) + sideY*(d[i] + u[i]);
+}
+
+SIMD_BODY void stencil5VariableBody(f64* y, const f64* d, const f64* c, const f64* u, const f64* west, const f64* east,
+                                    const f64* centreX, f64 cy, f64 s, f64 n, u64 a, u64 b){
+    for (u64 i=a; i<b; i++) y[i] = (centreX[i] + cy)*c[i] + west[i]*c[i-1] + east[i]*c[i+1] + s*d[i] + n*u[i];
+}
+
+SIMD_BODY void mehrstellenBody(f64* y, const f64* d, const f64* c, const f64* u, f64 centre, f64 sideX, f64 sideY,
+                               f64 diagonal, u64 a, u64 b){
+    for (u64 i=a; i<b; i++){
+        y[i] = centre*c[i] + sideX*(c[i-1] + c[i+1]) + sideY*(d[i] + u[i]) + diagonal*((d[i-1] + d[i+1]) + (u[i-1] + u[i+1]));
+    }
+}
+
+/**< Defines the kernels of one instruction set, and their table */
+#define SIMD_VARIANT(suffix, target)                                                                                    \
+    target static void symmetricRows_##suffix(const i32* outer, const i32* inner, const f64* value, const i32* nnz,     \
+                                              const f64* x, f64* y, u64 begin, u64 end){                               \
+        symmetricRowsBody(outer, inner, value, nnz, x, y, begin, end);                                                  \
+    }                                                                                                                   \
+    target static f64 dot_##suffix(const f64* x, const f64* y, u64 n){                                                  \
+        return dotBody(x, y, n);                                                                                        \
+    }                                                                                                                   \
+    target static f64 axpyNorm_##suffix(f64* z, const f64* x, f64 a, const f64* y, u64 n){                              \
+        return axpyNormBody(z, x, a, y, n);                                                                             \
+    }                                                                                                                   \
+    target static void stencil5_##suffix(f64* y, const f64* d, const f64* c, const f64* u,                              \
+                                         f64 centre, f64 sideX, f64 sideY, u64 a, u64 b){                              \
+        stencil5Body(y, d, c, u, centre, sideX, sideY, a, b);                                                           \
+    }                                                                                                                   \
+    target static void stencil5Variable_##suffix(f64* y, const f64* d, const f64* c, const f64* u, const f64* west,     \
+                                                 const f64* east, const f64* centreX, f64 cy, f64 s, f64 n,             \
+                                                 u64 a, u64 b){                                                         \
+        stencil5VariableBody(y, d, c, u, west, east, centreX, cy, s, n, a, b);                                          \
+    }                                                                                                                   \
+    target static void mehrstellen_##suffix(f64* y, const f64* d, const f64* c, const f64* u, f64 centre, f64 sideX,    \
+                                            f64 sideY, f64 diagonal, u64 a, u64 b){                                     \
+        mehrstellenBody(y, d, c, u, centre, sideX, sideY, diagonal, a, b);                                              \
+    }                                                                                                                   \
+    static const kernelTable table_##suffix = {symmetricRows_##suffix, dot_##suffix, axpyNorm_##suffix,                 \
+                                               stencil5_##suffix, stencil5Variable_##suffix, mehrstellen_##suffix};
+
+SIMD_VARIANT(generic, )
+#if SIMD_X86
+SIMD_VARIANT(avx2,   __attribute__((target("avx2,fma"))))
+SIMD_VARIANT(avx512, __attribute__((target("avx512f,avx2,fma"))))
+static const kernelTable* const tables[ISA_COUNT] = {&table_generic, &table_avx2, &table_avx512};
+#else
+static const kernelTable* const tables[ISA_COUNT] = {&table_generic, nullptr, nullptr};
+#endif
+
+static const char* const names[ISA_COUNT] = {SIMD_X86 ? "sse2" : "generic", "avx2", "avx512"};
+
+/**< Level pinned by force(), -1 if none */
+static std::atomic<i32> forced(-1);
+
+
+
+const char* isaName(isaLevel level){
+    return level < ISA_COUNT ? names[level] : "unknown";
+}
+
+bool isaFromName(const char* name, isaLevel &level){
+    for (u32 k=0; k<ISA_COUNT; k++){
+        if (std::strcmp(name, names[k]) == 0 || (k == ISA_GENERIC && std::strcmp(name, "generic") == 0)){
+            level = isaLevel(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool supported(isaLevel level){
+#if SIMD_X86
+    // Checks the cpuid bits, and (for AVX) that the operating system saves the wide registers (xgetbv)
+    __builtin_cpu_init();
+    switch (level){
+        case ISA_GENERIC: return true;
+        case ISA_AVX2:    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case ISA_AVX512:  return __builtin_cpu_supports("avx512f") && supported(ISA_AVX2);
+        default:          return false;
+    }
+#else
+    return level == ISA_GENERIC;
+#endif
+}
+
+isaLevel detected(){
+    static const isaLevel level = [](){
+        u32 k = ISA_COUNT-1;
+        while (k > ISA_GENERIC && !supported(isaLevel(k))) k--;
+        DEBUG_MSG("SIMD kernels: %s", names[k]);
+        return isaLevel(k);
+    }();
+    return level;
+}
+
+isaLevel active(){
+    const i32 level = forced.load(std::memory_order_relaxed);
+    return level >= 0 ? isaLevel(level) : detected();
+}
+
+bool force(isaLevel level){
+    if (level >= ISA_COUNT || !supported(level)){
+        WARN_MSG("The %s kernels are not supported on this cpu, keeping %s", isaName(level), isaName(active()));
+        return false;
+    }
+    forced.store(level);
+    return true;
+}
+
+const kernelTable& kernels(){
+    return *tables[active()];
+}
+
+const kernelTable& kernels(isaLevel level){
+    CHECK_FATAL_ASSERT(level < ISA_COUNT && supported(level), "The requested SIMD level is not supported on this cpu.")
+    return *tables[level];
+}
+
+
+
+bool selfCheck(){
+
+    // Random data: a sparse matrix (up to 7 entries per column), vectors of odd size, and three lines of a stencil
+    std::mt19937_64 random(2024);
+    std::uniform_real_distribution<f64> uniform(-1., 1.);
+    const u64 n = 10007;
+    std::vector<i32> outer(n+1), inner;
+    std::vector<f64> value;
+    for (u64 i=0; i<n; i++){
+        outer[i] = inner.size();
+        for (i32 offset : {-101, -100, -1, 0, 1, 100, 101}){
+            const i64 k = (i64) i + offset;
+            if (k < 0 || k >= (i64) n || (offset != 0 && uniform(random) < -0.6)) continue;
+            inner.push_back(k);
+            value.push_back(offset == 0 ? 8. + uniform(random) : uniform(random));
+        }
+    }
+    outer[n] = inner.size();
+    auto vector = [&](){
+        std::vector<f64> v(n);
+        for (f64 &vi : v) vi = uniform(random);
+        return v;
+    };
+    const std::vector<f64> x = vector(), y = vector(), d = vector(), c = vector(), u = vector();
+    const std::vector<f64> west = vector(), east = vector(), centreX = vector();
+    const f64 a = uniform(random), w[4] = {4. + uniform(random), uniform(random), uniform(random), uniform(random)};
+
+    // Every kernel of a level, its outputs gathered in one vector
+    auto run = [&](const kernelTable &kernel){
+        std::vector<f64> out(5*n + 2, 0.), z(n);
+        kernel.symmetricRows(outer.data(), inner.data(), value.data(), nullptr, x.data(), out.data(), 0, n);
+        kernel.stencil5(out.data() + n, d.data(), c.data(), u.data(), w[0], w[1], w[2], 1, n-1);
+        kernel.stencil5Variable(out.data() + 2*n, d.data(), c.data(), u.data(), west.data(), east.data(), centreX.data(),
+                                w[0], w[1], w[2], 1, n-1);
+        kernel.mehrstellen(out.data() + 3*n, d.data(), c.data(), u.data(), w[0], w[1], w[2], w[3], 1, n-1);
+        const f64 norm = kernel.axpyNorm(z.data(), x.data(), a, y.data(), n);
+        std::copy(z.begin(), z.end(), out.begin() + 4*n);
+        out[5*n]   = kernel.dot(x.data(), y.data(), n);
+        out[5*n+1] = norm;
+        return out;
+    };
+    const std::vector<f64> reference = run(*tables[ISA_GENERIC]);
+
+    bool passed = true;
+    for (u32 k=0; k<ISA_COUNT; k++){
+        if (!supported(isaLevel(k))){
+            INFO_MSG("SIMD %-7s not supported on this cpu, skipped", names[k]);
+            continue;
+        }
+        const std::vector<f64> result = run(*tables[k]);
+        u64 differing = 0;
+        f64 difference = 0.;
+        for (u64 i=0; i<result.size(); i++){
+            if (std::memcmp(&result[i], &reference[i], sizeof(f64)) == 0) continue;
+            differing++;
+            difference = std::max(difference, std::abs(result[i] - reference[i]));
+        }
+        const bool agrees = differing == 0;
+        INFO_MSG("SIMD %-7s %llu of %llu results differ from %s (by up to %1.3e), %s", names[k], differing,
+                 (u64) result.size(), names[ISA_GENERIC], difference, agrees ? "passed" : "FAILED");
+        passed = passed && agrees;
+    }
+    return passed;
+}
+
+} // namespace Simd
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "definesStandard.hpp"
+
+/************************************************************************************************************************
+ *  @brief The vectorised kernels of the solvers, built for several instruction sets and picked at startup.
+ *
+ *  @details
+ *  The project is built without -march, such that one binary runs on every x86-64 node: the compiler then only
+ *  vectorises for SSE2 (2 doubles per instruction, no FMA). The kernels below are written once, as plain loops the
+ *  compiler vectorises, and compiled once per instruction set through the target attribute of GCC/Clang:
+ *    - ISA_GENERIC: the baseline of the build, SSE2 on x86-64 (NEON on AArch64, where it is part of the baseline).
+ *    - ISA_AVX2:    AVX2 + FMA, 4 doubles per instruction (Haswell, Zen and later).
+ *    - ISA_AVX512:  AVX-512F, 8 doubles per instruction (Skylake-SP, Ice Lake, Zen 4 and later).
+ *  The widest level the cpu (and the operating system, which needs to save the wide registers) supports is picked on
+ *  first use, from cpuid. simd.cpp is built with -ffp-contract=off: no level fuses a multiply and an add (which
+ *  rounds once where the generic kernels round twice), hence every level returns bitwise the results of the generic
+ *  one, only faster. force() pins a level, e.g. to time them against each other.
+ ************************************************************************************************************************/
+namespace Simd{
+
+/* list of instruction set levels the kernels are built for */
+typedef enum isaLevel{
+    ISA_GENERIC = 0, /**< baseline of the build (SSE2 on x86-64, NEON on AArch64) */
+    ISA_AVX2    = 1, /**< AVX2 (and FMA, never contracted) */
+    ISA_AVX512  = 2, /**< AVX-512F, with AVX2 and FMA */
+    ISA_COUNT   = 3, /**< number of levels */
+} isaLevel;
+
+/**< Simplistic structure holding the kernels of one instruction set level */
+struct kernelTable{
+
+    /**< Rows [begin, end) of y = A x for a symmetric A stored column-major (see executionPolicy::symmetricProduct) */
+    void (*symmetricRows)(const i32* outer, const i32* inner, const f64* value, const i32* nnz,
+                          const f64* x, f64* y, u64 begin, u64 end);
+
+    /**< Dot product x^T y of n rows */
+    f64 (*dot)(const f64* x, const f64* y, u64 n);
+
+    /**< z = x + a y, returning z^T z, in one pass over the three vectors of n rows */
+    f64 (*axpyNorm)(f64* z, const f64* x, f64 a, const f64* y, u64 n);
+
+    /**< Points [a, b) of a line of the uniform 5-point stencil, from the lines below (d), at (c) and above (u) */
+    void (*stencil5)(f64* y, const f64* d, const f64* c, const f64* u, f64 centre, f64 sideX, f64 sideY, u64 a, u64 b);
+
+    /**< Same as above, with the weights of every gridline in x, and the weights of the line (cy, s, n) in y */
+    void (*stencil5Variable)(f64* y, const f64* d, const f64* c, const f64* u, const f64* west, const f64* east,
+                             const f64* centreX, f64 cy, f64 s, f64 n, u64 a, u64 b);
+
+    /**< Same as above, for the uniform Mehrstellen 9-point stencil */
+    void (*mehrstellen)(f64* y, const f64* d, const f64* c, const f64* u, f64 centre, f64 sideX, f64 sideY,
+                        f64 diagonal, u64 a, u64 b);
+};
+
+/**< Name of a level, e.g. "avx2" */
+const char* isaName(isaLevel level);
+
+/**< Finds a level by its name, returns false if there is none */
+bool isaFromName(const char* name, isaLevel &level);
+
+/**< Whether the cpu and the operating system support a level (and the binary was built with it) */
+bool supported(isaLevel level);
+
+/**< Widest supported level */
+isaLevel detected();
+
+/**< Level the kernels run at, detected() unless forced */
+isaLevel active();
+
+/**< Pins the kernels to a supported level, returns false (keeping the active one) if it is not supported */
+bool force(isaLevel level);
+
+/**< Kernels of the active level */
+const kernelTable& kernels();
+
+/**< Kernels of a given level, which needs to be supported */
+const kernelTable& kernels(isaLevel level);
+
+/************************************************************************************************************************
+ *  @brief Runs every kernel of every supported level on the same random data, and compares them to ISA_GENERIC.
+ *
+ *  @details
+ *  The sizes are odd, such that the remainder loops after the vectorised ones are exercised too. The results of a level
+ *  need to be bitwise those of the generic kernels: the deterministic reductions, and the solutions computed on
+ *  different cpus, rely on it. Registered with ctest (test simd).
+ *
+ *  @return whether every level agrees bitwise with ISA_GENERIC.
+ ************************************************************************************************************************/
+bool selfCheck();
+
+} // namespace Simd
@@ -0,0 +1,403 @@
+#include "CoreIncludes.hpp"
+#include "sparseFile.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace IO{
+
+/**< Header of a binary sparse matrix file, 64 bytes */
+struct sparseHeader{
+    char magic[4];
+    u32 version, rowMajor, indexBytes;
+    u64 rows, cols, nnz, outerOffset, innerOffset, valueOffset;
+};
+STATIC_ASSERT(sizeof(sparseHeader) == 64, "The sparse file header should be 64 bytes.");
+
+/**< Header of a binary vector file, padded to 64 bytes */
+struct vectorHeader{
+    char magic[4];
+    u32 version, reserved[2];
+    u64 n, valueOffset;
+    u64 padding[4];
+};
+STATIC_ASSERT(sizeof(vectorHeader) == 64, "The vector file header should be 64 bytes.");
+
+static constexpr u64 blockAlignment = 64; /**< alignment of every array within a binary file */
+static u64 aligned(u64 offset) { return (offset + blockAlignment-1)/blockAlignment*blockAlignment; }
+
+/**< Writes bytes at an offset of the file, zero-padding up to it */
+static void writeAt(std::ofstream &file, u64 offset, const void* data, u64 bytes){
+    static const char zeros[blockAlignment] = {};
+    const u64 position = file.tellp();
+    file.write(zeros, offset - position);
+    file.write(static_cast<const char*>(data), bytes);
+}
+
+template<typename Matrix> static bool writeCompressed(const char* fileName, const Matrix &matrix, bool rowMajor){
+
+    // Only the compressed storage maps onto Eigen::Map, an uncompressed matrix is written as its compressed copy
+    Matrix copy;
+    const Matrix* A = &matrix;
+    if (!matrix.isCompressed()){
+        copy = matrix;
+        copy.makeCompressed();
+        A = &copy;
+    }
+
+    // Every field set by name, the ones not written below zeroed
+    sparseHeader header{};
+    std::memcpy(header.magic, "FDMS", 4);
+    header.version    = 1;
+    header.rowMajor   = rowMajor;
+    header.indexBytes = sizeof(i32);
+    header.rows       = A->rows();
+    header.cols       = A->cols();
+    header.nnz        = A->nonZeros();
+    const u64 outerSize = A->outerSize() + 1;
+    header.outerOffset = aligned(sizeof(sparseHeader));
+    header.innerOffset = aligned(header.outerOffset + outerSize*sizeof(i32));
+    header.valueOffset = aligned(header.innerOffset + header.nnz*sizeof(i32));
+
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeAt(file, header.outerOffset, A->outerIndexPtr(), outerSize*sizeof(i32));
+    writeAt(file, header.innerOffset, A->innerIndexPtr(), header.nnz*sizeof(i32));
+    writeAt(file, header.valueOffset, A->valuePtr(),      header.nnz*sizeof(f64));
+    file.close();
+    if (file.fail()){
+        WARN_MSG("Could not write the sparse matrix file %s", fileName);
+        return false;
+    }
+    DEBUG_MSG("Wrote %s: %llu x %llu, %llu nonzeros (%s)", fileName, header.rows, header.cols, header.nnz,
+              rowMajor ? "CSR" : "CSC");
+    return true;
+}
+
+bool writeSparse(const char* fileName, const Eigen::SparseMatrix<f64> &A){
+    return writeCompressed(fileName, A, false);
+}
+
+bool writeSparse(const char* fileName, const Eigen::SparseMatrix<f64, Eigen::RowMajor> &A){
+    return writeCompressed(fileName, A, true);
+}
+
+bool writeVector(const char* fileName, const EigenDefs::Vector<f64> &v){
+    vectorHeader header{};
+    std::memcpy(header.magic, "FDMV", 4);
+    header.version     = 1;
+    header.n           = v.size();
+    header.valueOffset = aligned(sizeof(vectorHeader));
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeAt(file, header.valueOffset, v.data(), header.n*sizeof(f64));
+    file.close();
+    if (file.fail()){
+        WARN_MSG("Could not write the vector file %s", fileName);
+        return false;
+    }
+    return true;
+}
+
+
+
+mappedFile::~mappedFile(){
+    close();
+}
+
+void mappedFile::close(){
+    if (base != nullptr) munmap(base, bytes);
+    base     = nullptr;
+    bytes    = 0;
+    kind     = 0;
+    rowMajor = false;
+    rows = cols = nnz = 0;
+    outer = inner = nullptr;
+    values = nullptr;
+}
+
+bool mappedFile::open(const char* fileName){
+    close();
+
+    const int descriptor = ::open(fileName, O_RDONLY);
+    if (descriptor < 0){
+        WARN_MSG("Could not open %s", fileName);
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || (u64) status.st_size < 64){
+        WARN_MSG("%s is not a binary sparse matrix or vector file", fileName);
+        ::close(descriptor);
+        return false;
+    }
+    bytes = status.st_size;
+    base  = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor); // the mapping keeps the file alive
+    if (base == MAP_FAILED){
+        WARN_MSG("Could not map %s", fileName);
+        base  = nullptr;
+        bytes = 0;
+        return false;
+    }
+    const char* data = static_cast<const char*>(base);
+
+    // Every array needs to lie within the file, at an offset aligned for its type
+    auto fits = [&](u64 offset, u64 count, u64 size){
+        return offset % size == 0 && offset <= bytes && count <= (bytes - offset)/size;
+    };
+
+    // The column (row) starts of a compressed matrix need to run from 0 up to nnz without decreasing, and every inner
+    // index to lie within the other dimension: Eigen::Map reads them without any check
+    auto compressed = [](const i32* outer, u64 outerSize, const i32* inner, u64 innerSize, u64 nnz){
+        if (outer[0] != 0 || (u64) outer[outerSize-1] != nnz) return false;
+        for (u64 k=1; k<outerSize; k++){
+            if (outer[k] < outer[k-1]) return false;
+        }
+        for (u64 k=0; k<nnz; k++){
+            if (inner[k] < 0 || (u64) inner[k] >= innerSize) return false;
+        }
+        return true;
+    };
+    if (std::memcmp(data, "FDMS", 4) == 0){
+        sparseHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        const u64 outerSize = (header.rowMajor ? header.rows : header.cols) + 1;
+        const bool valid = header.version == 1 && header.indexBytes == sizeof(i32)
+                        && header.rows < (1ull << 31) && header.cols < (1ull << 31) && header.nnz < (1ull << 31)
+                        && fits(header.outerOffset, outerSize, sizeof(i32)) && fits(header.innerOffset, header.nnz, sizeof(i32))
+                        && fits(header.valueOffset, header.nnz, sizeof(f64))
+                        && compressed(reinterpret_cast<const i32*>(data + header.outerOffset), outerSize,
+                                      reinterpret_cast<const i32*>(data + header.innerOffset),
+                                      header.rowMajor ? header.cols : header.rows, header.nnz);
+        if (valid){
+            kind     = 'S';
+            rowMajor = header.rowMajor != 0;
+            rows     = header.rows;
+            cols     = header.cols;
+            nnz      = header.nnz;
+            outer    = reinterpret_cast<const i32*>(data + header.outerOffset);
+            inner    = reinterpret_cast<const i32*>(data + header.innerOffset);
+            values   = reinterpret_cast<const f64*>(data + header.valueOffset);
+        }
+    } else if (std::memcmp(data, "FDMV", 4) == 0){
+        vectorHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version == 1 && header.n < (1ull << 31) && fits(header.valueOffset, header.n, sizeof(f64))){
+            kind   = 'V';
+            rows   = header.n;
+            cols   = 1;
+            values = reinterpret_cast<const f64*>(data + header.valueOffset);
+        }
+    }
+    if (kind == 0){
+        WARN_MSG("%s is not a valid binary sparse matrix or vector file", fileName);
+        close();
+        return false;
+    }
+    DEBUG_MSG("Mapped %s: %llu x %llu%s", fileName, rows, cols, isMatrix() ? ", sparse" : "");
+    return true;
+}
+
+Eigen::Map< const Eigen::SparseMatrix<f64> > mappedFile::matrix() const{
+    CHECK_FATAL_ASSERT(isMatrix() && !rowMajor, "No column-major sparse matrix is mapped.")
+    return Eigen::Map< const Eigen::SparseMatrix<f64> >(rows, cols, nnz, outer, inner, values);
+}
+
+Eigen::Map< const Eigen::SparseMatrix<f64, Eigen::RowMajor> > mappedFile::rowMajorMatrix() const{
+    CHECK_FATAL_ASSERT(isMatrix() && rowMajor, "No row-major sparse matrix is mapped.")
+    return Eigen::Map< const Eigen::SparseMatrix<f64, Eigen::RowMajor> >(rows, cols, nnz, outer, inner, values);
+}
+
+Eigen::Map< const EigenDefs::Vector<f64> > mappedFile::vector() const{
+    CHECK_FATAL_ASSERT(isVector(), "No vector is mapped.")
+    return Eigen::Map< const EigenDefs::Vector<f64> >(values, rows);
+}
+
+
+
+bool writeMatrixMarket(const char* fileName, const Eigen::SparseMatrix<f64> &A, bool symmetric){
+
+    // Entries listed column by column, the lower triangle only for a symmetric matrix
+    u64 entries = 0;
+    for (i32 k=0; k<A.outerSize(); k++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, k); it; ++it) entries += !symmetric || it.row() >= it.col();
+    }
+
+    std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+    file << "%%MatrixMarket matrix coordinate real " << (symmetric ? "symmetric" : "general") << "\n";
+    file << A.rows() << " " << A.cols() << " " << entries << "\n";
+    char line[64];
+    for (i32 k=0; k<A.outerSize(); k++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, k); it; ++it){
+            if (symmetric && it.row() < it.col()) continue;
+            const i32 length = snprintf(line, sizeof(line), "%d %d %.17g\n", (i32) it.row()+1, (i32) it.col()+1, it.value());
+            file.write(line, length);
+        }
+    }
+    file.close();
+    if (file.fail()){
+        WARN_MSG("Could not write the MatrixMarket file %s", fileName);
+        return false;
+    }
+    return true;
+}
+
+bool writeMatrixMarket(const char* fileName, const EigenDefs::Vector<f64> &v){
+    std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+    file << "%%MatrixMarket matrix array real general\n";
+    file << v.size() << " 1\n";
+    char line[32];
+    for (u64 i=0; i<(u64) v.size(); i++){
+        const i32 length = snprintf(line, sizeof(line), "%.17g\n", v[i]);
+        file.write(line, length);
+    }
+    file.close();
+    if (file.fail()){
+        WARN_MSG("Could not write the MatrixMarket file %s", fileName);
+        return false;
+    }
+    return true;
+}
+
+/**< Simplistic structure holding the banner of a MatrixMarket file, and the size line following its comments */
+struct marketBanner{
+    std::string format, field, symmetry;
+    u64 rows = 0, cols = 0, entries = 0;
+};
+
+/**< Reads the banner and size line, leaving the file at the first entry */
+static bool readBanner(std::ifstream &file, const char* fileName, marketBanner &banner){
+    std::string line, object;
+    if (!std::getline(file, line)){
+        WARN_MSG("Could not read %s", fileName);
+        return false;
+    }
+    for (char &c : line) c = std::tolower(c);
+    std::istringstream words(line);
+    std::string magic;
+    words >> magic >> object >> banner.format >> banner.field >> banner.symmetry;
+    if (magic != "%%matrixmarket" || object != "matrix"){
+        WARN_MSG("%s is not a MatrixMarket matrix file", fileName);
+        return false;
+    }
+
+    // Comments, then the sizes: rows cols entries (coordinate) or rows cols (array)
+    while (std::getline(file, line) && (line.empty() || line[0] == '%')) {}
+    std::istringstream sizes(line);
+    const bool read = banner.format == "coordinate" ? bool(sizes >> banner.rows >> banner.cols >> banner.entries)
+                                                    : bool(sizes >> banner.rows >> banner.cols);
+    if (!read || (banner.format != "coordinate" && banner.format != "array")){
+        WARN_MSG("%s has no valid size line", fileName);
+        return false;
+    }
+    if (banner.field == "complex"){
+        WARN_MSG("%s holds complex values, which are not supported", fileName);
+        return false;
+    }
+    return true;
+}
+
+bool readMatrixMarket(const char* fileName, Eigen::SparseMatrix<f64> &A){
+    std::ifstream file(fileName);
+    marketBanner banner;
+    if (!readBanner(file, fileName, banner)) return false;
+    if (banner.format != "coordinate"){
+        WARN_MSG("%s is not in the coordinate format of a sparse matrix", fileName);
+        return false;
+    }
+
+    const bool pattern   = banner.field == "pattern";
+    const bool mirrored  = banner.symmetry == "symmetric" || banner.symmetry == "skew-symmetric" || banner.symmetry == "hermitian";
+    const f64  signOther = banner.symmetry == "skew-symmetric" ? -1. : 1.;
+    std::vector< Eigen::Triplet<f64> > triplets;
+    triplets.reserve(mirrored ? 2*banner.entries : banner.entries);
+
+    // Parsed with strtod/strtoull rather than streams, which are several times slower on large files
+    std::string line;
+    u64 read = 0;
+    while (read < banner.entries && std::getline(file, line)){
+        if (line.empty() || line[0] == '%') continue;
+        char* cursor = line.data();
+        char* end;
+        const u64 i = std::strtoull(cursor, &end, 10);
+        const bool hasRow = end != cursor;
+        cursor = end;
+        const u64 j = std::strtoull(cursor, &end, 10);
+        const bool hasCol = end != cursor;
+        cursor = end;
+        f64 value = 1.;
+        if (!pattern){
+            value = std::strtod(cursor, &end);
+            if (end == cursor){
+                WARN_MSG("%s: entry %llu has no value", fileName, read+1);
+                return false;
+            }
+        }
+        if (!hasRow || !hasCol || i < 1 || j < 1 || i > banner.rows || j > banner.cols){
+            WARN_MSG("%s: entry %llu is out of range", fileName, read+1);
+            return false;
+        }
+        triplets.emplace_back(i-1, j-1, value);
+        if (mirrored && i != j) triplets.emplace_back(j-1, i-1, signOther*value);
+        read++;
+    }
+    if (read != banner.entries){
+        WARN_MSG("%s ends after %llu of its %llu entries", fileName, read, banner.entries);
+        return false;
+    }
+
+    A.resize(banner.rows, banner.cols);
+    A.setFromTriplets(triplets.begin(), triplets.end());
+    A.makeCompressed();
+    return true;
+}
+
+bool readMatrixMarket(const char* fileName, EigenDefs::Vector<f64> &v){
+    std::ifstream file(fileName);
+    marketBanner banner;
+    if (!readBanner(file, fileName, banner)) return false;
+    if (banner.cols != 1){
+        WARN_MSG("%s holds a %llu x %llu matrix, not a vector", fileName, banner.rows, banner.cols);
+        return false;
+    }
+
+    // A coordinate vector is a sparse n x 1 matrix
+    if (banner.format == "coordinate"){
+        Eigen::SparseMatrix<f64> column;
+        if (!readMatrixMarket(fileName, column)) return false;
+        v = EigenDefs::Vector<f64>(column.col(0));
+        return true;
+    }
+
+    EigenDefs::Vector<f64> values(banner.rows);
+    std::string line;
+    u64 read = 0;
+    while (read < banner.rows && std::getline(file, line)){
+        if (line.empty() || line[0] == '%') continue;
+        char* end;
+        values[read] = std::strtod(line.c_str(), &end);
+        if (end == line.c_str()){
+            WARN_MSG("%s: value %llu does not parse", fileName, read+1);
+            return false;
+        }
+        read++;
+    }
+    if (read != banner.rows){
+        WARN_MSG("%s ends after %llu of its %llu values", fileName, read, banner.rows);
+        return false;
+    }
+    v = std::move(values);
+    return true;
+}
+
+} // namespace IO
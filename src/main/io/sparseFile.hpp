@@ -0,0 +1,157 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+
+#include <string>
+
+namespace IO{
+
+/************************************************************************************************************************
+ *  @brief Writes a sparse matrix (CSC, or CSR for row-major matrices) to a binary file that maps back without parsing.
+ *
+ *  @details
+ *  The binary file holds data in the form:
+ *
+ *  char[4] u32     u32       u32         u64   u64   u64  u64          u64          u64
+ *  "FDMS"  version rowMajor  indexBytes  rows  cols  nnz  outerOffset  innerOffset  valueOffset
+ *
+ *  i.e. a 64-byte header, followed by the three arrays of the compressed storage of Eigen at the given offsets (each a
+ *  multiple of 64 bytes): i32 outer[outerSize+1], i32 inner[nnz] and f64 values[nnz], outerSize being cols for CSC and
+ *  rows for CSR, in the byte order of the machine. version = 1 and indexBytes = 4. Non-compressed matrices are written
+ *  as their compressed copy.
+ *
+ *  @param fileName name of the binary file, overwritten.
+ *  @param A        reference to the sparse matrix.
+ *
+ *  @return whether the file was written.
+ ************************************************************************************************************************/
+bool writeSparse(const char* fileName, const Eigen::SparseMatrix<f64> &A);
+
+/**< Same as above, for a row-major (CSR) matrix, e.g. the incomplete Cholesky factor */
+bool writeSparse(const char* fileName, const Eigen::SparseMatrix<f64, Eigen::RowMajor> &A);
+
+/************************************************************************************************************************
+ *  @brief Writes a vector to a binary file that maps back without parsing.
+ *
+ *  @details
+ *  char[4] u32     u32  u32  u64  u64          (padding up to 64 bytes)  f64[n]
+ *  "FDMV"  version 0    0    n    valueOffset                            values
+ *
+ *  @param fileName name of the binary file, overwritten.
+ *  @param v        reference to the vector.
+ *
+ *  @return whether the file was written.
+ ************************************************************************************************************************/
+bool writeVector(const char* fileName, const EigenDefs::Vector<f64> &v);
+
+
+
+/************************************************************************************************************************
+ *  @brief A binary sparse matrix or vector file (see writeSparse, writeVector), memory-mapped read-only.
+ *
+ *  @details
+ *  Opening a file checks its header and that the arrays lie within the file, and maps it: the pages are only read
+ *  (from the page cache, shared with every other process mapping the file) when the values are first touched. The
+ *  Eigen maps returned point straight into the mapping, and stay valid until the file is closed or destroyed. Products
+ *  and the other read-only expressions work on them directly; the solvers, which take an Eigen::SparseMatrix, need a
+ *  copy (Eigen::SparseMatrix<f64> A = file.matrix(), three memcpy).
+ ************************************************************************************************************************/
+class mappedFile{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction, nothing mapped */
+        mappedFile() = default;
+
+        /**< Unmaps the file */
+        ~mappedFile();
+
+        /**< Disabled construction using another mapped file */
+        mappedFile(const mappedFile&) = delete;
+
+        /**< Disabled construction by equating to another mapped file */
+        mappedFile& operator =(const mappedFile&) = delete;
+
+        /**< Maps a binary sparse matrix or vector file (closing the previous one), returns false if it is not a valid one:
+             every array within the file, the compressed indices consistent and within the size of the matrix */
+        bool open(const char* fileName);
+
+        /**< Unmaps the file, invalidating the maps returned */
+        void close();
+
+        /**< Whether a sparse matrix is mapped */
+        bool isMatrix() const { return kind == 'S'; }
+
+        /**< Whether a vector is mapped */
+        bool isVector() const { return kind == 'V'; }
+
+        /**< Whether the mapped matrix is stored row-major (CSR) */
+        bool isRowMajor() const { return rowMajor; }
+
+        /**< Mapped column-major (CSC) matrix, which needs isMatrix() && !isRowMajor() */
+        Eigen::Map< const Eigen::SparseMatrix<f64> > matrix() const;
+
+        /**< Mapped row-major (CSR) matrix, which needs isMatrix() && isRowMajor() */
+        Eigen::Map< const Eigen::SparseMatrix<f64, Eigen::RowMajor> > rowMajorMatrix() const;
+
+        /**< Mapped vector, which needs isVector() */
+        Eigen::Map< const EigenDefs::Vector<f64> > vector() const;
+
+    private:
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        void* base = nullptr;           /**< start of the mapping */
+        u64 bytes = 0;                  /**< size of the mapping */
+        char kind = 0;                  /**< 'S' for a sparse matrix, 'V' for a vector, 0 if nothing is mapped */
+        bool rowMajor = false;          /**< storage order of the matrix */
+        u64 rows = 0, cols = 0;         /**< size of the matrix, or (n, 1) for a vector */
+        u64 nnz = 0;                    /**< number of stored entries of the matrix */
+        const i32* outer = nullptr;     /**< compressed outer indices */
+        const i32* inner = nullptr;     /**< row (CSC) or column (CSR) index of every entry */
+        const f64* values = nullptr;    /**< values of the entries, or of the vector */
+
+};
+
+
+
+/************************************************************************************************************************
+ *  @brief Writes a sparse matrix in the MatrixMarket coordinate format, for other solvers (SciPy, Matlab, PETSc, ...).
+ *
+ *  @details
+ *  The header is "%%MatrixMarket matrix coordinate real general", or "... real symmetric" with only the lower
+ *  triangle listed when symmetric is set (the matrix is then assumed symmetric, not checked). Indices are 1-based and
+ *  values printed with 17 significant digits, such that they read back exactly.
+ *
+ *  @param fileName  name of the text file, overwritten.
+ *  @param A         reference to the sparse matrix.
+ *  @param symmetric whether to write the lower triangle only, as a symmetric matrix.
+ *
+ *  @return whether the file was written.
+ ************************************************************************************************************************/
+bool writeMatrixMarket(const char* fileName, const Eigen::SparseMatrix<f64> &A, bool symmetric = false);
+
+/**< Writes a vector in the MatrixMarket array format (a dense n x 1 matrix), returns whether the file was written */
+bool writeMatrixMarket(const char* fileName, const EigenDefs::Vector<f64> &v);
+
+/************************************************************************************************************************
+ *  @brief Reads a sparse matrix in the MatrixMarket coordinate format.
+ *
+ *  @details
+ *  Real, integer and pattern (all values 1) entries are read, in general, symmetric and skew-symmetric storage (the
+ *  other triangle being mirrored). Duplicate entries are summed. A malformed file is reported and leaves A unchanged.
+ *
+ *  @param fileName name of the text file.
+ *  @param A        reference to the sparse matrix, resized and overwritten (compressed).
+ *
+ *  @return whether the file was read.
+ ************************************************************************************************************************/
+bool readMatrixMarket(const char* fileName, Eigen::SparseMatrix<f64> &A);
+
+/**< Reads a vector in the MatrixMarket array format (n x 1) or coordinate format (n x 1, missing entries 0) */
+bool readMatrixMarket(const char* fileName, EigenDefs::Vector<f64> &v);
+
+} // namespace IO
@@ -0,0 +1,232 @@
+#include "CoreIncludes.hpp"
+#include "tiledFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if COMPRESSION_ENABLED == 1
+#include <zlib.h>
+#endif
+
+namespace IO{
+
+/**< Simplistic structure holding one entry of the tile index, as written to the file */
+struct tileEntry{
+    u32 field, tile, codec, padding;
+    u64 offset, bytes;
+    f64 base, step;
+};
+STATIC_ASSERT(sizeof(tileEntry) == 48, "tile index entries should be 48 byte.");
+
+/**< Groups byte k of every (size-byte) value together, out[k*n + v] = in[v*size + k] */
+static void shuffle(const u8* in, u8* out, u64 n, u32 size){
+    for (u64 v=0; v<n; v++){
+        for (u32 k=0; k<size; k++) out[k*n + v] = in[v*size + k];
+    }
+}
+
+#if COMPRESSION_ENABLED == 1
+/**< Shuffles and deflates n values of 4 bytes, returns false if zlib failed */
+static bool deflateTile(const void* values, u64 n, i32 level, std::vector<u8> &shuffled, std::vector<u8> &out){
+    shuffled.resize(4*n);
+    shuffle((const u8*) values, shuffled.data(), n, 4);
+    uLongf bytes = compressBound(shuffled.size());
+    out.resize(bytes);
+    if (compress2(out.data(), &bytes, shuffled.data(), shuffled.size(), level) != Z_OK) return false;
+    out.resize(bytes);
+    return true;
+}
+#endif
+
+std::vector<namedField> solutionFields(EigenDefs::Array2D<f64> &&field, PostProcess::derivedFields &&derived){
+    std::vector<namedField> fields;
+    fields.push_back({"u",        std::move(field)});
+    fields.push_back({"dudx",     std::move(derived.dudx)});
+    fields.push_back({"dudy",     std::move(derived.dudy)});
+    fields.push_back({"residual", std::move(derived.residual)});
+    fields.push_back({"curl",     std::move(derived.curl)});
+    if (derived.error.size() != 0) fields.push_back({"error", std::move(derived.error)});
+    return fields;
+}
+
+bool writeTiles(const char* fileName,
+                const Mesh::gridStruct &grid,
+                const std::vector<namedField> &fields,
+                const tileSettings &settings){
+
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    const u32 tileRows = std::min(settings.tileRows, jmax);
+    const u32 tileCols = std::min(settings.tileCols, imax);
+    const u32 nTileRows = (jmax + tileRows-1)/tileRows;
+    const u32 nTileCols = (imax + tileCols-1)/tileCols;
+    CHECK_FATAL_ASSERT(tileRows > 0 && tileCols > 0, "Tiles need at least one gridpoint.")
+    for (const namedField &field : fields){
+        CHECK_FATAL_ASSERT(field.values.rows() == jmax && field.values.cols() == imax, "Field does not match the grid.")
+        CHECK_FATAL_ASSERT(field.name.size() < 16, "Field names are at most 15 characters.")
+    }
+
+    tileCodec codec = settings.codec;
+#if COMPRESSION_ENABLED != 1
+    if (codec != CODEC_RAW) WARN_MSG("Built without zlib, writing %s uncompressed", fileName);
+    codec = CODEC_RAW;
+#endif
+
+    // Header, the index offset is filled in once the tiles are written
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()){
+        WARN_MSG("Could not open the tiled file %s", fileName);
+        return false;
+    }
+    const u32 header[7] = {1, jmax, imax, (u32) fields.size(), tileRows, tileCols, (u32) codec};
+    u64 indexOffset = 0;
+    file.write("FDMT", 4);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    for (const namedField &field : fields){
+        char padded[16] = {};
+        std::strncpy(padded, field.name.c_str(), sizeof(padded)-1);
+        file.write(padded, sizeof(padded));
+    }
+    file.write(reinterpret_cast<const char*>(grid.x.data()), imax*sizeof(f64));
+    file.write(reinterpret_cast<const char*>(grid.y.data()), jmax*sizeof(f64));
+
+    // Tiles, every one gathered row by row out of the column-major field
+    std::vector<tileEntry> index;
+    index.reserve(fields.size()*nTileRows*nTileCols);
+    std::vector<f32> values((u64) tileRows*tileCols);
+    std::vector<u32> quantized((u64) tileRows*tileCols);
+    std::vector<u8>  shuffled, encoded;
+    u64 offset = file.tellp();
+    for (u32 f=0; f<fields.size(); f++){
+        const EigenDefs::Array2D<f64> &field = fields[f].values;
+        const f64 step = 2.*settings.tolerance*std::max(field.abs().maxCoeff(), 1e-300);
+
+        for (u32 tr=0; tr<nTileRows; tr++){
+            for (u32 tc=0; tc<nTileCols; tc++){
+                const u32 j0 = tr*tileRows, j1 = std::min(j0+tileRows, jmax);
+                const u32 i0 = tc*tileCols, i1 = std::min(i0+tileCols, imax);
+                const u64 n  = (u64) (j1-j0)*(i1-i0);
+
+                tileEntry entry{f, tr*nTileCols + tc, CODEC_RAW, 0, offset, 0, 0., 0.};
+                const char* data = reinterpret_cast<const char*>(values.data());
+                u64 bytes = n*sizeof(f32);
+                for (u32 j=j0; j<j1; j++){
+                    for (u32 i=i0; i<i1; i++) values[(u64) (j-j0)*(i1-i0) + (i-i0)] = (f32) field(j,i);
+                }
+
+#if COMPRESSION_ENABLED == 1
+                // Quantized, if the range of the tile fits in u32, lossless otherwise
+                const auto block = field.block(j0, i0, j1-j0, i1-i0);
+                bool stored = false;
+                if (codec == CODEC_QUANTIZED && (block.maxCoeff() - block.minCoeff())/step < 4e9){
+                    const f64 base = block.minCoeff();
+                    u32 previous = 0;
+                    for (u32 j=j0; j<j1; j++){
+                        for (u32 i=i0; i<i1; i++){
+                            u32 q = (u32) std::llround((field(j,i) - base)/step);
+                            quantized[(u64) (j-j0)*(i1-i0) + (i-i0)] = q - previous;
+                            previous = q;
+                        }
+                    }
+                    if (deflateTile(quantized.data(), n, settings.level, shuffled, encoded)){
+                        entry.codec = CODEC_QUANTIZED;
+                        entry.base  = base;
+                        entry.step  = step;
+                        stored      = true;
+                    }
+                }
+                if (!stored && codec != CODEC_RAW && deflateTile(values.data(), n, settings.level, shuffled, encoded)){
+                    entry.codec = CODEC_LOSSLESS;
+                    stored      = true;
+                }
+                if (stored){
+                    data  = reinterpret_cast<const char*>(encoded.data());
+                    bytes = encoded.size();
+                }
+#endif
+                file.write(data, bytes);
+                entry.bytes = bytes;
+                offset     += bytes;
+                index.push_back(entry);
+            }
+        }
+    }
+
+    // Index, and its offset in the header
+    file.write(reinterpret_cast<const char*>(index.data()), index.size()*sizeof(tileEntry));
+    file.seekp(4 + sizeof(header));
+    file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    file.close();
+    if (file.fail()){
+        WARN_MSG("Could not write the tiled file %s", fileName);
+        return false;
+    }
+
+    const u64 raw = fields.size()*(u64) jmax*imax*sizeof(f32);
+    DEBUG_MSG("Wrote %s: %u fields, %u tiles each, %llu bytes (%.1f%% of raw f32)",
+              fileName, (u32) fields.size(), nTileRows*nTileCols, offset, 100.*offset/raw);
+    return true;
+}
+
+
+
+asyncExport::asyncExport(const tileSettings &settings) : settings(settings), submitted(0), stopping(false) {
+    writer = std::thread(&asyncExport::work, this);
+}
+
+asyncExport::~asyncExport(){
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+u64 asyncExport::submit(const std::string &fileName, const Mesh::gridStruct &grid, std::vector<namedField> &&fields){
+    u64 ticket;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        ticket = submitted++;
+        jobs.push_back(job{ticket, fileName, grid, std::move(fields)});
+    }
+    wake.notify_one();
+    return ticket;
+}
+
+std::vector<failedExport> asyncExport::wait(){
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this]{ return jobs.empty(); });
+    std::vector<failedExport> reported;
+    reported.swap(failed);
+    return reported;
+}
+
+u32 asyncExport::pending(){
+    std::unique_lock<std::mutex> guard(lock);
+    return jobs.size();
+}
+
+void asyncExport::work(){
+    std::unique_lock<std::mutex> guard(lock);
+    while (true){
+        // The queue is drained before stopping, such that no submitted export is lost. A job stays queued while it is
+        // written (deque references survive push_back), such that wait() returns only once it is on disk
+        wake.wait(guard, [this]{ return stopping || !jobs.empty(); });
+        if (jobs.empty()) return;
+
+        job &current = jobs.front();
+        guard.unlock();
+        bool written = writeTiles(current.fileName.c_str(), current.grid, current.fields, settings);
+        guard.lock();
+
+        if (!written) failed.push_back(failedExport{current.ticket, current.fileName});
+        jobs.pop_front();
+        idle.notify_all();
+    }
+}
+
+} // namespace IO
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh/mesh.hpp"
+#include "post/derivedFields.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace IO{
+
+/* list of the ways a tile can be encoded */
+typedef enum tileCodec{
+    CODEC_RAW       = 0, /**< f32 values, as is */
+    CODEC_LOSSLESS  = 1, /**< f32 values, byte-shuffled and deflated (zlib) */
+    CODEC_QUANTIZED = 2, /**< values rounded to a multiple of 2*bound (error <= bound), delta-coded, byte-shuffled and deflated */
+} tileCodec;
+
+/**< Simplistic structure holding how a tiled file is written */
+struct tileSettings{
+    tileCodec codec = CODEC_RAW;    /**< encoding of the tiles, falls back to CODEC_RAW if built without zlib */
+    f64 tolerance   = 1e-5;         /**< CODEC_QUANTIZED: max error, relative to the max |value| of each field */
+    u32 tileRows    = 256;          /**< tile size in y */
+    u32 tileCols    = 256;          /**< tile size in x */
+    i32 level       = 1;            /**< zlib compression level, 1 (fast) to 9 (small) */
+};
+
+/**< Simplistic structure holding one full-grid field f(j,i) and its name (at most 15 characters) */
+struct namedField{
+    std::string name;
+    EigenDefs::Array2D<f64> values;
+};
+
+/************************************************************************************************************************
+ *  @brief Collects the solution and its derived fields into a list of named fields, taking over their memory.
+ *
+ *  @param field   full-grid solution u(j,i), moved from.
+ *  @param derived fields derived from u, moved from.
+ *
+ *  @return fields u, dudx, dudy, residual, curl and (if present) error.
+ ************************************************************************************************************************/
+std::vector<namedField> solutionFields(EigenDefs::Array2D<f64> &&field, PostProcess::derivedFields &&derived);
+
+/************************************************************************************************************************
+ *  @brief Writes full-grid fields as a tiled file, read by the Python postprocessing (src/post/binaryData.py).
+ *
+ *  @details
+ *  Every field is cut in tiles of (tileRows, tileCols) gridpoints, each tile being encoded on its own. An index at
+ *  the end of the file holds where every tile starts, such that a sub-region can be read without touching the rest of
+ *  the file. The file holds data in the form:
+ *
+ *  char[4] u32     u32  u32  u32     u32      u32      u32     u64           char[16]*nFields  f64[imax] f64[jmax]
+ *  "FDMT"  version jmax imax nFields tileRows tileCols codec   indexOffset   names             x         y
+ *
+ *  followed by the tiles, and the index at indexOffset: one entry per (field, tile), field-major, tiles row by row,
+ *
+ *  u32    u32   u32    u32   u64     u64     f64    f64
+ *  field  tile  codec  0     offset  bytes   base   step
+ *
+ *  A tile holds its values row by row. Raw tiles are f32. Lossless tiles are f32 with the k-th byte of every value
+ *  grouped together (which makes the exponent bytes of a smooth field compress well), then deflated. Quantized tiles
+ *  store q = round((value - base)/step) as u32, with step = 2*tolerance*max|field|, replaced by the difference to the
+ *  previous q (mod 2^32), then shuffled and deflated like the lossless ones. A quantized tile whose range does not fit
+ *  in u32 is stored lossless instead, the codec of every entry tells which one was used.
+ *
+ *  @param fileName name of the tiled file, overwritten.
+ *  @param grid     reference to the gridpoints.
+ *  @param fields   reference to the fields to write, all of size (jmax,imax).
+ *  @param settings reference to the tile size and encoding.
+ *
+ *  @return true if the file was written, false (with a warning) if it could not be opened or written.
+ ************************************************************************************************************************/
+bool writeTiles(const char* fileName,
+                const Mesh::gridStruct &grid,
+                const std::vector<namedField> &fields,
+                const tileSettings &settings);
+
+/**< Simplistic structure holding an export that could not be written */
+struct failedExport{
+    u64 ticket;             /**< number of the export, as returned by asyncExport::submit */
+    std::string fileName;   /**< name of the file that could not be written */
+};
+
+
+
+/************************************************************************************************************************
+ *  @brief Writes tiled files from a background thread, such that the export overlaps with whatever comes next.
+ *
+ *  @details
+ *  A submitted export takes over the fields (move them in), so the caller can go on with the next case straight away.
+ *  Exports are written one after the other, in the order they were submitted. An export that cannot be written is
+ *  warned about and recorded, wait() hands the record over, the writer thread carries on with the next one. The
+ *  destructor waits for every pending export, hence the process only exits once its files are complete.
+ ************************************************************************************************************************/
+class asyncExport{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction starts the writer thread, writing every file with the given settings */
+        asyncExport(const tileSettings &settings = tileSettings{});
+
+        /**< Waits for every pending export, and stops the writer thread */
+        ~asyncExport();
+
+        /**< Disabled construction using another exporter */
+        asyncExport(const asyncExport&) = delete;
+
+        /**< Disabled construction by equating to another exporter */
+        asyncExport& operator =(const asyncExport&) = delete;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Queues an export, and returns immediately.
+         *
+         *  @param fileName name of the tiled file, overwritten once the export runs.
+         *  @param grid     gridpoints, copied.
+         *  @param fields   fields to write, moved from.
+         *
+         *  @return number of the export (its ticket), counting from 0.
+         ************************************************************************************************************************/
+        u64 submit(const std::string &fileName, const Mesh::gridStruct &grid, std::vector<namedField> &&fields);
+
+        /**< Blocks until every export submitted so far is written, returns the ones that failed since the previous wait */
+        std::vector<failedExport> wait();
+
+        /**< Number of exports queued or being written */
+        u32 pending();
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        /**< Simplistic structure holding one queued export */
+        struct job{
+            u64 ticket;
+            std::string fileName;
+            Mesh::gridStruct grid;
+            std::vector<namedField> fields;
+        };
+
+        void work();
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        tileSettings settings;            /**< tile size and encoding of every file */
+        std::deque<job> jobs;             /**< queued exports, the front one being written */
+        std::vector<failedExport> failed; /**< exports that could not be written, not yet handed over by wait() */
+        u64 submitted;                    /**< number of exports submitted so far, the ticket of the next one */
+        bool stopping;                    /**< set when the writer needs to exit */
+        std::mutex lock;                  /**< guards jobs, failed, submitted and stopping */
+        std::condition_variable wake;     /**< signals the writer that a job was queued (or that it needs to stop) */
+        std::condition_variable idle;     /**< signals waiters that a job was written */
+        std::thread writer;               /**< background thread, started last */
+
+};
+
+} // namespace IO
@@ -0,0 +1,333 @@
+#include "CoreIncludes.hpp"
+#include "adaptive.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Mesh{
+
+adaptiveGrid::adaptiveGrid(const gridStruct &base, const sourceFunction &boundary, u32 patchCells, u32 maxLevel)
+    : base(base), boundary(boundary), patchCells(patchCells), maxLevel(maxLevel) {
+
+    const u32 nx = base.x.size()-1;
+    const u32 ny = base.y.size()-1;
+    CHECK_FATAL_ASSERT(patchCells >= 2 && nx % patchCells == 0 && ny % patchCells == 0,
+                       "The cells of the base grid need to be a multiple of the patch size in x and y.")
+    CHECK_FATAL_ASSERT(maxLevel <= 16 && ((u64) nx << maxLevel) < (1u << 28) && ((u64) ny << maxLevel) < (1u << 28),
+                       "The finest level of the adaptive grid is too fine.")
+    NX = nx << maxLevel;
+    NY = ny << maxLevel;
+
+    for (u32 pj=0; pj<ny/patchCells; pj++){
+        for (u32 pi=0; pi<nx/patchCells; pi++){
+            tree[patchKey(0, pi, pj)] = true;
+        }
+    }
+    build();
+}
+
+u32 adaptiveGrid::depth() const{
+    u32 level = 0;
+    for (const patch &leaf : leafPatches) level = std::max(level, leaf.level);
+    return level;
+}
+
+f64 adaptiveGrid::xOf(u32 I) const{
+    const u32 i = I >> maxLevel, r = I & ((1u << maxLevel)-1);
+    if (r == 0) return base.x[i];
+    return base.x[i] + (base.x[i+1] - base.x[i])*r/(f64) (1u << maxLevel);
+}
+
+f64 adaptiveGrid::yOf(u32 J) const{
+    const u32 j = J >> maxLevel, r = J & ((1u << maxLevel)-1);
+    if (r == 0) return base.y[j];
+    return base.y[j] + (base.y[j+1] - base.y[j])*r/(f64) (1u << maxLevel);
+}
+
+bool adaptiveGrid::findNode(u32 I, u32 J, u32 &id) const{
+    if (I > NX || J > NY) return false;
+    auto found = nodeIndex.find(nodeKey(I, J));
+    if (found == nodeIndex.end()) return false;
+    id = found->second;
+    return true;
+}
+
+void adaptiveGrid::build(){
+
+    // Leaves, level by level then row by row, such that the numbering does not depend on the hashing
+    leafPatches.clear();
+    for (const auto &[key, leaf] : tree){
+        if (leaf) leafPatches.push_back(patch{(u32) (key >> 56), (u32) (key & ((1u << 28)-1)), (u32) ((key >> 28) & ((1u << 28)-1))});
+    }
+    std::sort(leafPatches.begin(), leafPatches.end(), [](const patch &a, const patch &b){
+        return a.level != b.level ? a.level < b.level : (a.pj != b.pj ? a.pj < b.pj : a.pi < b.pi);
+    });
+
+    // Nodes: the vertices of the leaf cells, ordered by lattice row then column (a banded ordering of the unknowns)
+    std::vector<u64> keys;
+    for (const patch &leaf : leafPatches){
+        const u32 s = 1u << (maxLevel - leaf.level);
+        const u32 I0 = leaf.pi*patchCells*s, J0 = leaf.pj*patchCells*s;
+        for (u32 b=0; b<=patchCells; b++){
+            for (u32 a=0; a<=patchCells; a++) keys.push_back(nodeKey(I0 + a*s, J0 + b*s));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    nodes.assign(keys.size(), node{});
+    nodeIndex.clear();
+    nodeIndex.reserve(keys.size());
+    for (u32 id=0; id<keys.size(); id++){
+        nodes[id].I = keys[id] % (NX+1);
+        nodes[id].J = keys[id] / (NX+1);
+        nodes[id].type = NODE_UNKNOWN;
+        nodeIndex[keys[id]] = id;
+    }
+
+    // Hanging nodes: halfway along the cell edges on the sides of a patch, where a finer patch put a node
+    for (const patch &leaf : leafPatches){
+        const u32 s = 1u << (maxLevel - leaf.level);
+        if (s == 1) continue;
+        const i64 I0 = leaf.pi*patchCells*s, J0 = leaf.pj*patchCells*s, span = patchCells*s;
+
+        // Sides south, north, west, east: start corner and direction along the side
+        const i64 side[4][4] = {{I0, J0, 1, 0}, {I0, J0+span, 1, 0}, {I0, J0, 0, 1}, {I0+span, J0, 0, 1}};
+        for (const auto &[sI, sJ, dI, dJ] : side){
+            for (u32 k=0; k<patchCells; k++){
+                auto at = [&](i64 offset, u32 &id){
+                    const i64 I = sI + dI*offset, J = sJ + dJ*offset;
+                    return I >= 0 && J >= 0 && findNode(I, J, id);
+                };
+                u32 hanging, A, B, C;
+                if (!at(k*s + s/2, hanging) || !at(k*s, A) || !at((k+1)*s, B)) continue;
+                node &h = nodes[hanging];
+                if (h.I == 0 || h.I == NX || h.J == 0 || h.J == NY) continue;
+
+                // Quadratic through the coarse edge and the next coarse node beyond either end, linear otherwise
+                h.type = NODE_HANGING;
+                if (at((k+2)*s, C)){
+                    h.nParents = 3;
+                    h.parent[0] = A;     h.parent[1] = B;    h.parent[2] = C;
+                    h.weight[0] = 0.375; h.weight[1] = 0.75; h.weight[2] = -0.125;
+                } else if (at((i64) k*s - s, C)){
+                    h.nParents = 3;
+                    h.parent[0] = C;      h.parent[1] = A;    h.parent[2] = B;
+                    h.weight[0] = -0.125; h.weight[1] = 0.75; h.weight[2] = 0.375;
+                } else {
+                    h.nParents = 2;
+                    h.parent[0] = A;   h.parent[1] = B;
+                    h.weight[0] = 0.5; h.weight[1] = 0.5;
+                }
+            }
+        }
+    }
+
+    // Boundary nodes and unknowns, with the nearest node in every direction
+    dofNodes.clear();
+    arms.clear();
+    for (u32 id=0; id<nodes.size(); id++){
+        node &p = nodes[id];
+        if (p.I == 0 || p.I == NX || p.J == 0 || p.J == NY){
+            p.type  = NODE_BOUNDARY;
+            p.value = boundary(xOf(p.I), yOf(p.J));
+            continue;
+        }
+        if (p.type == NODE_HANGING) continue;
+
+        p.dof = dofNodes.size();
+        dofNodes.push_back(id);
+        std::array<u32, 4> neighbour;
+        const i32 direction[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for (u32 d=0; d<4; d++){
+            bool found = false;
+            for (u32 k=1; !found && k <= patchCells << maxLevel; k*=2){
+                found = findNode(p.I + direction[d][0]*(i64) k, p.J + direction[d][1]*(i64) k, neighbour[d]);
+            }
+            CHECK_FATAL_ASSERT(found, "Adaptive grid node without a neighbour.")
+        }
+        arms.push_back(neighbour);
+    }
+
+    DEBUG_MSG("Adaptive grid: %u leaf patches, depth %u, %u unknowns (%llu on the uniform finest grid)",
+              leaves(), depth(), size(), uniformSize());
+}
+
+f64 adaptiveGrid::value(u32 id, const EigenDefs::Vector<f64> &u) const{
+    const node &p = nodes[id];
+    switch (p.type){
+        case NODE_UNKNOWN:  return u[p.dof];
+        case NODE_BOUNDARY: return p.value;
+        case NODE_HANGING:  break;
+    }
+    f64 sum = 0.;
+    for (u32 k=0; k<p.nParents; k++) sum += p.weight[k]*value(p.parent[k], u);
+    return sum;
+}
+
+void adaptiveGrid::expand(u32 id, f64 weight, std::vector< Eigen::Triplet<f64> > &row, u32 r, f64 &lifted) const{
+    const node &p = nodes[id];
+    switch (p.type){
+        case NODE_UNKNOWN:  row.emplace_back(r, p.dof, weight); return;
+        case NODE_BOUNDARY: lifted += weight*p.value;           return;
+        case NODE_HANGING:  break;
+    }
+    for (u32 k=0; k<p.nParents; k++) expand(p.parent[k], weight*p.weight[k], row, r, lifted);
+}
+
+void adaptiveGrid::assemble(const sourceFunction &source, Eigen::SparseMatrix<f64> &A, EigenDefs::Vector<f64> &b) const{
+
+    const u32 n = size();
+    std::vector< Eigen::Triplet<f64> > triplets;
+    triplets.reserve(7*(u64) n);
+    b.resize(n);
+
+    for (u32 r=0; r<n; r++){
+        const node &p = nodes[dofNodes[r]];
+        const std::array<u32, 4> &q = arms[r];
+        const f64 x = xOf(p.I), y = yOf(p.J);
+
+        // Non-uniform 3-point second differences in x and y, as in Mesh::assemblePoisson, times the control volume
+        // (hW+hE)/2 x (hS+hN)/2 of the node
+        const f64 hW = x - xOf(nodes[q[0]].I), hE = xOf(nodes[q[1]].I) - x;
+        const f64 hS = y - yOf(nodes[q[2]].J), hN = yOf(nodes[q[3]].J) - y;
+        const f64 area = 0.25*(hW+hE)*(hS+hN);
+        const f64 c[4] = {area*2./(hW*(hW+hE)), area*2./(hE*(hW+hE)), area*2./(hS*(hS+hN)), area*2./(hN*(hS+hN))};
+
+        f64 lifted = 0.;
+        triplets.emplace_back(r, r, c[0]+c[1]+c[2]+c[3]);
+        for (u32 d=0; d<4; d++) expand(q[d], -c[d], triplets, r, lifted);
+        b[r] = area*source(x, y) - lifted;
+    }
+
+    A.resize(n, n);
+    A.setFromTriplets(triplets.begin(), triplets.end());
+    A.makeCompressed();
+}
+
+std::vector<f64> adaptiveGrid::indicator(const EigenDefs::Vector<f64> &u) const{
+
+    CHECK_FATAL_ASSERT(u.size() == size(), "Solution does not match the adaptive grid.")
+    std::vector<f64> eta(leaves(), 0.);
+    for (u32 l=0; l<leaves(); l++){
+        const patch &leaf = leafPatches[l];
+        const u32 s = 1u << (maxLevel - leaf.level);
+        const u32 I0 = leaf.pi*patchCells*s, J0 = leaf.pj*patchCells*s;
+        for (u32 b=0; b<=patchCells; b++){
+            for (u32 a=0; a<=patchCells; a++){
+                u32 id;
+                if (!findNode(I0 + a*s, J0 + b*s, id) || nodes[id].type != NODE_UNKNOWN) continue;
+                const node &p = nodes[id];
+                const std::array<u32, 4> &q = arms[p.dof];
+                const f64 x = xOf(p.I), y = yOf(p.J), uP = u[p.dof];
+                const f64 hW = x - xOf(nodes[q[0]].I), hE = xOf(nodes[q[1]].I) - x;
+                const f64 hS = y - yOf(nodes[q[2]].J), hN = yOf(nodes[q[3]].J) - y;
+                const f64 uxx = 2.*( hE*value(q[0], u) - (hW+hE)*uP + hW*value(q[1], u) )/(hW*hE*(hW+hE));
+                const f64 uyy = 2.*( hN*value(q[2], u) - (hS+hN)*uP + hS*value(q[3], u) )/(hS*hN*(hS+hN));
+                const f64 hx = std::max(hW, hE), hy = std::max(hS, hN);
+                eta[l] = std::max(eta[l], std::max(hx*hx*std::abs(uxx), hy*hy*std::abs(uyy)));
+            }
+        }
+    }
+    return eta;
+}
+
+u32 adaptiveGrid::finestWithin(u32 level, u32 pi, u32 pj) const{
+    auto found = tree.find(patchKey(level, pi, pj));
+    if (found == tree.end()) return 0;
+    if (found->second) return level;
+    u32 finest = level;
+    for (u32 c=0; c<4; c++) finest = std::max(finest, finestWithin(level+1, 2*pi + (c & 1), 2*pj + (c >> 1)));
+    return finest;
+}
+
+void adaptiveGrid::split(const patch &leaf){
+    tree[patchKey(leaf.level, leaf.pi, leaf.pj)] = false;
+    for (u32 c=0; c<4; c++) tree[patchKey(leaf.level+1, 2*leaf.pi + (c & 1), 2*leaf.pj + (c >> 1))] = true;
+}
+
+u32 adaptiveGrid::refine(const std::vector<f64> &indicator, f64 fraction){
+
+    CHECK_FATAL_ASSERT(indicator.size() == leaves(), "Indicator does not match the leaves of the adaptive grid.")
+    CHECK_FATAL_ASSERT(fraction > 0. && fraction <= 1., "Refinement fraction needs to be in (0,1].")
+    const f64 largest = *std::max_element(indicator.begin(), indicator.end());
+    if (!(largest > 0.)) return 0;
+
+    u32 refined = 0;
+    for (u32 l=0; l<leaves(); l++){
+        if (leafPatches[l].level >= maxLevel || indicator[l] < fraction*largest) continue;
+        split(leafPatches[l]);
+        refined++;
+    }
+
+    // 2:1 balance: a leaf next to (or diagonally touching) a region refined two levels deeper is split as well
+    bool balanced = false;
+    while (!balanced){
+        balanced = true;
+        std::vector<patch> current;
+        for (const auto &[key, leaf] : tree){
+            if (leaf) current.push_back(patch{(u32) (key >> 56), (u32) (key & ((1u << 28)-1)), (u32) ((key >> 28) & ((1u << 28)-1))});
+        }
+        for (const patch &leaf : current){
+            const i64 count[2] = {(i64) (NX >> (maxLevel - leaf.level))/patchCells, (i64) (NY >> (maxLevel - leaf.level))/patchCells};
+            bool needed = false;
+            for (i64 dj=-1; dj<=1 && !needed; dj++){
+                for (i64 di=-1; di<=1 && !needed; di++){
+                    const i64 qi = leaf.pi + di, qj = leaf.pj + dj;
+                    if ((di == 0 && dj == 0) || qi < 0 || qj < 0 || qi >= count[0] || qj >= count[1]) continue;
+                    needed = finestWithin(leaf.level, qi, qj) > leaf.level+1;
+                }
+            }
+            if (!needed) continue;
+            split(leaf);
+            refined++;
+            balanced = false;
+        }
+    }
+
+    if (refined > 0) build();
+    return refined;
+}
+
+void adaptiveGrid::sample(const EigenDefs::Vector<f64> &u, const gridStruct &target, EigenDefs::Array2D<f64> &field) const{
+
+    CHECK_FATAL_ASSERT(u.size() == size(), "Solution does not match the adaptive grid.")
+
+    // Continuous lattice coordinate of a point, from the base cell holding it
+    auto lattice = [this](const EigenDefs::Array1D<f64> &points, f64 x){
+        const u32 n = points.size()-1;
+        const u32 i = std::clamp<i64>(std::upper_bound(points.data(), points.data()+n+1, x) - points.data() - 1, 0, n-1);
+        return ((f64) i + (x - points[i])/(points[i+1] - points[i]))*(1u << maxLevel);
+    };
+
+    field.resize(target.y.size(), target.x.size());
+    for (u32 i=0; i<target.x.size(); i++){
+        const f64 X = lattice(base.x, target.x[i]);
+        for (u32 j=0; j<target.y.size(); j++){
+            const f64 Y = lattice(base.y, target.y[j]);
+            const u32 cI = std::min<u32>(std::max(X, 0.), NX-1), cJ = std::min<u32>(std::max(Y, 0.), NY-1);
+
+            // Leaf holding the lattice cell, searched from the coarsest level
+            u32 level = 0;
+            while (level < maxLevel){
+                const u32 span = patchCells << (maxLevel - level);
+                auto found = tree.find(patchKey(level, cI/span, cJ/span));
+                if (found != tree.end() && found->second) break;
+                level++;
+            }
+
+            // Bilinear within the leaf cell, whose corners are nodes
+            const u32 s  = 1u << (maxLevel - level);
+            const u32 I0 = cI/s*s, J0 = cJ/s*s;
+            u32 corner[4];
+            findNode(I0, J0, corner[0]);   findNode(I0+s, J0, corner[1]);
+            findNode(I0, J0+s, corner[2]); findNode(I0+s, J0+s, corner[3]);
+            const f64 tx = (target.x[i] - xOf(I0))/(xOf(I0+s) - xOf(I0));
+            const f64 ty = (target.y[j] - yOf(J0))/(yOf(J0+s) - yOf(J0));
+            field(j,i) = (1.-ty)*((1.-tx)*value(corner[0], u) + tx*value(corner[1], u))
+                       +     ty *((1.-tx)*value(corner[2], u) + tx*value(corner[3], u));
+        }
+    }
+}
+
+} // namespace Mesh
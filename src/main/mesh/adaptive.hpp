@@ -0,0 +1,173 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh.hpp"
+#include "assembly.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace Mesh{
+
+/************************************************************************************************************************
+ *  @brief A block-structured adaptive grid: a quadtree of patches refining a coarse tensor grid where it is needed.
+ *
+ *  @details
+ *  The base grid is cut in patches of patchCells x patchCells cells (level 0). Refining a patch replaces it by its
+ *  4 children, each holding patchCells x patchCells cells of half the spacing (level + 1), down to maxLevel. The leaves
+ *  are kept 2:1 balanced: patches touching each other (sides or corners) differ by at most one level. Everything is
+ *  indexed on the lattice of the finest level, i.e. the base grid with every cell cut in 2^maxLevel x 2^maxLevel, which
+ *  is never stored: only the vertices of the leaf cells are.
+ *
+ *  The gridpoints (nodes) are the vertices of the leaf cells. Where a patch meets a finer one, the nodes of the finer
+ *  patch halfway along the edges of the coarser cells are hanging: they are not solved for, but interpolated along the
+ *  coarse edge (quadratically from three coarse nodes of the same line where these exist, linearly otherwise). Every
+ *  other node that is not on the domain boundary is an unknown, and gets the 5-point stencil of -div(grad(u)) spanning
+ *  to its nearest node in each direction, with the non-uniform arm lengths of Mesh::assemblePoisson. Arms ending on a
+ *  hanging node use its interpolation, hence the coarse-fine interface conditions are part of the composite matrix,
+ *  which is therefore not symmetric (solve with BiCGstab(l)). Every row is multiplied by the control volume of its node,
+ *  as a finite-volume discretization would be: the rows of patches levels apart would otherwise differ in scale by the
+ *  square of their spacing ratio, which the Krylov solvers do not cope with. Only Dirichlet boundaries are supported,
+ *  given as a function g(x,y) such that nodes created by refinement on the boundary get exact values.
+ *
+ *  * see "Local adaptive mesh refinement for shock hydrodynamics" by Berger, Colella 1989
+ *  * see "A node-centered local refinement algorithm for Poisson's equation in complex geometries" by McCorquodale,
+ *    Colella, Grote, Johansen 2004
+ ************************************************************************************************************************/
+class adaptiveGrid{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction, one level-0 patch per patchCells x patchCells cells of the base grid (whose number of
+             cells needs to be a multiple of patchCells in x and y), boundary holding the Dirichlet values */
+        adaptiveGrid(const gridStruct &base, const sourceFunction &boundary, u32 patchCells = 8, u32 maxLevel = 4);
+
+        /**< Disabled construction using another adaptive grid */
+        adaptiveGrid(const adaptiveGrid&) = delete;
+
+        /**< Disabled construction by equating to another adaptive grid */
+        adaptiveGrid& operator =(const adaptiveGrid&) = delete;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Assembles the composite sparse matrix A and forcing vector b of -div(grad(u)) = f on the current leaves.
+         *
+         *  @param source value source f(x,y), sampled at the unknowns.
+         *  @param A      reference to the sparse matrix, resized to (size(), size()) and overwritten.
+         *  @param b      reference to the forcing vector, resized and overwritten (boundary values lifted into it).
+         *
+         *  @return None
+         ************************************************************************************************************************/
+        void assemble(const sourceFunction &source, Eigen::SparseMatrix<f64> &A, EigenDefs::Vector<f64> &b) const;
+
+        /************************************************************************************************************************
+         *  @brief Estimates the error of a solution on every leaf patch.
+         *
+         *  @details
+         *  The indicator of a patch is the largest h^2 max(|u_xx|, |u_yy|) over its unknowns, the second differences being
+         *  those of the stencil and h the longest arm in that direction: the size of the interpolation error of u on
+         *  cells of size h, which is what a finer patch removes.
+         *
+         *  @param u reference to the solution vector of the unknowns.
+         *
+         *  @return one value per leaf patch, in the order of the leaves.
+         ************************************************************************************************************************/
+        std::vector<f64> indicator(const EigenDefs::Vector<f64> &u) const;
+
+        /************************************************************************************************************************
+         *  @brief Refines the leaf patches whose indicator is at least a fraction of the largest one, then restores the
+         *         2:1 balance and renumbers the unknowns.
+         *
+         *  @param indicator reference to the indicator of every leaf, see indicator().
+         *  @param fraction  fraction of the largest indicator a patch needs to be refined, in (0,1].
+         *
+         *  @return number of patches refined (balance included), 0 once nothing needs refining or maxLevel is reached.
+         ************************************************************************************************************************/
+        u32 refine(const std::vector<f64> &indicator, f64 fraction);
+
+        /************************************************************************************************************************
+         *  @brief Samples a solution onto a tensor grid, interpolating bilinearly within the leaf cell of every gridpoint.
+         *
+         *  @param u      reference to the solution vector of the unknowns.
+         *  @param target reference to the gridpoints to sample at, which need to lie within the base grid.
+         *  @param field  reference to the sampled field f(j,i), resized and overwritten.
+         *
+         *  @return None
+         ************************************************************************************************************************/
+        void sample(const EigenDefs::Vector<f64> &u, const gridStruct &target, EigenDefs::Array2D<f64> &field) const;
+
+        /**< Number of unknowns */
+        u32 size() const { return dofNodes.size(); }
+
+        /**< Number of leaf patches */
+        u32 leaves() const { return leafPatches.size(); }
+
+        /**< Finest level holding a leaf */
+        u32 depth() const;
+
+        /**< Number of unknowns a uniform grid of the finest level would need */
+        u64 uniformSize() const { return (u64) (NX-1)*(NY-1); }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        /* list of node types */
+        typedef enum nodeType{
+            NODE_UNKNOWN  = 0, /**< solved for */
+            NODE_BOUNDARY = 1, /**< on the domain boundary, known */
+            NODE_HANGING  = 2, /**< interpolated from the nodes of a coarse edge */
+        } nodeType;
+
+        /**< Simplistic structure holding one leaf patch: its level, and its index (pi,pj) among the patches of that level */
+        struct patch{
+            u32 level, pi, pj;
+        };
+
+        /**< Simplistic structure holding one node, at lattice position (I,J) */
+        struct node{
+            u32 I, J;
+            nodeType type;
+            u32 dof;                   /**< NODE_UNKNOWN: index of the unknown */
+            f64 value;                 /**< NODE_BOUNDARY: boundary value */
+            u32 nParents;              /**< NODE_HANGING: number of nodes interpolated from (2 or 3) */
+            u32 parent[3];             /**< NODE_HANGING: nodes interpolated from */
+            f64 weight[3];             /**< NODE_HANGING: interpolation weights */
+        };
+
+        void build();
+        void split(const patch &leaf);
+        u32  finestWithin(u32 level, u32 pi, u32 pj) const;
+        bool findNode(u32 I, u32 J, u32 &id) const;
+        f64  xOf(u32 I) const;
+        f64  yOf(u32 J) const;
+        f64  value(u32 id, const EigenDefs::Vector<f64> &u) const;
+        void expand(u32 id, f64 weight, std::vector< Eigen::Triplet<f64> > &row, u32 r, f64 &lifted) const;
+
+        u64 patchKey(u32 level, u32 pi, u32 pj) const { return ((u64) level << 56) | ((u64) pj << 28) | pi; }
+        u64 nodeKey(u32 I, u32 J) const { return (u64) J*(NX+1) + I; }
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        gridStruct base;                            /**< base (level 0) gridpoints */
+        sourceFunction boundary;                    /**< Dirichlet values g(x,y) */
+        u32 patchCells;                             /**< cells per patch, in x and y */
+        u32 maxLevel;                               /**< finest level allowed */
+        u32 NX, NY;                                 /**< cells of the finest lattice, in x and y */
+
+        std::unordered_map<u64, bool> tree;         /**< every patch of the quadtree, true if it is a leaf */
+        std::vector<patch> leafPatches;             /**< leaves, in a deterministic order */
+        std::vector<node> nodes;                    /**< nodes, ordered by lattice row J then column I */
+        std::unordered_map<u64, u32> nodeIndex;     /**< node of a lattice position */
+        std::vector<u32> dofNodes;                  /**< node of every unknown */
+        std::vector< std::array<u32, 4> > arms;     /**< nearest node west, east, south and north of every unknown */
+
+};
+
+} // namespace Mesh
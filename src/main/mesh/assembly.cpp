@@ -0,0 +1,258 @@
+#include "CoreIncludes.hpp"
+#include "assembly.hpp"
+#include "boundary.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace Mesh{
+
+/**< Value of a known (Dirichlet) gridpoint, West/East taking precedence in the corners */
+static f64 boundaryValue(const gridStruct &grid, const boundaryStruct &boundaries, u32 i, u32 j){
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    if (i==0      && boundaries.WestBC.type  == BC_DIRICHLET) return boundaries.West[j];
+    if (i==imax-1 && boundaries.EastBC.type  == BC_DIRICHLET) return boundaries.East[j];
+    if (j==0      && boundaries.SouthBC.type == BC_DIRICHLET) return boundaries.South[i];
+    if (j==jmax-1 && boundaries.NorthBC.type == BC_DIRICHLET) return boundaries.North[i];
+    CHECK_FATAL_ASSERT(false, "Gridpoint is neither an unknown nor a Dirichlet boundary point.")
+    return 0.;
+}
+
+/**< Moves the rows of a vector assembled lexicographically into an ordering */
+static void renumber(const ordering &order, EigenDefs::Vector<f64> &b){
+    EigenDefs::Vector<f64> lexicographic = b;
+    gather(order, lexicographic.data(), b.data(), b.size());
+}
+
+/**< Fills the list of triplets (i,j,value) of A (if given), and the forcing vector b */
+static void assemble(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const sourceFunction &source,
+                     std::vector< Eigen::Triplet<f64> > *coefficients,
+                     EigenDefs::Vector<f64> &b){
+
+    const u32 imax = grid.x.size();             /**< #gridpoints in x */
+    const u32 jmax = grid.y.size();             /**< #gridpoints in y */
+    const dofRectangle rect = dofs(grid, boundaries);
+    const u32 n    = rect.size();               /**< sparse matrix size component (n,n), known gridpoints excluded */
+    const EigenDefs::Array1D<f64> &x = grid.x;
+    const EigenDefs::Array1D<f64> &y = grid.y;
+    b.setZero(n);
+    if (coefficients != nullptr) { coefficients->clear(); coefficients->reserve(5*n); }
+
+    // The four sides of the stencil, in the order West, East, South, North
+    const faceCondition*           face[4]     = {&boundaries.WestBC, &boundaries.EastBC, &boundaries.SouthBC, &boundaries.NorthBC};
+    const EigenDefs::Array1D<f64>* value[4]    = {&boundaries.West,   &boundaries.East,   &boundaries.South,   &boundaries.North};
+    const i32                      di[4]       = {-1, 1,  0, 0};
+    const i32                      dj[4]       = { 0, 0, -1, 1};
+    const u32                      opposite[4] = { 1, 0,  3, 2};
+    const bool periodicX = boundaries.WestBC.type  == BC_PERIODIC;
+    const bool periodicY = boundaries.SouthBC.type == BC_PERIODIC;
+
+    // One generic kernel for every unknown, whether it lies inside, next to, or on the boundary
+    for (u32 j=rect.j0; j<=rect.j1; j++){
+        for (u32 i=rect.i0; i<=rect.i1; i++){
+            const u32 idx = rect.index(i,j);
+
+            // Grid spacing on each side, mirrored across a Neumann/Robin face, wrapped across a periodic one
+            f64 h[4];
+            h[0] = i > 0      ? x[i]   - x[i-1] : (periodicX ? x[imax-1] - x[imax-2] : x[1] - x[0]);
+            h[1] = i < imax-1 ? x[i+1] - x[i]   :                                      x[imax-1] - x[imax-2];
+            h[2] = j > 0      ? y[j]   - y[j-1] : (periodicY ? y[jmax-1] - y[jmax-2] : y[1] - y[0]);
+            h[3] = j < jmax-1 ? y[j+1] - y[j]   :                                      y[jmax-1] - y[jmax-2];
+
+            f64 coefficient[4] = {-2./( h[0]*(h[0]+h[1]) ), -2./( h[1]*(h[0]+h[1]) ),
+                                  -2./( h[2]*(h[2]+h[3]) ), -2./( h[3]*(h[2]+h[3]) )};
+            f64 centre = 2./(h[0]*h[1]) + 2./(h[2]*h[3]);
+            f64 rhs    = source(x[i], y[j]);
+            f64 scale  = 1.;
+            bool ghost[4] = {false, false, false, false};
+
+            // Ghost points across Neumann/Robin faces: u_ghost = u_opposite + 2h (g - alpha u)/beta. The row is halved per
+            // ghost, such that its coupling matches the (unhalved) coupling of its neighbour back to it, keeping A symmetric
+            const bool onFace[4] = {i == 0, i == imax-1, j == 0, j == jmax-1};
+            for (u32 d=0; d<4; d++){
+                if (!onFace[d] || (face[d]->type != BC_NEUMANN && face[d]->type != BC_ROBIN)) continue;
+                const f64 g     = (*value[d])[d < 2 ? j : i];
+                const f64 alpha = face[d]->type == BC_ROBIN ? face[d]->alpha : 0.;
+                const f64 beta  = face[d]->type == BC_ROBIN ? face[d]->beta  : 1.;
+                coefficient[opposite[d]] += coefficient[d];
+                centre                   -= coefficient[d] * 2.*h[d]*alpha/beta;
+                rhs                      -= coefficient[d] * 2.*h[d]*g/beta;
+                ghost[d] = true;
+                scale   *= 0.5;
+            }
+
+            // Couple with the neighbouring unknowns, lift the known (Dirichlet) neighbours into b
+            for (u32 d=0; d<4; d++){
+                if (ghost[d]) continue;
+                i32 in = i32(i) + di[d];
+                i32 jn = i32(j) + dj[d];
+                if (periodicX) { if (in < 0) in = imax-2; else if (in == i32(imax-1)) in = 0; }
+                if (periodicY) { if (jn < 0) jn = jmax-2; else if (jn == i32(jmax-1)) jn = 0; }
+
+                if (rect.contains(in, jn)) {
+                    if (coefficients != nullptr) coefficients->push_back(  Eigen::Triplet<f64>(idx, rect.index(in, jn), scale*coefficient[d])  );
+                } else {
+                    rhs -= coefficient[d] * boundaryValue(grid, boundaries, in, jn);
+                }
+            }
+            if (coefficients != nullptr) coefficients->push_back(  Eigen::Triplet<f64>(idx, idx, scale*centre)  );
+            b[idx] = scale*rhs;
+        }
+    }
+
+    // Pure Neumann/periodic: only a b orthogonal to the constants (the nullspace of the symmetric A) has a solution
+    if (isSingular(boundaries)){
+        DEBUG_MSG("Singular system, removing the incompatible part of b (mean = %1.4e)", b.mean());
+        removeNullspace(b);
+    }
+}
+
+/**< Same as assemble, for the 4th-order compact (Mehrstellen) 9-point stencil */
+static void assembleMehrstellen(const gridStruct &grid,
+                                const boundaryStruct &boundaries,
+                                const sourceFunction &source,
+                                std::vector< Eigen::Triplet<f64> > *coefficients,
+                                EigenDefs::Vector<f64> &b){
+
+    const u32 imax = grid.x.size();             /**< #gridpoints in x */
+    const u32 jmax = grid.y.size();             /**< #gridpoints in y */
+    const dofRectangle rect = dofs(grid, boundaries);
+    const u32 n    = rect.size();               /**< sparse matrix size component (n,n), known gridpoints excluded */
+    const EigenDefs::Array1D<f64> &x = grid.x;
+    const EigenDefs::Array1D<f64> &y = grid.y;
+    b.setZero(n);
+    if (coefficients != nullptr) { coefficients->clear(); coefficients->reserve(9*n); }
+
+    for (const faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        CHECK_FATAL_ASSERT(face->type == BC_DIRICHLET || face->type == BC_PERIODIC,
+                           "The Mehrstellen stencil only supports Dirichlet and periodic faces.")
+    }
+
+    // The 4th-order error cancellation needs a uniform spacing in each direction
+    const f64 hx = (x[imax-1] - x[0])/(imax-1);
+    const f64 hy = (y[jmax-1] - y[0])/(jmax-1);
+    for (u32 i=1; i<imax; i++) CHECK_FATAL_ASSERT(std::abs(x[i] - x[i-1] - hx) < 1e-8*hx, "The Mehrstellen stencil needs a uniform spacing in x.")
+    for (u32 j=1; j<jmax; j++) CHECK_FATAL_ASSERT(std::abs(y[j] - y[j-1] - hy) < 1e-8*hy, "The Mehrstellen stencil needs a uniform spacing in y.")
+
+    // Weights of -(dxx + dyy + s dxx dyy), s = (hx^2+hy^2)/12, of the centre, the West/East, South/North and diagonal 
+    // neighbours. The forcing weighs f with 2/3 in the centre and 1/12 on each side (independent of hx/hy)
+    const f64 ax = 1./(hx*hx), ay = 1./(hy*hy), s = (hx*hx + hy*hy)/12.;
+    const f64 centre   =  2.*ax + 2.*ay - 4.*s*ax*ay;
+    const f64 side[2]  = {-ax + 2.*s*ax*ay, -ay + 2.*s*ax*ay};
+    const f64 diagonal = -s*ax*ay;
+    const bool periodicX = boundaries.WestBC.type  == BC_PERIODIC;
+    const bool periodicY = boundaries.SouthBC.type == BC_PERIODIC;
+
+    // Neighbour (i+di, j+dj), wrapped across periodic faces (onto the unknown, West/South copy)
+    auto wrap = [&](i32 in, i32 jn, i32 &iw, i32 &jw){
+        iw = in; jw = jn;
+        if (periodicX) { if (iw < 0) iw = imax-2; else if (iw >= i32(imax-1)) iw -= imax-1; }
+        if (periodicY) { if (jw < 0) jw = jmax-2; else if (jw >= i32(jmax-1)) jw -= jmax-1; }
+    };
+
+    for (u32 j=rect.j0; j<=rect.j1; j++){
+        for (u32 i=rect.i0; i<=rect.i1; i++){
+            const u32 idx = rect.index(i,j);
+            f64 rhs = 0.;
+
+            for (i32 dj=-1; dj<=1; dj++){
+                for (i32 di=-1; di<=1; di++){
+                    i32 in, jn;
+                    wrap(i32(i) + di, i32(j) + dj, in, jn);
+                    const u32 ring = (di != 0) + (dj != 0);
+
+                    // Forcing (1 + hx^2/12 dxx + hy^2/12 dyy) f
+                    if (ring == 0) rhs += 8./12.*source(x[i], y[j]);
+                    if (ring == 1) rhs += 1./12.*source(x[in], y[jn]);
+                    if (ring == 0) continue;
+
+                    // Couple with the neighbouring unknowns, lift the known (Dirichlet) neighbours into b
+                    const f64 coefficient = ring == 2 ? diagonal : side[di == 0];
+                    if (rect.contains(in, jn)) {
+                        if (coefficients != nullptr) coefficients->push_back(  Eigen::Triplet<f64>(idx, rect.index(in, jn), coefficient)  );
+                    } else {
+                        rhs -= coefficient * boundaryValue(grid, boundaries, in, jn);
+                    }
+                }
+            }
+            if (coefficients != nullptr) coefficients->push_back(  Eigen::Triplet<f64>(idx, idx, centre)  );
+            b[idx] = rhs;
+        }
+    }
+
+    // Periodic everywhere: only a b orthogonal to the constants (the nullspace of the symmetric A) has a solution
+    if (isSingular(boundaries)){
+        DEBUG_MSG("Singular system, removing the incompatible part of b (mean = %1.4e)", b.mean());
+        removeNullspace(b);
+    }
+}
+
+void assemblePoisson(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const sourceFunction &source,
+                     Eigen::SparseMatrix<f64> &A,
+                     EigenDefs::Vector<f64> &b,
+                     stencilType stencil,
+                     const ordering* order){
+
+    std::vector<  Eigen::Triplet<f64>  > coefficients; /**< List of triplets to fill out sparse matrix with */
+    if (stencil == STENCIL_MEHRSTELLEN) assembleMehrstellen(grid, boundaries, source, &coefficients, b);
+    else                                assemble(grid, boundaries, source, &coefficients, b);
+
+    // Renumbered on the way into A: row and column of every triplet, and the rows of b
+    if (order != nullptr && !order->natural()){
+        CHECK_FATAL_ASSERT(order->permutation.size() == (u64) b.size(), "Ordering does not match the grid.")
+        for (Eigen::Triplet<f64> &t : coefficients) t = Eigen::Triplet<f64>(order->permutation[t.row()], order->permutation[t.col()], t.value());
+        renumber(*order, b);
+    }
+
+    // Fill out sparse matrix
+    A.resize(b.size(), b.size());
+    A.setFromTriplets(coefficients.begin(), coefficients.end());
+}
+
+void assembleForcing(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const sourceFunction &source,
+                     EigenDefs::Vector<f64> &b,
+                     stencilType stencil,
+                     const ordering* order){
+
+    if (stencil == STENCIL_MEHRSTELLEN) assembleMehrstellen(grid, boundaries, source, nullptr, b);
+    else                                assemble(grid, boundaries, source, nullptr, b);
+    if (order != nullptr && !order->natural()){
+        CHECK_FATAL_ASSERT(order->permutation.size() == (u64) b.size(), "Ordering does not match the grid.")
+        renumber(*order, b);
+    }
+}
+
+void scatterSolution(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const EigenDefs::Vector<f64> &u,
+                     EigenDefs::Array2D<f64> &field,
+                     const ordering* order){
+
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    const dofRectangle rect = dofs(grid, boundaries);
+    CHECK_FATAL_ASSERT(u.size() == rect.size(), "Solution vector does not match the grid.")
+    auto position = [&](u32 idx){ return order != nullptr && !order->natural() ? order->permutation[idx] : idx; };
+
+    field.resize(jmax, imax);
+    for (u32 j=0; j<jmax; j++){
+        for (u32 i=0; i<imax; i++){
+            if      (rect.contains(i,j))                                                     {field(j,i) = u[position(rect.index(i,j))];}
+            else if (!(i==imax-1 && boundaries.EastBC.type  == BC_PERIODIC) &&
+                     !(j==jmax-1 && boundaries.NorthBC.type == BC_PERIODIC))                 {field(j,i) = boundaryValue(grid, boundaries, i, j);}
+        }
+    }
+
+    // Periodic copies
+    if (boundaries.EastBC.type  == BC_PERIODIC) field.col(imax-1) = field.col(0);
+    if (boundaries.NorthBC.type == BC_PERIODIC) field.row(jmax-1) = field.row(0);
+}
+
+} // namespace Mesh
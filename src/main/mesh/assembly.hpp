@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh.hpp"
+#include "ordering.hpp"
+
+#include <functional>
+
+namespace Mesh{
+
+/**< Value source f(x,y) of the problem -div(grad(u)) = f */
+using sourceFunction = std::function<f64(f64 x, f64 y)>;
+
+/************************************************************************************************************************ 
+ *  @brief Assembles the sparse matrix A and forcing vector b of -div(grad(u)) = f, using a 2nd- or 4th-order FDM stencil.
+ * 
+ *  @details
+ *  The unknowns are given by the boundary conditions (see dofRectangle), for Dirichlet everywhere the internal 
+ *  gridpoints numbered lexicographically as idx = (j-1)*(imax-2) + (i-1). Known (Dirichlet) values are lifted into b, 
+ *  Neumann/Robin faces are closed with a ghost point, and periodic faces couple with the opposite face.
+ * 
+ *  The Mehrstellen (compact 9-point) stencil adds the diagonal neighbours, cancelling the h^2 error of the 5-point 
+ *  stencil by also weighing f over the 5 points around every gridpoint:
+ * 
+ *    -(dxx + dyy + (hx^2+hy^2)/12 dxx dyy) u = (1 + hx^2/12 dxx + hy^2/12 dyy) f,
+ * 
+ *  with dxx, dyy the 3-point second differences. It is 4th-order on grids with a uniform spacing in x and in y, and 
+ *  keeps A symmetric positive-definite. A Neumann/Robin face would need a 4th-order closure of its own, hence only
+ *  Dirichlet and periodic faces are supported (anything else is fatal).
+ * 
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary values.
+ *  @param source     value source f(x,y).
+ *  @param A          reference to the sparse matrix, resized to (n,n) and overwritten.
+ *  @param b          reference to the forcing vector, resized to n and overwritten.
+ *  @param stencil    discretization, default the 5-point stencil.
+ *  @param order      numbering of the unknowns (see makeOrdering), nullptr for the lexicographic one. The matrix-free
+ *                    operators, the solution cache and the exports expect the lexicographic numbering: a system
+ *                    assembled in another one is meant for a factorisation, and its solution for scatterSolution.
+ * 
+ *  @return None
+ ************************************************************************************************************************/ 
+void assemblePoisson(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const sourceFunction &source,
+                     Eigen::SparseMatrix<f64> &A,
+                     EigenDefs::Vector<f64> &b,
+                     stencilType stencil = STENCIL_5POINT,
+                     const ordering* order = nullptr);
+
+/************************************************************************************************************************ 
+ *  @brief Assembles only the forcing vector b of -div(grad(u)) = f, for when A is already known (same grid).
+ * 
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary values.
+ *  @param source     value source f(x,y).
+ *  @param b          reference to the forcing vector, resized to n and overwritten.
+ *  @param stencil    discretization A was assembled with, default the 5-point stencil.
+ *  @param order      numbering A was assembled in, nullptr for the lexicographic one.
+ * 
+ *  @return None
+ ************************************************************************************************************************/ 
+void assembleForcing(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const sourceFunction &source,
+                     EigenDefs::Vector<f64> &b,
+                     stencilType stencil = STENCIL_5POINT,
+                     const ordering* order = nullptr);
+
+/************************************************************************************************************************ 
+ *  @brief Scatters the solution vector of the unknowns, together with the known boundary values, onto the full grid.
+ * 
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary values.
+ *  @param u          reference to the solution vector of the internal gridpoints.
+ *  @param field      reference to the full-grid solution u(j,i), resized to (jmax,imax) and overwritten.
+ *  @param order      numbering u is in, nullptr for the lexicographic one.
+ * 
+ *  @return None
+ ************************************************************************************************************************/ 
+void scatterSolution(const gridStruct &grid,
+                     const boundaryStruct &boundaries,
+                     const EigenDefs::Vector<f64> &u,
+                     EigenDefs::Array2D<f64> &field,
+                     const ordering* order = nullptr);
+
+} // namespace Mesh
@@ -0,0 +1,57 @@
+#include "CoreIncludes.hpp"
+#include "boundary.hpp"
+
+namespace Mesh{
+
+dofRectangle dofs(const gridStruct &grid, const boundaryStruct &boundaries){
+
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+
+    CHECK_FATAL_ASSERT((boundaries.WestBC.type  == BC_PERIODIC) == (boundaries.EastBC.type  == BC_PERIODIC),
+                       "Periodic boundary conditions need to be set on both the West and East face.")
+    CHECK_FATAL_ASSERT((boundaries.SouthBC.type == BC_PERIODIC) == (boundaries.NorthBC.type == BC_PERIODIC),
+                       "Periodic boundary conditions need to be set on both the South and North face.")
+    for (const faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        CHECK_FATAL_ASSERT(face->type != BC_ROBIN || face->beta != 0., "Robin boundary conditions need beta != 0 (else use Dirichlet).")
+    }
+
+    dofRectangle rect;
+    rect.i0 = boundaries.WestBC.type  == BC_DIRICHLET ? 1 : 0;
+    rect.i1 = boundaries.EastBC.type  == BC_DIRICHLET || boundaries.EastBC.type  == BC_PERIODIC ? imax-2 : imax-1;
+    rect.j0 = boundaries.SouthBC.type == BC_DIRICHLET ? 1 : 0;
+    rect.j1 = boundaries.NorthBC.type == BC_DIRICHLET || boundaries.NorthBC.type == BC_PERIODIC ? jmax-2 : jmax-1;
+    rect.ni = rect.i1 - rect.i0 + 1;
+    rect.nj = rect.j1 - rect.j0 + 1;
+    return rect;
+}
+
+bool isSingular(const boundaryStruct &boundaries){
+    for (const faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        if (face->type == BC_DIRICHLET)                     return false;
+        if (face->type == BC_ROBIN && face->alpha != 0.)    return false;
+    }
+    return true;
+}
+
+void removeNullspace(EigenDefs::Vector<f64> &v){
+    v.array() -= v.mean();
+}
+
+void gatherSolution(const gridStruct &grid,
+                    const boundaryStruct &boundaries,
+                    const EigenDefs::Array2D<f64> &field,
+                    EigenDefs::Vector<f64> &u){
+
+    const dofRectangle rect = dofs(grid, boundaries);
+    CHECK_FATAL_ASSERT(field.rows() == grid.y.size() && field.cols() == grid.x.size(), "Field does not match the grid.")
+
+    u.resize(rect.size());
+    for (u32 j=rect.j0; j<=rect.j1; j++){
+        for (u32 i=rect.i0; i<=rect.i1; i++){
+            u[rect.index(i,j)] = field(j,i);
+        }
+    }
+}
+
+} // namespace Mesh
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh.hpp"
+
+namespace Mesh{
+
+/************************************************************************************************************************
+ *  @brief Simplistic structure representing which gridpoints are unknowns, a rectangle [i0,i1]x[j0,j1] of the grid.
+ *
+ *  @details
+ *  A Dirichlet face is known, so its gridpoints are left out. Neumann and Robin faces are solved for (through a ghost
+ *  point mirrored across the face). Of two periodic faces, only the West/South one is solved for, the East/North one
+ *  being its copy. The unknowns are numbered lexicographically as idx = (j-j0)*ni + (i-i0), which for Dirichlet
+ *  everywhere is the numbering of the internal gridpoints.
+ ************************************************************************************************************************/
+struct dofRectangle{
+    u32 i0, i1;   /**< first and last gridpoint in x that is an unknown */
+    u32 j0, j1;   /**< first and last gridpoint in y that is an unknown */
+    u32 ni, nj;   /**< #unknowns in x and y */
+
+    /**< Number of unknowns */
+    u32 size() const { return ni*nj; }
+
+    /**< Unknown index of gridpoint (i,j), which needs to lie in the rectangle */
+    u32 index(u32 i, u32 j) const { return (j-j0)*ni + (i-i0); }
+
+    /**< Whether gridpoint (i,j) is an unknown */
+    bool contains(u32 i, u32 j) const { return i >= i0 && i <= i1 && j >= j0 && j <= j1; }
+};
+
+/************************************************************************************************************************
+ *  @brief Finds the unknowns of a grid given its boundary conditions, checking that the conditions are consistent.
+ *
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary conditions.
+ *
+ *  @return rectangle of unknowns.
+ ************************************************************************************************************************/
+dofRectangle dofs(const gridStruct &grid, const boundaryStruct &boundaries);
+
+/************************************************************************************************************************
+ *  @brief Checks whether the boundary conditions leave u defined up to a constant only (Neumann/periodic everywhere).
+ *
+ *  @details
+ *  The assembled A is then singular, with the constant vector as its nullspace. Since A is kept symmetric, b is made
+ *  consistent (orthogonal to the constants) during assembly, and CG converges to a solution. Which one depends on u0,
+ *  so the mean of u is removed afterwards with removeNullspace.
+ *
+ *  @param boundaries reference to the boundary conditions.
+ *
+ *  @return true if A is singular.
+ ************************************************************************************************************************/
+bool isSingular(const boundaryStruct &boundaries);
+
+/************************************************************************************************************************
+ *  @brief Removes the constant (nullspace) component of v, i.e. v <- v - mean(v).
+ *
+ *  @param v reference to the vector, overwritten.
+ *
+ *  @return None
+ ************************************************************************************************************************/
+void removeNullspace(EigenDefs::Vector<f64> &v);
+
+/************************************************************************************************************************
+ *  @brief Gathers the unknowns out of a full-grid field, the inverse of scatterSolution.
+ *
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary conditions.
+ *  @param field      reference to the full-grid field u(j,i).
+ *  @param u          reference to the solution vector, resized and overwritten.
+ *
+ *  @return None
+ ************************************************************************************************************************/
+void gatherSolution(const gridStruct &grid,
+                    const boundaryStruct &boundaries,
+                    const EigenDefs::Array2D<f64> &field,
+                    EigenDefs::Vector<f64> &u);
+
+} // namespace Mesh
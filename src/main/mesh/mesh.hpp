@@ -11,12 +11,38 @@
  ************************************************************************************************************************/
 namespace Mesh{
 
-/**< Simplistic structure representing the mesh's boundary conditions */
+/* list of boundary condition types, g being the boundary values of the face and n its outward normal */
+typedef enum bcType{
+    BC_DIRICHLET = 0, /**< u = g, the face is not solved for */
+    BC_NEUMANN   = 1, /**< du/dn = g */
+    BC_ROBIN     = 2, /**< alpha*u + beta*du/dn = g, beta != 0 */
+    BC_PERIODIC  = 3, /**< u wraps around to the opposite face (which needs to be periodic too), g is ignored */
+} bcType;
+
+/* list of discretizations of -div(grad(u)) */
+typedef enum stencilType{
+    STENCIL_5POINT      = 0, /**< 2nd-order 5-point stencil, any grid spacing and boundary condition */
+    STENCIL_MEHRSTELLEN = 1, /**< 4th-order compact 9-point stencil, uniform spacing (per direction), Dirichlet/periodic faces */
+} stencilType;
+
+/**< Simplistic structure representing the type of boundary condition on one face */
+struct faceCondition{
+    bcType type = BC_DIRICHLET; /**< boundary condition type */
+    f64 alpha   = 0.;           /**< Robin coefficient of u */
+    f64 beta    = 1.;           /**< Robin coefficient of du/dn */
+};
+
+/**< Simplistic structure representing the mesh's boundary conditions, Dirichlet everywhere unless stated otherwise */
 struct boundaryStruct{
     EigenDefs::Array1D<f64> North; /**< North boundary values*/
     EigenDefs::Array1D<f64> West;  /**< West boundary values*/
     EigenDefs::Array1D<f64> South; /**< South boundary values*/
     EigenDefs::Array1D<f64> East;  /**< East boundary values*/
+
+    faceCondition NorthBC;         /**< North boundary condition type */
+    faceCondition WestBC;          /**< West boundary condition type */
+    faceCondition SouthBC;         /**< South boundary condition type */
+    faceCondition EastBC;          /**< East boundary condition type */
 };
 
 /**< Simplistic structure representing the mesh's gridpoints. */
@@ -25,4 +51,11 @@ struct gridStruct{
     EigenDefs::Array1D<f64> y; /**< y grid points */
 };
 
+/**< Simplistic structure pointing at what a system was assembled from, for the solvers that can exploit it */
+struct discretizationStruct{
+    const gridStruct* grid           = nullptr;        /**< gridpoints */
+    const boundaryStruct* boundaries = nullptr;        /**< boundary conditions */
+    stencilType stencil              = STENCIL_5POINT; /**< stencil */
+};
+
 } // namespace Mesh
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "CoreIncludes.hpp"
+#include "ordering.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Mesh{
+
+/**< Names of the orderings, by type */
+static const char* const names[] = {"natural", "rcm", "nd", "multicolour"};
+
+/**< Largest subgraph nested dissection numbers as it is, rather than splitting it further */
+constexpr u32 leafSize = 64;
+
+/**< Simplistic structure holding the graph of a sparse matrix: the neighbours of every vertex, sorted, self excluded */
+struct adjacency{
+    std::vector<i32> offset;   /**< neighbours of vertex v are adjacent[offset[v]..offset[v+1]) */
+    std::vector<i32> adjacent; /**< neighbours of every vertex */
+
+    u32 size() const { return offset.size() - 1; }
+    u32 degree(i32 v) const { return offset[v+1] - offset[v]; }
+};
+
+/**< Graph of the pattern of A + A^T, such that a pattern that is not quite symmetric still gives an undirected graph */
+static adjacency graphOf(const Eigen::SparseMatrix<f64> &A){
+    const u32 n = A.cols();
+    adjacency graph;
+    graph.offset.assign(n+1, 0);
+    for (u32 j=0; j<n; j++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, j); it; ++it){
+            if (it.row() == (i32) j) continue;
+            graph.offset[it.row()+1]++;
+            graph.offset[j+1]++;
+        }
+    }
+    for (u32 v=0; v<n; v++) graph.offset[v+1] += graph.offset[v];
+    graph.adjacent.resize(graph.offset[n]);
+    std::vector<i32> next(graph.offset.begin(), graph.offset.end()-1);
+    for (u32 j=0; j<n; j++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, j); it; ++it){
+            if (it.row() == (i32) j) continue;
+            graph.adjacent[next[it.row()]++] = j;
+            graph.adjacent[next[j]++]        = it.row();
+        }
+    }
+
+    // Symmetric entries were added twice, keep one of each
+    u32 kept = 0;
+    for (u32 v=0; v<n; v++){
+        const i32 begin = graph.offset[v], end = graph.offset[v+1];
+        std::sort(graph.adjacent.begin() + begin, graph.adjacent.begin() + end);
+        graph.offset[v] = kept;
+        for (i32 k=begin; k<end; k++){
+            if (k == begin || graph.adjacent[k] != graph.adjacent[k-1]) graph.adjacent[kept++] = graph.adjacent[k];
+        }
+    }
+    graph.offset[n] = kept;
+    graph.adjacent.resize(kept);
+    return graph;
+}
+
+/**< Breadth-first searches restricted to the vertices carrying one label, without clearing anything between them */
+class levelSearch{
+
+    public:
+        levelSearch(const adjacency &graph, const std::vector<i32> &label)
+            : graph(graph), label(label), stamp(graph.size(), 0), current(0) {}
+
+        /**< Visits the vertices labelled label[root] reachable from root, level by level: returns the number of levels */
+        u32 run(i32 root){
+            current++;
+            order.clear();
+            levels.assign(1, 0);
+            order.push_back(root);
+            stamp[root] = current;
+            for (u32 head=0; head<order.size(); ){
+                const u32 end = order.size();
+                for (; head<end; head++){
+                    const i32 v = order[head];
+                    for (i32 k=graph.offset[v]; k<graph.offset[v+1]; k++){
+                        const i32 w = graph.adjacent[k];
+                        if (stamp[w] == current || label[w] != label[root]) continue;
+                        stamp[w] = current;
+                        order.push_back(w);
+                    }
+                }
+                levels.push_back(end);
+            }
+            return levels.size() - 1;
+        }
+
+        /**< A vertex of (nearly) largest eccentricity in the component of start (George and Liu), searched from it */
+        i32 peripheral(i32 start){
+            i32 root = start;
+            u32 depth = run(root);
+            for (u32 tries=0; tries<8; tries++){
+                i32 candidate = order[levels[depth-1]];
+                for (u32 k=levels[depth-1]; k<levels[depth]; k++){
+                    if (graph.degree(order[k]) < graph.degree(candidate)) candidate = order[k];
+                }
+                const u32 candidateDepth = run(candidate);
+                if (candidateDepth <= depth) break;
+                root  = candidate;
+                depth = candidateDepth;
+            }
+            run(root);
+            return root;
+        }
+
+        std::vector<i32> order;  /**< vertices of the last search, level by level */
+        std::vector<u32> levels; /**< level l of the last search is order[levels[l]..levels[l+1]) */
+
+    private:
+        const adjacency &graph;
+        const std::vector<i32> &label;
+        std::vector<u32> stamp;  /**< search that last visited a vertex */
+        u32 current;             /**< number of the running search */
+
+};
+
+/**< Reverse Cuthill-McKee, component by component: the new index of every vertex */
+static std::vector<i32> reverseCuthillMcKee(const adjacency &graph){
+    const u32 n = graph.size();
+    const std::vector<i32> label(n, 0);
+    levelSearch search(graph, label);
+    std::vector<i32> sequence;
+    std::vector<bool> placed(n, false);
+    sequence.reserve(n);
+
+    std::vector<i32> neighbours;
+    for (u32 start=0; start<n; start++){
+        if (placed[start]) continue;
+        const i32 root = search.peripheral(start);
+        u32 head = sequence.size();
+        sequence.push_back(root);
+        placed[root] = true;
+        for (; head<sequence.size(); head++){
+            const i32 v = sequence[head];
+            neighbours.clear();
+            for (i32 k=graph.offset[v]; k<graph.offset[v+1]; k++){
+                if (!placed[graph.adjacent[k]]) neighbours.push_back(graph.adjacent[k]);
+            }
+            std::stable_sort(neighbours.begin(), neighbours.end(), [&](i32 a, i32 b){ return graph.degree(a) < graph.degree(b); });
+            for (i32 w : neighbours){
+                placed[w] = true;
+                sequence.push_back(w);
+            }
+        }
+    }
+
+    std::vector<i32> permutation(n);
+    for (u32 k=0; k<n; k++) permutation[sequence[k]] = n-1 - k;
+    return permutation;
+}
+
+/**< Nested dissection by level-structure separators: the new index of every vertex */
+static std::vector<i32> nestedDissection(const adjacency &graph){
+    const u32 n = graph.size();
+    std::vector<i32> label(n, 0), permutation(n, -1);
+    levelSearch search(graph, label);
+
+    // Every part holds its vertices and the first new index it numbers them from, such that parts may be split in any
+    // order: a part is numbered [first, first + size), its separator at the end of that range
+    struct part{
+        std::vector<i32> vertices;
+        u32 first;
+    };
+    std::vector<part> pending;
+    pending.push_back(part{std::vector<i32>(n), 0});
+    for (u32 v=0; v<n; v++) pending[0].vertices[v] = v;
+    i32 labels = 0;
+
+    auto number = [&](const std::vector<i32> &vertices, u32 first){
+        for (u32 k=0; k<vertices.size(); k++) permutation[vertices[k]] = first + k;
+    };
+    while (!pending.empty()){
+        part current = std::move(pending.back());
+        pending.pop_back();
+        if (current.vertices.size() <= leafSize){
+            std::sort(current.vertices.begin(), current.vertices.end());
+            number(current.vertices, current.first);
+            continue;
+        }
+        const i32 id = ++labels;
+        for (i32 v : current.vertices) label[v] = id;
+        search.peripheral(current.vertices[0]);
+        const u32 depth   = search.levels.size() - 1;
+        const u32 reached = search.order.size();
+
+        // Not connected: the component of the search first, the rest (still carrying the label of the part) after it
+        if (reached < current.vertices.size()){
+            part rest{{}, current.first + reached};
+            for (i32 v : search.order) label[v] = 0;
+            for (i32 v : current.vertices){
+                if (label[v] == id) rest.vertices.push_back(v);
+            }
+            pending.push_back(std::move(rest));
+            pending.push_back(part{search.order, current.first});
+            continue;
+        }
+
+        // A path-like part (fewer than 3 levels has no level between two others) is not split any further
+        if (depth < 3){
+            std::sort(current.vertices.begin(), current.vertices.end());
+            number(current.vertices, current.first);
+            continue;
+        }
+
+        // The level holding the median vertex separates the levels before it from the levels after it
+        u32 middle = 1;
+        while (middle < depth-2 && search.levels[middle+1] < reached/2) middle++;
+        std::vector<i32> separator(search.order.begin() + search.levels[middle], search.order.begin() + search.levels[middle+1]);
+        std::sort(separator.begin(), separator.end());
+        number(separator, current.first + reached - separator.size());
+        pending.push_back(part{std::vector<i32>(search.order.begin() + search.levels[middle+1], search.order.end()),
+                               current.first + search.levels[middle]});
+        pending.push_back(part{std::vector<i32>(search.order.begin(), search.order.begin() + search.levels[middle]),
+                               current.first});
+    }
+    return permutation;
+}
+
+/**< Greedy colouring in natural order, numbered colour by colour: the new index of every vertex, and the colour offsets */
+static std::vector<i32> multicolour(const adjacency &graph, std::vector<i32> &colours){
+    const u32 n = graph.size();
+    std::vector<i32> colour(n, -1);
+    std::vector<u32> used;
+    i32 count = 0;
+    for (u32 v=0; v<n; v++){
+        used.assign(count+1, 0);
+        for (i32 k=graph.offset[v]; k<graph.offset[v+1]; k++){
+            if (colour[graph.adjacent[k]] >= 0) used[colour[graph.adjacent[k]]] = 1;
+        }
+        i32 c = 0;
+        while (used[c]) c++;
+        colour[v] = c;
+        count = std::max(count, c+1);
+    }
+
+    // Counting sort by colour, the natural order kept within a colour
+    colours.assign(count+1, 0);
+    for (u32 v=0; v<n; v++) colours[colour[v]+1]++;
+    for (i32 c=0; c<count; c++) colours[c+1] += colours[c];
+    DEBUG_MSG("Greedy colouring of %u unknowns: %d colours", n, count);
+    std::vector<i32> next(colours.begin(), colours.end()-1), permutation(n);
+    for (u32 v=0; v<n; v++) permutation[v] = next[colour[v]]++;
+    return permutation;
+}
+
+
+
+const char* orderingName(orderingType type){
+    return type <= ORDERING_MULTICOLOUR ? names[type] : "unknown";
+}
+
+bool orderingFromName(const std::string &name, orderingType &type){
+    for (u32 k=0; k<=ORDERING_MULTICOLOUR; k++){
+        if (name != names[k]) continue;
+        type = orderingType(k);
+        return true;
+    }
+    return false;
+}
+
+ordering makeOrdering(const Eigen::SparseMatrix<f64> &A, orderingType type){
+    CHECK_FATAL_ASSERT(A.rows() == A.cols(), "Number of rows and columns of sparse matrix A do not match.")
+    ordering order;
+    order.type = type;
+    if (type == ORDERING_NATURAL) return order;
+
+    const adjacency graph = graphOf(A);
+    switch (type){
+        case ORDERING_RCM:               order.permutation = reverseCuthillMcKee(graph);        break;
+        case ORDERING_NESTED_DISSECTION: order.permutation = nestedDissection(graph);           break;
+        case ORDERING_MULTICOLOUR:       order.permutation = multicolour(graph, order.colours); break;
+        default: CHECK_FATAL_ASSERT(false, "Unknown ordering type.")
+    }
+
+    const u32 n = graph.size();
+    order.inverse.assign(n, -1);
+    for (u32 v=0; v<n; v++) order.inverse[order.permutation[v]] = v;
+    CHECK_FATAL_ASSERT(std::find(order.inverse.begin(), order.inverse.end(), -1) == order.inverse.end(),
+                       "Ordering is not a permutation of the unknowns.")
+    DEBUG_MSG("Ordering %s of %u unknowns", orderingName(type), n);
+    return order;
+}
+
+orderingStatistics statistics(const Eigen::SparseMatrix<f64> &A){
+    const u32 n = A.cols();
+    orderingStatistics result;
+
+    // Band and envelope, from the column-major lower triangle (rows of the upper one, A being symmetric)
+    for (u32 j=0; j<n; j++){
+        i32 first = j;
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, j); it; ++it) first = std::min<i32>(first, it.row());
+        result.bandwidth = std::max<u64>(result.bandwidth, j - first);
+        result.profile  += j - first;
+    }
+
+    // Nonzeros of the Cholesky factor, from the elimination tree: row k of L holds the vertices met walking up the
+    // tree from every A(i,k), i < k, until reaching k (see SimplicialCholesky of Eigen, or Section 4.1 of Davis 2006)
+    std::vector<i32> parent(n, -1), tag(n, -1);
+    result.fill = n;
+    for (u32 k=0; k<n; k++){
+        tag[k] = k;
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, k); it; ++it){
+            for (i32 i=it.row(); i < (i32) k && tag[i] != (i32) k; i=parent[i]){
+                if (parent[i] == -1) parent[i] = k;
+                result.fill++;
+                tag[i] = k;
+            }
+        }
+    }
+    return result;
+}
+
+void permute(const ordering &order, const Eigen::SparseMatrix<f64> &A, Eigen::SparseMatrix<f64> &PA){
+    if (order.natural()){
+        PA = A;
+        return;
+    }
+    std::vector< Eigen::Triplet<f64> > coefficients;
+    coefficients.reserve(A.nonZeros());
+    for (u32 j=0; j<A.cols(); j++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, j); it; ++it){
+            coefficients.push_back(  Eigen::Triplet<f64>(order.permutation[it.row()], order.permutation[j], it.value())  );
+        }
+    }
+    PA.resize(A.rows(), A.cols());
+    PA.setFromTriplets(coefficients.begin(), coefficients.end());
+}
+
+void gather(const ordering &order, const f64* x, f64* px, u64 n){
+    if (order.natural()) { std::memcpy(px, x, n*sizeof(f64)); return; }
+    for (u64 i=0; i<n; i++) px[order.permutation[i]] = x[i];
+}
+
+void scatter(const ordering &order, const f64* px, f64* x, u64 n){
+    if (order.natural()) { std::memcpy(x, px, n*sizeof(f64)); return; }
+    for (u64 i=0; i<n; i++) x[i] = px[order.permutation[i]];
+}
+
+} // namespace Mesh
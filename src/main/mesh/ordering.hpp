@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Mesh{
+
+/* list of numberings of the unknowns, computed from the graph of A (its sparsity pattern) */
+typedef enum orderingType{
+    ORDERING_NATURAL           = 0, /**< lexicographic, as assembled (see dofRectangle::index) */
+    ORDERING_RCM               = 1, /**< reverse Cuthill-McKee, a narrow band around the diagonal */
+    ORDERING_NESTED_DISSECTION = 2, /**< recursive bisection, the separators numbered after the halves they split */
+    ORDERING_MULTICOLOUR       = 3, /**< greedy colouring, colour by colour (red-black for the 5-point stencil) */
+} orderingType;
+
+/**< Simplistic structure holding a numbering of the unknowns, and the map between it and the natural one */
+struct ordering{
+    orderingType type = ORDERING_NATURAL; /**< how the numbering was computed */
+    std::vector<i32> permutation;         /**< new index of every natural index, empty for the natural numbering */
+    std::vector<i32> inverse;             /**< natural index of every new index, empty for the natural numbering */
+    std::vector<i32> colours;             /**< multicolour: first new index of every colour, followed by n */
+
+    /**< Whether the numbering is the natural one, which needs no permutation */
+    bool natural() const { return permutation.empty(); }
+};
+
+/**< Simplistic structure holding what a numbering costs the solvers: the band, the envelope and the Cholesky fill */
+struct orderingStatistics{
+    u64 bandwidth = 0; /**< largest |i - j| over the nonzeros A(i,j) */
+    u64 profile   = 0; /**< entries between the first nonzero and the diagonal of every row, summed (envelope size) */
+    u64 fill      = 0; /**< nonzeros of the complete Cholesky factor L, diagonal included */
+};
+
+/**< Name of an ordering, e.g. "rcm" */
+const char* orderingName(orderingType type);
+
+/**< Finds an ordering by its name, returns false if there is none */
+bool orderingFromName(const std::string &name, orderingType &type);
+
+
+
+/************************************************************************************************************************
+ *  @brief Computes a numbering of the unknowns of a (structurally symmetric) sparse A from its graph.
+ *
+ *  @details
+ *  The lexicographic numbering of the grid puts the neighbours above and below an unknown a whole gridline away, i.e. a
+ *  band of width imax. A factorisation fills in that whole band (imax n nonzeros), and the incomplete one reaches back
+ *  a gridline for every row. The orderings below only look at the graph of A, hence they apply to any stencil, any
+ *  boundary condition and the adaptive grids alike:
+ *    - RCM numbers the unknowns level by level of a breadth-first search started at a pseudo-peripheral vertex (far
+ *      from the rest of the graph), neighbours of lower degree first, and reverses the result. The band becomes the
+ *      width of a level, about the shorter side of the grid, and the rows a triangular solve reaches back to stay close.
+ *    - Nested dissection splits the graph by a level of such a search (every level separates the ones before it from
+ *      the ones after it), numbers both halves recursively, and the separator last. The fill of a factorisation drops
+ *      from O(n^1.5) to O(n log n) on a 2D grid. Subgraphs of at most 64 vertices keep their natural numbering.
+ *    - Multicolour colours the graph greedily in natural order (no two neighbours share a colour), and numbers the
+ *      colours one after the other. The 5-point stencil needs 2 colours (red-black), the Mehrstellen one 4, a periodic
+ *      direction of odd size one more. Unknowns of one colour do not couple, hence a triangular solve of IC(0) updates
+ *      all of them at once, in parallel.
+ *
+ *  * see "Computer Solution of Large Sparse Positive Definite Systems" by George and Liu 1981
+ *  * see Section 3.3 of "Iterative Methods for Sparse Linear Systems" by Yousef Saad 2003
+ *
+ *  @param A    reference to the (n,n) sparse matrix, only its pattern (made symmetric) is used.
+ *  @param type ordering to compute.
+ *
+ *  @return numbering of the unknowns, no permutation for ORDERING_NATURAL.
+ ************************************************************************************************************************/
+ordering makeOrdering(const Eigen::SparseMatrix<f64> &A, orderingType type);
+
+/**< Band, envelope and Cholesky fill of a (structurally symmetric) sparse A, as numbered */
+orderingStatistics statistics(const Eigen::SparseMatrix<f64> &A);
+
+/**< Computes P A P^T, A renumbered by an ordering: PA(p[i], p[j]) = A(i, j), p the permutation */
+void permute(const ordering &order, const Eigen::SparseMatrix<f64> &A, Eigen::SparseMatrix<f64> &PA);
+
+/**< Renumbers a vector of n rows from the natural numbering into an ordering: px[p[i]] = x[i], x and px may not overlap */
+void gather(const ordering &order, const f64* x, f64* px, u64 n);
+
+/**< Renumbers a vector of n rows from an ordering back into the natural numbering: x[i] = px[p[i]] */
+void scatter(const ordering &order, const f64* px, f64* x, u64 n);
+
+} // namespace Mesh
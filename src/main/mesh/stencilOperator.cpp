@@ -0,0 +1,52 @@
+#include "CoreIncludes.hpp"
+#include "stencilOperator.hpp"
+
+#include <cmath>
+
+namespace Mesh{
+
+void linearOperator::apply(const f64* x, f64* y, const Parallel::executionPolicy* policy) const {
+
+    // Threaded over the row partition of the vectors, lines shared by two threads being split where the rows are
+    if (policy == nullptr){
+        applyRows(x, y, 0, size());
+        return;
+    }
+    auto product = [&](u32 t){
+        u64 begin, end;
+        policy->range(t, size(), begin, end);
+        if (begin < end) applyRows(x, y, begin, end);
+    };
+    policy->run(product);
+}
+
+/**< Whether the gridpoints are equally spaced, within a relative 1e-8 */
+static bool isUniform(const EigenDefs::Array1D<f64> &points){
+    const u32 n = points.size();
+    const f64 h = (points[n-1] - points[0])/(n-1);
+    for (u32 i=1; i<n; i++){
+        if (std::abs(points[i] - points[i-1] - h) >= 1e-8*std::abs(h)) return false;
+    }
+    return true;
+}
+
+std::unique_ptr<linearOperator> makeOperator(const gridStruct &grid, const boundaryStruct &boundaries, stencilType stencil){
+
+    for (const faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        if (face->type == BC_NEUMANN || face->type == BC_ROBIN) return nullptr;
+    }
+    const bool uniform = isUniform(grid.x) && isUniform(grid.y);
+
+    std::unique_ptr<linearOperator> op;
+    if (stencil == STENCIL_MEHRSTELLEN){
+        if (uniform) op = std::make_unique< stencilOperator<STENCIL_MEHRSTELLEN, true> >(grid, boundaries);
+    } else if (uniform){
+        op = std::make_unique< stencilOperator<STENCIL_5POINT, true>  >(grid, boundaries);
+    } else {
+        op = std::make_unique< stencilOperator<STENCIL_5POINT, false> >(grid, boundaries);
+    }
+    if (op != nullptr) DEBUG_MSG("Matrix-free operator: %s, %u unknowns", op->name(), op->size());
+    return op;
+}
+
+} // namespace Mesh
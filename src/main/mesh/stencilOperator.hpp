@@ -0,0 +1,226 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh.hpp"
+#include "boundary.hpp"
+#include "core/parallel.hpp"
+#include "core/simd.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace Mesh{
+
+/************************************************************************************************************************
+ *  @brief The product y = A x of an assembled system, computed from the stencil instead of a stored sparse matrix.
+ *
+ *  @details
+ *  A sparse matrix-vector product streams 5 (or 9) values and column indices per unknown, and reaches x through those
+ *  indices. For a stencil, both are known: the neighbours of an unknown are at fixed offsets, and on a uniform grid the
+ *  weights are the same everywhere. The operators below apply the stencil line by line to the unknowns (numbered as in
+ *  Mesh::dofRectangle), with the same weights as Mesh::assemblePoisson up to round-off, so they can replace A in the
+ *  products of a Krylov solver while b still comes from the assembly.
+ ************************************************************************************************************************/
+class linearOperator{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default destruction */
+        virtual ~linearOperator() = default;
+
+        /**< Number of unknowns, the size of x and y */
+        u32 size() const { return ni*nj; }
+
+        /**< Name of the specialisation, for reporting */
+        virtual const char* name() const = 0;
+
+        /************************************************************************************************************************
+         *  @brief Computes y = A x, every thread of the policy computing the rows it owns (see executionPolicy::range).
+         *
+         *  @param x      vector to multiply, of size size().
+         *  @param y      result, of size size(), may not alias x.
+         *  @param policy threads to split the rows over, nullptr runs serially.
+         *
+         *  @return None
+         ************************************************************************************************************************/
+        void apply(const f64* x, f64* y, const Parallel::executionPolicy* policy = nullptr) const;
+
+        /**< Computes rows [begin, end) of y = A x */
+        virtual void applyRows(const f64* x, f64* y, u64 begin, u64 end) const = 0;
+
+    protected:
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        u32 ni, nj;                 /**< unknowns per line, and number of lines */
+        bool periodicX, periodicY;  /**< whether the lines (resp. columns) wrap around */
+        std::vector<f64> zero;      /**< line of zeros, standing in for the (known, lifted) Dirichlet lines */
+
+};
+
+
+
+/************************************************************************************************************************
+ *  @brief Matrix-free -div(grad(u)) for a stencil and a grid spacing fixed at compile time, on Dirichlet/periodic faces.
+ *
+ *  @details
+ *  Every point computes the same expression from its 3x3 neighbourhood, the neighbours across a Dirichlet face being
+ *  zero and those across a periodic face wrapping around. The lines are processed as their interior (a loop without
+ *  any branch nor division, vectorised for the cpu by Simd::kernels) and their two end points (scalar). The weights are:
+ *    - uniform 5-point:      centre 2/hx^2 + 2/hy^2, sides -1/hx^2 and -1/hy^2, all constant, hence 3 FMAs per point.
+ *    - non-uniform 5-point:  the weights of Mesh::assemblePoisson, precomputed once per gridline in x and in y.
+ *    - Mehrstellen 9-point:  the constant weights of the compact 4th-order stencil (uniform spacing only).
+ *
+ *  @tparam stencil discretization, STENCIL_5POINT or STENCIL_MEHRSTELLEN.
+ *  @tparam uniform whether the spacing is uniform in x and in y (required by the Mehrstellen stencil).
+ ************************************************************************************************************************/
+template<stencilType stencil, bool uniform> class stencilOperator final : public linearOperator{
+
+    static_assert(stencil == STENCIL_5POINT || uniform, "The Mehrstellen stencil needs a uniform spacing.");
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction computes the weights of the grid, whose faces need to be Dirichlet or periodic */
+        stencilOperator(const gridStruct &grid, const boundaryStruct &boundaries){
+            const dofRectangle rect = dofs(grid, boundaries);
+            const u32 imax = grid.x.size();
+            const u32 jmax = grid.y.size();
+            ni = rect.ni;
+            nj = rect.nj;
+            periodicX = boundaries.WestBC.type  == BC_PERIODIC;
+            periodicY = boundaries.SouthBC.type == BC_PERIODIC;
+            zero.assign(ni, 0.);
+
+            const f64 hx = (grid.x[imax-1] - grid.x[0])/(imax-1);
+            const f64 hy = (grid.y[jmax-1] - grid.y[0])/(jmax-1);
+            const f64 ax = 1./(hx*hx), ay = 1./(hy*hy);
+            if constexpr (stencil == STENCIL_MEHRSTELLEN){
+                const f64 s = (hx*hx + hy*hy)/12.;
+                centre   =  2.*ax + 2.*ay - 4.*s*ax*ay;
+                sideX    = -ax + 2.*s*ax*ay;
+                sideY    = -ay + 2.*s*ax*ay;
+                diagonal = -s*ax*ay;
+            } else if constexpr (uniform){
+                centre = 2.*ax + 2.*ay;
+                sideX  = -ax;
+                sideY  = -ay;
+            } else {
+                // Per gridline, with the spacing across a periodic face wrapped (as in the assembly)
+                auto weights = [](const EigenDefs::Array1D<f64> &x, u32 k0, u32 n, bool periodic,
+                                  std::vector<f64> &lower, std::vector<f64> &upper, std::vector<f64> &middle){
+                    const u32 m = x.size();
+                    lower.resize(n); upper.resize(n); middle.resize(n);
+                    for (u32 k=0; k<n; k++){
+                        const u32 g  = k0 + k;
+                        const f64 h0 = g > 0   ? x[g]   - x[g-1] : (periodic ? x[m-1] - x[m-2] : x[1] - x[0]);
+                        const f64 h1 = g < m-1 ? x[g+1] - x[g]   :                                x[m-1] - x[m-2];
+                        lower[k]  = -2./( h0*(h0+h1) );
+                        upper[k]  = -2./( h1*(h0+h1) );
+                        middle[k] =  2./(h0*h1);
+                    }
+                };
+                weights(grid.x, rect.i0, ni, periodicX, west,  east,  centreX);
+                weights(grid.y, rect.j0, nj, periodicY, south, north, centreY);
+            }
+        }
+
+        /**< Name of the specialisation, for reporting */
+        const char* name() const override {
+            if constexpr (stencil == STENCIL_MEHRSTELLEN) return "mehrstellen";
+            else if constexpr (uniform)                   return "5point-uniform";
+            else                                          return "5point";
+        }
+
+        /**< Computes rows [begin, end) of y = A x */
+        void applyRows(const f64* x, f64* y, u64 begin, u64 end) const override {
+            for (u64 row=begin; row<end; ){
+                const u32 j  = row/ni;
+                const u32 i0 = row - (u64) j*ni;
+                const u32 i1 = (u32) std::min<u64>(ni, end - (u64) j*ni);
+                line(x, y + (u64) j*ni, j, i0, i1);
+                row += i1 - i0;
+            }
+        }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Value of the stencil at point i of line j, from its 3x3 neighbourhood (d: down/south, c: centre, u: up/north) */
+        inline f64 point(u32 i, u32 j, f64 dW, f64 dC, f64 dE, f64 cW, f64 cC, f64 cE, f64 uW, f64 uC, f64 uE) const {
+            if constexpr (stencil == STENCIL_MEHRSTELLEN){
+                return centre*cC + sideX*(cW + cE) + sideY*(dC + uC) + diagonal*((dW + dE) + (uW + uE));
+            } else if constexpr (uniform){
+                return centre*cC + sideX*(cW + cE) + sideY*(dC + uC);
+            } else {
+                return (centreX[i] + centreY[j])*cC + west[i]*cW + east[i]*cE + south[j]*dC + north[j]*uC;
+            }
+        }
+
+        /**< Points [i0, i1) of line j */
+        void line(const f64* x, f64* y, u32 j, u32 i0, u32 i1) const {
+            const f64* c = x + (u64) j*ni;
+            const f64* d = j > 0    ? c - ni : (periodicY ? x + (u64) (nj-1)*ni : zero.data());
+            const f64* u = j < nj-1 ? c + ni : (periodicY ? x                   : zero.data());
+
+            // Interior of the line: no wrapping, no branches, in the SIMD kernel of the cpu (the expressions of point)
+            const u32 a = std::max<u32>(i0, 1), b = std::min<u32>(i1, ni-1);
+            if (a < b){
+                const Simd::kernelTable &kernels = Simd::kernels();
+                if constexpr (stencil == STENCIL_MEHRSTELLEN){
+                    kernels.mehrstellen(y, d, c, u, centre, sideX, sideY, diagonal, a, b);
+                } else if constexpr (uniform){
+                    kernels.stencil5(y, d, c, u, centre, sideX, sideY, a, b);
+                } else {
+                    kernels.stencil5Variable(y, d, c, u, west.data(), east.data(), centreX.data(), centreY[j], south[j], north[j], a, b);
+                }
+            }
+
+            // End points, the neighbours across the West/East faces being zero (Dirichlet) or wrapped (periodic)
+            auto edge = [&](u32 i){
+                const bool hasW = i > 0    || periodicX, hasE = i < ni-1 || periodicX;
+                const u32  w    = i > 0    ? i-1 : ni-1,  e   = i < ni-1 ? i+1 : 0;
+                y[i] = point(i, j, hasW ? d[w] : 0., d[i], hasE ? d[e] : 0.,
+                                   hasW ? c[w] : 0., c[i], hasE ? c[e] : 0.,
+                                   hasW ? u[w] : 0., u[i], hasE ? u[e] : 0.);
+            };
+            if (i0 == 0) edge(0);
+            if (i1 == ni && ni > 1) edge(ni-1);
+        }
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        f64 centre = 0., sideX = 0., sideY = 0., diagonal = 0.;  /**< constant weights (uniform spacing) */
+        std::vector<f64> west, east, centreX;                    /**< weights per gridline in x (non-uniform spacing) */
+        std::vector<f64> south, north, centreY;                  /**< weights per gridline in y (non-uniform spacing) */
+
+};
+
+
+
+/************************************************************************************************************************
+ *  @brief Picks the specialisation of stencilOperator matching a grid, at runtime.
+ *
+ *  @details
+ *  The spacing counts as uniform when every cell is within a relative 1e-8 of the mean spacing, in x and in y. Neumann
+ *  and Robin faces are closed with ghost points whose rows are scaled (see Mesh::assemblePoisson), which the operators
+ *  do not implement: such grids return nullptr, and the caller keeps using the assembled A.
+ *
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary conditions.
+ *  @param stencil    discretization the system was assembled with.
+ *
+ *  @return the operator, or nullptr if no specialisation covers the grid.
+ ************************************************************************************************************************/
+std::unique_ptr<linearOperator> makeOperator(const gridStruct &grid, const boundaryStruct &boundaries, stencilType stencil);
+
+} // namespace Mesh
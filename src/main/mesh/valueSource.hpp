@@ -3,7 +3,7 @@
 #include "CoreIncludes.hpp"
 
 /**< Simplistic value source f(x,y). */
-f64 valueSource(f64 x, f64 y){
+inline f64 valueSource(f64 x, f64 y){
     f64 f = -2.2;
     return f;
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "CoreIncludes.hpp"
+#include "derivedFields.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace PostProcess{
+
+/**< Simplistic structure holding the 3-point weights of a derivative at one gridpoint, applied to points k0, k0+1, k0+2 */
+struct weights{
+    u32 k0;
+    f64 w[3];
+};
+
+/**< First derivative weights of a (non-uniform) gridline, the same 2nd-order formulas as np.gradient with edge_order=2 */
+static std::vector<weights> firstDerivative(const EigenDefs::Array1D<f64> &x){
+    const u32 n = x.size();
+    std::vector<weights> d(n);
+    for (u32 k=0; k<n; k++){
+        if (k == 0){
+            f64 h1 = x[1] - x[0], h2 = x[2] - x[1];
+            d[k] = {0,   {-(2.*h1+h2)/(h1*(h1+h2)),  (h1+h2)/(h1*h2), -h1/(h2*(h1+h2))}};
+        } else if (k == n-1){
+            f64 h1 = x[n-2] - x[n-3], h2 = x[n-1] - x[n-2];
+            d[k] = {n-3, { h2/(h1*(h1+h2)),         -(h1+h2)/(h1*h2),  (2.*h2+h1)/(h2*(h1+h2))}};
+        } else {
+            f64 h1 = x[k] - x[k-1], h2 = x[k+1] - x[k];
+            d[k] = {k-1, {-h2/(h1*(h1+h2)),          (h2-h1)/(h1*h2),  h1/(h2*(h1+h2))}};
+        }
+    }
+    return d;
+}
+
+/**< Second derivative weights of a (non-uniform) gridline at the internal gridpoints, as used by the assembly */
+static std::vector<weights> secondDerivative(const EigenDefs::Array1D<f64> &x){
+    const u32 n = x.size();
+    std::vector<weights> d(n, weights{0, {0., 0., 0.}});
+    for (u32 k=1; k<n-1; k++){
+        f64 h1 = x[k] - x[k-1], h2 = x[k+1] - x[k];
+        d[k] = {k-1, {2./(h1*(h1+h2)), -2./(h1*h2), 2./(h2*(h1+h2))}};
+    }
+    return d;
+}
+
+void compute(const Mesh::gridStruct &grid,
+             const EigenDefs::Array2D<f64> &field,
+             const Mesh::sourceFunction &source,
+             const Mesh::sourceFunction &exact,
+             derivedFields &derived,
+             const Parallel::executionPolicy* policy,
+             Mesh::stencilType stencil){
+
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    CHECK_FATAL_ASSERT(field.rows() == jmax && field.cols() == imax, "Solution field does not match the grid.")
+    CHECK_FATAL_ASSERT(imax >= 3 && jmax >= 3, "Derived fields need at least 3 gridpoints in x and y.")
+
+    const std::vector<weights> dx  = firstDerivative(grid.x),  dy  = firstDerivative(grid.y);
+    const std::vector<weights> dxx = secondDerivative(grid.x), dyy = secondDerivative(grid.y);
+
+    derived.dudx.resize(jmax, imax);
+    derived.dudy.resize(jmax, imax);
+    derived.residual.resize(jmax, imax);
+    derived.curl.resize(jmax, imax);
+    if (exact) derived.error.resize(jmax, imax);
+    else       derived.error.resize(0, 0);
+
+    // Per-thread maxima/sums, reduced afterwards
+    const u32 nThreads = policy == nullptr ? 1 : policy->threads();
+    std::vector<f64> residualMax(nThreads, 0.), curlMax(nThreads, 0.), errorMax(nThreads, 0.), errorSum(nThreads, 0.);
+
+    // Every thread takes a block of gridlines x = const, which are contiguous in the column-major fields
+    auto pass = [&](u32 t){
+        const u32 iBegin = (u64) imax* t   /nThreads;
+        const u32 iEnd   = (u64) imax*(t+1)/nThreads;
+        for (u32 i=iBegin; i<iEnd; i++){
+            const weights &sx = dx[i], &sxx = dxx[i];
+            for (u32 j=0; j<jmax; j++){
+                const weights &sy = dy[j], &syy = dyy[j];
+
+                // du/dx on the 3 rows of the y-stencil, du/dy on the 3 columns of the x-stencil
+                f64 ux[3], uy[3];
+                for (u32 b=0; b<3; b++){
+                    ux[b] = sx.w[0]*field(sy.k0+b, sx.k0) + sx.w[1]*field(sy.k0+b, sx.k0+1) + sx.w[2]*field(sy.k0+b, sx.k0+2);
+                    uy[b] = sy.w[0]*field(sy.k0, sx.k0+b) + sy.w[1]*field(sy.k0+1, sx.k0+b) + sy.w[2]*field(sy.k0+2, sx.k0+b);
+                }
+                const f64 dudx = sx.w[0]*field(j, sx.k0) + sx.w[1]*field(j, sx.k0+1) + sx.w[2]*field(j, sx.k0+2);
+                const f64 dudy = sy.w[0]*field(sy.k0, i) + sy.w[1]*field(sy.k0+1, i) + sy.w[2]*field(sy.k0+2, i);
+                derived.dudx(j,i) = dudx;
+                derived.dudy(j,i) = dudy;
+
+                // d/dx(du/dy) - d/dy(du/dx)
+                const f64 curl = (sx.w[0]*uy[0] + sx.w[1]*uy[1] + sx.w[2]*uy[2]) - (sy.w[0]*ux[0] + sy.w[1]*ux[1] + sy.w[2]*ux[2]);
+                derived.curl(j,i) = curl;
+                curlMax[t] = std::max(curlMax[t], std::abs(curl));
+
+                // f + lap_h(u), on the internal gridpoints. For the Mehrstellen stencil, (1 + hx^2/12 dxx + hy^2/12 dyy) f 
+                // + (dxx + dyy + (hx^2+hy^2)/12 dxx dyy) u, the spacing being uniform
+                f64 residual = 0.;
+                if (i > 0 && i < imax-1 && j > 0 && j < jmax-1){
+                    const f64 uxx = sxx.w[0]*field(j, i-1) + sxx.w[1]*field(j, i) + sxx.w[2]*field(j, i+1);
+                    const f64 uyy = syy.w[0]*field(j-1, i) + syy.w[1]*field(j, i) + syy.w[2]*field(j+1, i);
+                    const f64 f   = source(grid.x[i], grid.y[j]);
+                    if (stencil == Mesh::STENCIL_MEHRSTELLEN){
+                        f64 uxxyy = 0.;
+                        for (u32 b=0; b<3; b++){
+                            uxxyy += syy.w[b]*( sxx.w[0]*field(j-1+b, i-1) + sxx.w[1]*field(j-1+b, i) + sxx.w[2]*field(j-1+b, i+1) );
+                        }
+                        const f64 hx = grid.x[i+1] - grid.x[i], hy = grid.y[j+1] - grid.y[j];
+                        const f64 fxx = source(grid.x[i-1], grid.y[j]) - 2.*f + source(grid.x[i+1], grid.y[j]);
+                        const f64 fyy = source(grid.x[i], grid.y[j-1]) - 2.*f + source(grid.x[i], grid.y[j+1]);
+                        residual = f + (fxx + fyy)/12. + uxx + uyy + (hx*hx + hy*hy)/12.*uxxyy;
+                    } else {
+                        residual = f + uxx + uyy;
+                    }
+                }
+                derived.residual(j,i) = residual;
+                residualMax[t] = std::max(residualMax[t], std::abs(residual));
+
+                if (exact){
+                    const f64 error = field(j,i) - exact(grid.x[i], grid.y[j]);
+                    derived.error(j,i) = error;
+                    errorMax[t] = std::max(errorMax[t], std::abs(error));
+                    errorSum[t] += error*error;
+                }
+            }
+        }
+    };
+    if (policy == nullptr) pass(0);
+    else                   policy->run(pass);
+
+    derived.residualMax = *std::max_element(residualMax.begin(), residualMax.end());
+    derived.curlMax     = *std::max_element(curlMax.begin(),     curlMax.end());
+    derived.errorMax    = *std::max_element(errorMax.begin(),    errorMax.end());
+    f64 sum = 0.;
+    for (f64 s : errorSum) sum += s;
+    derived.errorRms = std::sqrt(sum/((f64) imax*jmax));
+
+    DEBUG_MSG("Derived fields: max|residual| = %1.4e, max|curl| = %1.4e", derived.residualMax, derived.curlMax);
+    if (exact) INFO_MSG("Error vs manufactured solution: max = %1.4e, rms = %1.4e", derived.errorMax, derived.errorRms);
+}
+
+} // namespace PostProcess
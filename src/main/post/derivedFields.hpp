@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/assembly.hpp"
+#include "core/parallel.hpp"
+
+/************************************************************************************************************************
+ *  @brief Fields derived from the solution (for checking and plotting it) are represented in this namespace.
+ *
+ *  @details
+ *  Computing these in Python meant reading the whole solution back through struct.unpack, and calling np.gradient
+ *  three times over it (once for grad(u), twice for the second derivatives). Here, every derived field comes out of a
+ *  single pass over the solution, each gridpoint reading its 3x3 neighbourhood once, split over the threads of an
+ *  execution policy. Python then only has to plot the fields (see IO::writeTiles).
+ ************************************************************************************************************************/
+namespace PostProcess{
+
+/**< Simplistic structure holding the fields derived from a full-grid solution u(j,i), all of size (jmax,imax) */
+struct derivedFields{
+    EigenDefs::Array2D<f64> dudx;       /**< du/dx, 2nd-order (one-sided on the boundary, as np.gradient with edge_order=2) */
+    EigenDefs::Array2D<f64> dudy;       /**< du/dy, idem */
+    EigenDefs::Array2D<f64> residual;   /**< residual of the stencil of the solve (f + lap_h(u) for 5 points), 0 on the boundary */
+    EigenDefs::Array2D<f64> curl;       /**< d/dx(du/dy) - d/dy(du/dx), zero up to round-off */
+    EigenDefs::Array2D<f64> error;      /**< u - u_exact, empty if no manufactured solution was given */
+
+    f64 residualMax = 0.;               /**< max |residual| */
+    f64 curlMax     = 0.;               /**< max |curl| */
+    f64 errorMax    = 0.;               /**< max |error| */
+    f64 errorRms    = 0.;               /**< RMS of the error */
+};
+
+/************************************************************************************************************************
+ *  @brief Computes the gradient, discrete Laplacian residual, curl check and (optionally) the error of a solution.
+ *
+ *  @details
+ *  All fields are computed in one fused pass: for every gridpoint, the 3x3 neighbourhood of u is combined with the
+ *  (non-uniform) 3-point first-derivative weights of x and y, and the second-difference weights of the assembly. The
+ *  curl is computed as in post.py, i.e. as the difference between applying the x and y derivatives in either order,
+ *  hence checks the round-off of the derivatives. The residual is that of the stencil the system was assembled with
+ *  (see Mesh::assemblePoisson), and is only evaluated on the internal gridpoints: on the boundary it would need the 
+ *  ghost points of the Neumann/Robin closure.
+ *
+ *  @param grid    reference to the gridpoints.
+ *  @param field   reference to the full-grid solution u(j,i).
+ *  @param source  value source f(x,y).
+ *  @param exact   manufactured solution u(x,y), or nullptr (empty function) to skip the error.
+ *  @param derived reference to the derived fields, resized and overwritten.
+ *  @param policy  threads to split the gridlines over, nullptr runs serially.
+ *  @param stencil discretization of the solve, default the 5-point stencil.
+ *
+ *  @return None
+ ************************************************************************************************************************/
+void compute(const Mesh::gridStruct &grid,
+             const EigenDefs::Array2D<f64> &field,
+             const Mesh::sourceFunction &source,
+             const Mesh::sourceFunction &exact,
+             derivedFields &derived,
+             const Parallel::executionPolicy* policy = nullptr,
+             Mesh::stencilType stencil = Mesh::STENCIL_5POINT);
+
+} // namespace PostProcess
@@ -0,0 +1,113 @@
+#include "CoreIncludes.hpp"
+#include "preconditioners.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+f64 Preconditioner::gershgorinBound(const Eigen::SparseMatrix<f64> &A){
+
+    // A is symmetric, hence the absolute column sums are the absolute row sums
+    f64 bound = 0.;
+    for (i32 k=0; k<A.outerSize(); k++){
+        f64 sum = 0.;
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, k); it; ++it) sum += std::abs(it.value());
+        bound = std::max(bound, sum);
+    }
+    return bound;
+}
+
+bool Preconditioner::analyticBounds(const Mesh::gridStruct &grid,
+                                    const Mesh::boundaryStruct &boundaries,
+                                    Mesh::stencilType stencil,
+                                    f64 &lower,
+                                    f64 &upper){
+
+    for (const Mesh::faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        if (face->type != Mesh::BC_DIRICHLET) return false;
+    }
+
+    // Spacing and extreme 1D eigenvalues, per direction
+    f64 h[2], smallest[2], largest[2];
+    const EigenDefs::Array1D<f64>* points[2] = {&grid.x, &grid.y};
+    for (u32 d=0; d<2; d++){
+        const EigenDefs::Array1D<f64> &x = *points[d];
+        const u32 m = x.size();
+        if (m < 3) return false;
+        h[d] = (x[m-1] - x[0])/(m-1);
+        for (u32 i=1; i<m; i++){
+            if (std::abs(x[i] - x[i-1] - h[d]) >= 1e-8*std::abs(h[d])) return false;
+        }
+        const f64 angle = EIGEN_PI/(2.*(m-1));
+        smallest[d] = 4./(h[d]*h[d])*std::pow(std::sin(angle), 2);
+        largest[d]  = 4./(h[d]*h[d])*std::pow(std::cos(angle), 2);
+    }
+
+    lower = smallest[0] + smallest[1];
+    upper = largest[0]  + largest[1];
+    if (stencil == Mesh::STENCIL_MEHRSTELLEN){
+        // lx + ly - s lx ly increases with lx (resp. ly) while s ly < 1 (resp. s lx < 1)
+        const f64 s = (h[0]*h[0] + h[1]*h[1])/12.;
+        if (s*largest[0] >= 1. || s*largest[1] >= 1.) return false;
+        lower -= s*smallest[0]*smallest[1];
+        upper -= s*largest[0]*largest[1];
+    }
+    return true;
+}
+
+namespace Preconditioner {
+
+void preconditioner::chebyshev(const f64* r, f64* z) const{
+
+    const u64 n = A->cols();
+    f64* res = rs.data();
+    f64* dir = ds.data();
+    f64* q   = qs.data();
+    chebyshevRecurrence recurrence(settings.lower, settings.upper);
+    f64 a = 0., c = 0.;
+
+    // Every step is one product and one fused update of the rows, split over the threads of the policy as the
+    // products are: no inner product, and no synchronisation beyond the products
+    auto rows = [&](auto &&update){
+        if (policy == nullptr){
+            update(0, n);
+            return;
+        }
+        auto task = [&](u32 t){
+            u64 begin, end;
+            policy->range(t, n, begin, end);
+            update(begin, end);
+        };
+        policy->run(task);
+    };
+    auto product = [&](){
+        if (policy != nullptr && symmetric) policy->symmetricProduct(*A, dir, q);
+        else Eigen::Map<EigenDefs::Vector<f64>>(q, n).noalias() = (*A)*Eigen::Map<const EigenDefs::Vector<f64>>(dir, n);
+    };
+
+    // z = 0, residual r, first direction r/theta
+    const f64 inverseTheta = 1./recurrence.theta;
+    rows([&](u64 begin, u64 end){
+        for (u64 i=begin; i<end; i++){
+            z[i]   = 0.;
+            res[i] = r[i];
+            dir[i] = inverseTheta*r[i];
+        }
+    });
+
+    for (u32 k=0; k<settings.degree; k++){
+        product();
+        recurrence.next(a, c);
+        rows([&](u64 begin, u64 end){
+            for (u64 i=begin; i<end; i++){
+                z[i]   += dir[i];
+                res[i] -= q[i];
+                dir[i]  = a*dir[i] + c*res[i];
+            }
+        });
+    }
+    rows([&](u64 begin, u64 end){
+        for (u64 i=begin; i<end; i++) z[i] += dir[i];
+    });
+}
+
+}
@@ -1,18 +1,63 @@
 #include "CoreIncludes.hpp"
 #include "preconditioners.hpp"
 
-Eigen::SparseMatrix<f64> Preconditioner::incompleteCholesky(Eigen::SparseMatrix<f64> A){
+#include <cmath>
+#include <vector>
 
-    // Get size of matrix. 
-    u32 n = A.rows(); /**< the #rows and #cols of the preconditioner M(n,n), should be equal to A.cols(). */
+Eigen::SparseMatrix<f64, Eigen::RowMajor> Preconditioner::incompleteCholesky(const Eigen::SparseMatrix<f64> &A){
 
-    // Get Jacobi Preconditioner
-    Eigen::SparseMatrix<f64> L(n,n); /**< Preconditioner L*/
-    // for (u32 i=0; i<n; i++){
+    // Get size of matrix.
+    u32 n = A.rows(); /**< the #rows and #cols of the preconditioner L(n,n), should be equal to A.cols(). */
+    CHECK_FATAL_ASSERT(A.isCompressed(), "Incomplete Cholesky needs a compressed sparse matrix.")
 
+    // Sparsity of L: row i of the lower triangle of A is column i of its upper triangle (A is symmetric), the column
+    // indices come out sorted, hence the diagonal is the last entry of every row
+    std::vector<i32> outer(n+1, 0), inner;
+    std::vector<f64> values;
+    inner.reserve(A.nonZeros()/2 + n);
+    values.reserve(A.nonZeros()/2 + n);
+    for (u32 i=0; i<n; i++){
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, i); it; ++it){
+            if (it.row() > (i32) i) break;
+            inner.push_back(it.row());
+            values.push_back(it.value());
+        }
+        CHECK_FATAL_ASSERT(!inner.empty() && inner.back() == (i32) i, "Incomplete Cholesky needs a nonzero diagonal.")
+        outer[i+1] = inner.size();
+    }
 
-    // }
+    // Get Incomplete Cholesky Preconditioner, row by row: L(i,k) = (A(i,k) - sum_j L(i,j) L(k,j)) / L(k,k), with j
+    // running over the columns rows i and k share, and L(i,i) = sqrt(A(i,i) - sum_j L(i,j)^2). A pivot that is not
+    // positive (IC(0) only exists for M-matrices in general) is replaced by the diagonal of A
+    u32 replaced = 0;
+    for (u32 i=0; i<n; i++){
+        const i32 rowBegin = outer[i], diagonal = outer[i+1]-1;
+        for (i32 p=rowBegin; p<diagonal; p++){
+            const i32 k = inner[p];
+            f64 sum = values[p];
+            for (i32 a=rowBegin, c=outer[k]; a<p && c<outer[k+1]-1; ){
+                if      (inner[a] < inner[c]) a++;
+                else if (inner[a] > inner[c]) c++;
+                else                          sum -= values[a++]*values[c++];
+            }
+            values[p] = sum/values[outer[k+1]-1];
+        }
+        f64 pivot = values[diagonal];
+        for (i32 p=rowBegin; p<diagonal; p++) pivot -= values[p]*values[p];
+        if (pivot <= 1e-12*std::abs(values[diagonal])){
+            pivot = std::abs(values[diagonal]);
+            replaced++;
+        }
+        values[diagonal] = std::sqrt(pivot);
+    }
+    if (replaced > 0) WARN_MSG("Incomplete Cholesky replaced %u non-positive pivots by the diagonal of A", replaced);
+
+    Eigen::SparseMatrix<f64, Eigen::RowMajor> L(n,n); /**< Preconditioner L*/
+    L.resizeNonZeros(inner.size());
+    std::copy(outer.begin(),  outer.end(),  L.outerIndexPtr());
+    std::copy(inner.begin(),  inner.end(),  L.innerIndexPtr());
+    std::copy(values.begin(), values.end(), L.valuePtr());
 
     return L;
 
-}
\ No newline at end of file
+}
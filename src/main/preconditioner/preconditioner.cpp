@@ -0,0 +1,161 @@
+#include "CoreIncludes.hpp"
+#include "preconditioners.hpp"
+
+#include <algorithm>
+
+namespace Preconditioner {
+
+preconditioner::preconditioner(const Eigen::SparseMatrix<f64> &A, preconditionerType type,
+                               const Parallel::executionPolicy* policy, Mesh::orderingType ordering,
+                               const Mesh::discretizationStruct* problem)
+    : kind(type), policy(policy) {
+
+    CHECK_FATAL_ASSERT(A.rows() == A.cols(), "Number of rows and columns of sparse matrix A do not match.")
+    switch (kind){
+        case PRECONDITIONER_NONE:   break;
+        case PRECONDITIONER_JACOBI: inverseDiagonal = Jacobi(A).diagonal().cwiseInverse(); break;
+        case PRECONDITIONER_IC: {
+            if (ordering == Mesh::ORDERING_NATURAL){
+                L = incompleteCholesky(A);
+                break;
+            }
+            order = Mesh::makeOrdering(A, ordering);
+            Eigen::SparseMatrix<f64> PA;
+            Mesh::permute(order, A, PA);
+            L = incompleteCholesky(PA);
+            if (ordering == Mesh::ORDERING_MULTICOLOUR) Lt = L.transpose();
+            rp.resize(A.cols());
+            zp.resize(A.cols());
+            break;
+        }
+        case PRECONDITIONER_CHEBYSHEV: {
+            // The exact upper end when known, the Gershgorin bound (up to 1.5 times too large) otherwise. The
+            // polynomial damps the upper end of the spectrum only: over all of it, it preconditions worse at equal cost
+            chebyshevSettings defaults;
+            f64 lower = 0., upper;
+            if (problem == nullptr || !analyticBounds(*problem->grid, *problem->boundaries, problem->stencil, lower, upper)){
+                upper = gershgorinBound(A);
+            }
+            defaults.upper = upper;
+            defaults.lower = std::max(lower, upper/30.);
+            setup(A, defaults);
+            break;
+        }
+    }
+}
+
+preconditioner::preconditioner(const Eigen::SparseMatrix<f64> &A, const chebyshevSettings &settings,
+                               const Parallel::executionPolicy* policy)
+    : kind(PRECONDITIONER_CHEBYSHEV), policy(policy) {
+
+    CHECK_FATAL_ASSERT(A.rows() == A.cols(), "Number of rows and columns of sparse matrix A do not match.")
+    setup(A, settings);
+}
+
+void preconditioner::setup(const Eigen::SparseMatrix<f64> &A, const chebyshevSettings &settings){
+    CHECK_FATAL_ASSERT(settings.lower > 0. && settings.upper > settings.lower, "The Chebyshev interval needs 0 < lower < upper.")
+    this->A         = &A;
+    this->settings  = settings;
+    this->symmetric = Parallel::isSymmetric(A);
+    rs.resize(A.cols());
+    ds.resize(A.cols());
+    qs.resize(A.cols());
+    DEBUG_MSG("Chebyshev preconditioner of degree %u on [%1.4e, %1.4e]", settings.degree, settings.lower, settings.upper);
+}
+
+void preconditioner::apply(const f64* r, f64* z) const{
+
+    const u32 n = kind == PRECONDITIONER_JACOBI ? inverseDiagonal.size() : L.rows();
+    switch (kind){
+        case PRECONDITIONER_CHEBYSHEV:
+            chebyshev(r, z);
+            break;
+
+        case PRECONDITIONER_NONE:
+            CHECK_FATAL_ASSERT(false, "No preconditioner was set up, apply() is never called for M = I.")
+            break;
+
+        case PRECONDITIONER_JACOBI:
+            for (u32 i=0; i<n; i++) z[i] = inverseDiagonal[i]*r[i];
+            break;
+
+        case PRECONDITIONER_IC: {
+            if (order.natural()){
+                triangular(r, z);
+                break;
+            }
+
+            // In the numbering of L: r gathered in, z scattered back out
+            Mesh::gather(order, r, rp.data(), n);
+            if (order.type == Mesh::ORDERING_MULTICOLOUR) colouredTriangular(rp.data(), zp.data());
+            else                                          triangular(rp.data(), zp.data());
+            Mesh::scatter(order, zp.data(), z, n);
+            break;
+        }
+    }
+}
+
+void preconditioner::triangular(const f64* r, f64* z) const{
+    const u32 n = L.rows();
+    const i32* outer = L.outerIndexPtr();
+    const i32* inner = L.innerIndexPtr();
+    const f64* value = L.valuePtr();
+
+    // Forward solve L y = r, y written into z
+    for (u32 i=0; i<n; i++){
+        f64 sum = r[i];
+        for (i32 p=outer[i]; p<outer[i+1]-1; p++) sum -= value[p]*z[inner[p]];
+        z[i] = sum/value[outer[i+1]-1];
+    }
+
+    // Backward solve L^T z = y in place, row i of L being column i of L^T
+    for (u32 i=n; i-- > 0; ){
+        z[i] /= value[outer[i+1]-1];
+        for (i32 p=outer[i]; p<outer[i+1]-1; p++) z[inner[p]] -= value[p]*z[i];
+    }
+}
+
+void preconditioner::colouredTriangular(const f64* r, f64* z) const{
+    const std::vector<i32> &colours = order.colours;
+    const u32 nColours = colours.size() - 1;
+
+    // Rows of one colour only reach back to earlier colours (forward) or ahead to later ones (backward): every row of a
+    // colour is independent of the others, and is computed the same way on any number of threads
+    auto sweep = [&](u32 c, auto &rows){
+        if (policy == nullptr) { rows(colours[c], colours[c+1]); return; }
+        auto block = [&](u32 t){
+            u64 begin, end;
+            policy->range(t, colours[c+1] - colours[c], begin, end);
+            rows(colours[c] + begin, colours[c] + end);
+        };
+        policy->run(block);
+    };
+
+    // Forward solve L y = r over the rows of L, diagonal last, y written into z
+    const i32* outer = L.outerIndexPtr();
+    const i32* inner = L.innerIndexPtr();
+    const f64* value = L.valuePtr();
+    auto forward = [&](u64 begin, u64 end){
+        for (u64 i=begin; i<end; i++){
+            f64 sum = r[i];
+            for (i32 p=outer[i]; p<outer[i+1]-1; p++) sum -= value[p]*z[inner[p]];
+            z[i] = sum/value[outer[i+1]-1];
+        }
+    };
+    for (u32 c=0; c<nColours; c++) sweep(c, forward);
+
+    // Backward solve L^T z = y in place over the rows of L^T, diagonal first
+    const i32* outerT = Lt.outerIndexPtr();
+    const i32* innerT = Lt.innerIndexPtr();
+    const f64* valueT = Lt.valuePtr();
+    auto backward = [&](u64 begin, u64 end){
+        for (u64 i=begin; i<end; i++){
+            f64 sum = z[i];
+            for (i32 p=outerT[i]+1; p<outerT[i+1]; p++) sum -= valueT[p]*z[innerT[p]];
+            z[i] = sum/valueT[outerT[i]];
+        }
+    };
+    for (u32 c=nColours; c-- > 0; ) sweep(c, backward);
+}
+
+}
@@ -1,15 +1,169 @@
 #pragma once
 
 #include "CoreIncludes.hpp"
+#include "core/parallel.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/ordering.hpp"
 
 namespace Preconditioner {
 
+    /* list of preconditioners */
+    typedef enum preconditionerType{
+        PRECONDITIONER_NONE      = 0, /**< M = I */
+        PRECONDITIONER_JACOBI    = 1, /**< M = diag(A) */
+        PRECONDITIONER_IC        = 2, /**< M = L L^T, incomplete Cholesky factor without fill-in, IC(0) */
+        PRECONDITIONER_CHEBYSHEV = 3, /**< M^-1 = p(A), Chebyshev polynomial of A on an eigenvalue interval */
+    } preconditionerType;
+
+    /**< Simplistic structure holding the interval [lower, upper] a Chebyshev polynomial is built on, and its degree */
+    struct chebyshevSettings{
+        f64 lower  = 0.;  /**< lower end, the smallest eigenvalue of A (solver), or upper/ratio (smoother) */
+        f64 upper  = 0.;  /**< upper end, at least the largest eigenvalue of A */
+        u32 degree = 4;   /**< degree of the polynomial, the number of products with A per application */
+    };
+
+    /**< Simplistic structure holding the coefficient recursion of Chebyshev iteration on [lower, upper] */
+    struct chebyshevRecurrence{
+        f64 theta, delta, sigma, rho;
+
+        /**< Default construction, the first direction being d = r/theta */
+        chebyshevRecurrence(f64 lower, f64 upper)
+            : theta(0.5*(upper + lower)), delta(0.5*(upper - lower)), sigma(theta/delta), rho(delta/theta) {}
+
+        /**< Advances one step, giving the coefficients of the next direction d <- a d + c r */
+        void next(f64 &a, f64 &c){
+            const f64 rhoNext = 1./(2.*sigma - rho);
+            a   = rhoNext*rho;
+            c   = 2.*rhoNext/delta;
+            rho = rhoNext;
+        }
+    };
+
+    /**< Upper bound of the eigenvalues of A, the largest Gershgorin disc edge max_i sum_j |A_ij| */
+    f64 gershgorinBound(const Eigen::SparseMatrix<f64> &A);
+
     // Diagonal Preconditioner
-    // - see https://diamhomes.ewi.tudelft.nl/~mvangijzen/PhDCourse_DTU/LES5/TRANSPARANTEN/les5.pdf 
+    // - see https://diamhomes.ewi.tudelft.nl/~mvangijzen/PhDCourse_DTU/LES5/TRANSPARANTEN/les5.pdf
     // - see Section 4.1 https://homepage.tudelft.nl/d2b4e/burgers/lin_notes.pdf
-    Eigen::SparseMatrix<f64> Jacobi(Eigen::SparseMatrix<f64> A);
+    Eigen::SparseMatrix<f64> Jacobi(const Eigen::SparseMatrix<f64> &A);
+
+    // Incomplete Cholesky Preconditioner, L has the sparsity of the lower triangle of (symmetric) A, row by row
+    // - see Section 10.3 of "Iterative Methods for Sparse Linear Systems" by Yousef Saad 2003
+    // - see "An incomplete factorization technique for positive definite linear systems" by Manteuffel 1980
+    Eigen::SparseMatrix<f64, Eigen::RowMajor> incompleteCholesky(const Eigen::SparseMatrix<f64> &A);
+
+
+
+/************************************************************************************************************************
+ *  @brief Computes the exact eigenvalue interval of A for a uniform grid with Dirichlet faces.
+ *
+ *  @details
+ *  On a uniform grid with Dirichlet faces, the eigenvectors of the 5-point stencil are the sine modes
+ *  sin(p pi i/(imax-1)) sin(q pi j/(jmax-1)), with eigenvalues lx_p + ly_q, lx_p = 4/hx^2 sin^2(p pi/(2(imax-1))).
+ *  The smallest is at p = q = 1, and the largest at p = imax-2, q = jmax-2. The Mehrstellen stencil has the same
+ *  eigenvectors, with eigenvalues lx + ly - (hx^2+hy^2)/12 lx ly, monotone in lx and ly (hence extreme at the same
+ *  modes) unless the cells are very elongated, for which no interval is returned.
+ *
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary conditions.
+ *  @param stencil    discretization the system was assembled with.
+ *  @param lower      smallest eigenvalue, set on success.
+ *  @param upper      largest eigenvalue, set on success.
+ *
+ *  @return whether the grid is uniform with Dirichlet faces only (and the interval set).
+ ************************************************************************************************************************/
+bool analyticBounds(const Mesh::gridStruct &grid,
+                    const Mesh::boundaryStruct &boundaries,
+                    Mesh::stencilType stencil,
+                    f64 &lower,
+                    f64 &upper);
+
+
+
+/************************************************************************************************************************
+ *  @brief Applies z = M^-1 r for one of the preconditioners above, set up once for a given A.
+ *
+ *  @details
+ *  The Jacobi preconditioner keeps the inverse of the diagonal. The incomplete Cholesky one keeps L, stored row by row
+ *  such that both triangular solves run over the same arrays: the forward solve L y = r row by row, and the backward
+ *  solve L^T z = y column by column of L^T (which are the rows of L), from the last unknown up.
+ *
+ *  The incomplete Cholesky one may factor A renumbered by an ordering instead (see Mesh::makeOrdering), P A P^T = L L^T,
+ *  applying M^-1 = P^T L^-T L^-1 P by renumbering r on the way in and z on the way out. RCM keeps the rows a triangular
+ *  solve reaches back to within a band of the current one. A multicolour ordering decouples the unknowns of a colour,
+ *  hence both solves update a whole colour at once, on the threads of the policy (one synchronisation per colour and
+ *  solve): the backward one then runs over the rows of L^T, kept next to L. IC(0) of a red-black numbering is a weaker
+ *  preconditioner than the lexicographic one (more iterations), the price of triangular solves that parallelise.
+ *
+ *  The Chebyshev one keeps a reference to A, and computes z = p(A) r as degree + 1 steps of Chebyshev iteration on
+ *  A z = r from z = 0 (see chebyshevRecurrence). p(A) is the polynomial of that degree closest to A^-1 over the interval
+ *  [lower, upper], in the max norm. It is symmetric positive-definite (as CG needs) as long as every eigenvalue of A lies
+ *  in (0, upper + lower), hence upper needs to bound the spectrum from above, while lower only decides which part of
+ *  the spectrum is damped: the smallest eigenvalue for the best polynomial, or e.g. upper/30 to damp only the upper end
+ *  of it (as a multigrid smoother would). Applying it takes degree products and axpys, but no inner product: with an
+ *  execution policy, every thread updates the rows it owns, and the products are the only synchronisation.
+ *
+ *  * see Section 12.3 of "Iterative Methods for Sparse Linear Systems" by Yousef Saad 2003
+ *  * see "Parallel multigrid smoothing: polynomial versus Gauss-Seidel" by Adams, Brezina, Hu, Tuminaro 2003
+ ************************************************************************************************************************/
+class preconditioner{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction sets up the preconditioner of the given type for the (symmetric) sparse A matrix, the
+             Chebyshev one (running on the threads of the policy) on [upper/30, upper], upper the largest eigenvalue of
+             A when the discretization A was assembled from gives it (see analyticBounds), its Gershgorin bound
+             otherwise. The incomplete Cholesky one factors A in the numbering of the ordering, the others ignore it */
+        preconditioner(const Eigen::SparseMatrix<f64> &A, preconditionerType type,
+                       const Parallel::executionPolicy* policy = nullptr,
+                       Mesh::orderingType ordering = Mesh::ORDERING_NATURAL,
+                       const Mesh::discretizationStruct* problem = nullptr);
+
+        /**< Construction of the Chebyshev preconditioner of A (which needs to outlive it), on the threads of a policy */
+        preconditioner(const Eigen::SparseMatrix<f64> &A, const chebyshevSettings &settings,
+                       const Parallel::executionPolicy* policy = nullptr);
+
+        /**< Disabled construction using another preconditioner */
+        preconditioner(const preconditioner&) = delete;
+
+        /**< Disabled construction by equating to another preconditioner */
+        preconditioner& operator =(const preconditioner&) = delete;
+
+
+
+        /**< Computes z = M^-1 r, r and z of size n (they may not overlap), not from several threads at once */
+        void apply(const f64* r, f64* z) const;
+
+        /**< Type of the preconditioner */
+        preconditionerType type() const { return kind; }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        void setup(const Eigen::SparseMatrix<f64> &A, const chebyshevSettings &settings);
+        void chebyshev(const f64* r, f64* z) const;
+        void triangular(const f64* r, f64* z) const;
+        void colouredTriangular(const f64* r, f64* z) const;
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        preconditionerType kind;                           /**< which M is applied */
+        EigenDefs::Vector<f64> inverseDiagonal;            /**< Jacobi: 1/diag(A) */
+        Eigen::SparseMatrix<f64, Eigen::RowMajor> L;       /**< incomplete Cholesky: lower triangular factor, diagonal last in every row */
+        Eigen::SparseMatrix<f64, Eigen::RowMajor> Lt;      /**< incomplete Cholesky, multicolour: L^T, diagonal first in every row */
+        Mesh::ordering order;                              /**< incomplete Cholesky: numbering of L, natural unless given */
+        mutable EigenDefs::Vector<f64> rp, zp;             /**< incomplete Cholesky, renumbered: r and z in the numbering of L */
+        const Eigen::SparseMatrix<f64>* A = nullptr;       /**< Chebyshev: operator of the polynomial */
+        chebyshevSettings settings;                        /**< Chebyshev: interval and degree */
+        const Parallel::executionPolicy* policy = nullptr; /**< Chebyshev: threads of the products and updates, nullptr: serial */
+        bool symmetric = false;                            /**< Chebyshev: whether A is symmetric, as the threaded product needs */
+        mutable EigenDefs::Vector<f64> rs, ds, qs;         /**< Chebyshev: residual, direction and product scratch vectors */
 
+};
 
-    Eigen::SparseMatrix<f64> incompleteCholesky(Eigen::SparseMatrix<f64> A);
-    
-}
\ No newline at end of file
+}
@@ -0,0 +1,542 @@
+/************************************************************************************************************************
+ *  @brief Python extension module (import poisson) exposing grid setup, assembly and the Krylov solvers in-process.
+ *
+ *  @details
+ *  Written against the CPython C-API directly, such that nothing but the Python headers is needed to build it. Memory is
+ *  shared with NumPy through the buffer protocol, in both directions and without copies:
+ *    - input arrays (a sampled source term) are read in place, through the buffer the caller exported.
+ *    - the solution, forcing vector, sparse matrix and full-grid field live in the problem, and are handed out as
+ *      views onto that memory (np.asarray(problem.u) aliases the very vector the solver writes to).
+ *  The GIL is released during assembly and solves, so other Python threads keep running. A problem refuses a second
+ *  solve, and new views, while one is in progress; its views stay valid (and keep the problem alive) for as long as
+ *  they exist.
+ *
+ *  Example:
+ *
+ *  @code{.py}
+ *  import numpy as np, poisson
+ *  x = np.linspace(0, np.pi, 101); y = np.linspace(0, np.pi, 101)
+ *  p = poisson.Problem(x, y, west=np.sin(y), source=-2.2)
+ *  report = p.solve("cg", tol=1e-10)       # {'iterations': ..., 'residual': ..., 'status': 'converged'}
+ *  u = np.asarray(p.field())               # (jmax, imax), boundaries included
+ *  @endcode
+ ************************************************************************************************************************/
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "CoreIncludes.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/assembly.hpp"
+#include "mesh/boundary.hpp"
+#include "mesh/valueSource.hpp"
+#include "solver/CG.hpp"
+#include "solver/DeflatedCG.hpp"
+#include "solver/BiCGstab_l_.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace PythonModule{
+
+// ---------- //
+// array view //
+// ---------- //
+/**< A (1D or 2D, strided) view onto memory owned by another object, exported through the buffer protocol */
+struct viewObject{
+    PyObject_HEAD
+    PyObject*  owner;       /**< object owning the memory, kept alive by the view */
+    void*      data;        /**< first element */
+    char       format[2];   /**< struct-module format of an element, "d" or "i" */
+    i32        ndim;        /**< number of dimensions, 1 or 2 */
+    Py_ssize_t itemsize;    /**< bytes per element */
+    Py_ssize_t shape[2];    /**< elements per dimension */
+    Py_ssize_t strides[2];  /**< bytes between consecutive elements of a dimension */
+};
+
+static void viewDealloc(viewObject* self){
+    Py_XDECREF(self->owner);
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static int viewGetBuffer(viewObject* self, Py_buffer* view, int flags){
+    const bool contiguous = self->ndim == 1 && self->strides[0] == self->itemsize;
+    if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !contiguous){
+        PyErr_SetString(PyExc_BufferError, "view is strided, request it with strides (e.g. through numpy)");
+        return -1;
+    }
+
+    view->obj        = Py_NewRef((PyObject*) self);
+    view->buf        = self->data;
+    view->len        = self->itemsize;
+    for (i32 d=0; d<self->ndim; d++) view->len *= self->shape[d];
+    view->readonly   = 0;
+    view->itemsize   = self->itemsize;
+    view->format     = (flags & PyBUF_FORMAT) ? self->format : nullptr;
+    view->ndim       = self->ndim;
+    view->shape      = (flags & PyBUF_ND)      ? self->shape   : nullptr;
+    view->strides    = (flags & PyBUF_STRIDES) ? self->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal   = nullptr;
+    return 0;
+}
+
+static PyBufferProcs viewBuffer = { (getbufferproc) viewGetBuffer, nullptr };
+
+static PyTypeObject viewType = {
+    .ob_base      = PyVarObject_HEAD_INIT(nullptr, 0)
+    .tp_name      = "poisson.View",
+    .tp_basicsize = sizeof(viewObject),
+    .tp_dealloc   = (destructor) viewDealloc,
+    .tp_as_buffer = &viewBuffer,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "View onto memory owned by a Problem, use np.asarray(view) to get a zero-copy array.",
+};
+
+/**< Creates a view of shape (rows[, cols]) onto data owned by owner, column-major for 2D (Eigen's storage order) */
+template<typename Type> static PyObject* makeView(PyObject* owner, Type* data, Py_ssize_t rows, Py_ssize_t cols = 0){
+    viewObject* self = PyObject_New(viewObject, &viewType);
+    if (self == nullptr) return nullptr;
+    self->owner      = Py_NewRef(owner);
+    self->data       = data;
+    self->format[0]  = std::is_same_v<Type, f64> ? 'd' : 'i';
+    self->format[1]  = '\0';
+    self->itemsize   = sizeof(Type);
+    self->ndim       = cols == 0 ? 1 : 2;
+    self->shape[0]   = rows;
+    self->shape[1]   = cols;
+    self->strides[0] = sizeof(Type);
+    self->strides[1] = rows*sizeof(Type);
+    return (PyObject*) self;
+}
+
+
+
+// ------- //
+// problem //
+// ------- //
+/**< Everything a problem holds on the C++ side, kept behind a pointer such that the solvers can reference A */
+struct problemState{
+    Mesh::gridStruct grid;                                  /**< gridpoints */
+    Mesh::boundaryStruct boundaries;                        /**< boundary values and condition types */
+    Mesh::sourceFunction source;                            /**< value source f(x,y) */
+    Mesh::stencilType stencil;                              /**< discretization */
+    std::unique_ptr<Py_buffer> sourceBuffer;                /**< sampled source f(j,i), held when given as an array */
+
+    Eigen::SparseMatrix<f64> A;                             /**< assembled sparse matrix */
+    EigenDefs::Vector<f64> u, b;                            /**< solution and forcing vectors */
+    EigenDefs::Array2D<f64> field;                          /**< full-grid solution u(j,i) */
+
+    std::unique_ptr<KrylovSolver::CG> cg;                   /**< solvers, built on first use and kept for the next solve */
+    std::unique_ptr<KrylovSolver::DeflatedCG> deflated;
+    std::unique_ptr<KrylovSolver::BiCGstab<8>> bicgstab;
+    bool busy = false;                                      /**< a solve (or assembly) is running with the GIL released */
+};
+
+struct problemObject{
+    PyObject_HEAD
+    problemState* state;
+};
+
+/**< Parses "dirichlet", "neumann", "periodic" or "robin:<alpha>:<beta>" */
+static bool parseCondition(const char* value, Mesh::faceCondition &condition){
+    condition = Mesh::faceCondition{};
+    if (std::strcmp(value, "dirichlet") == 0) { condition.type = Mesh::BC_DIRICHLET; return true; }
+    if (std::strcmp(value, "neumann")   == 0) { condition.type = Mesh::BC_NEUMANN;   return true; }
+    if (std::strcmp(value, "periodic")  == 0) { condition.type = Mesh::BC_PERIODIC;  return true; }
+    condition.type = Mesh::BC_ROBIN;
+    return std::sscanf(value, "robin:%lf:%lf", &condition.alpha, &condition.beta) == 2 && condition.beta != 0.;
+}
+
+/**< Reads a 1D float64 array (any strides) of the given size, or a float broadcast to that size */
+static bool parseArray(PyObject* object, u32 size, const char* name, EigenDefs::Array1D<f64> &values){
+    if (object == nullptr || PyFloat_Check(object) || PyLong_Check(object)){
+        f64 c = object == nullptr ? 0. : PyFloat_AsDouble(object);
+        if (PyErr_Occurred()) return false;
+        values.setConstant(size, c);
+        return true;
+    }
+
+    Py_buffer buffer;
+    if (PyObject_GetBuffer(object, &buffer, PyBUF_STRIDES | PyBUF_FORMAT) != 0) return false;
+    bool ok = buffer.ndim == 1 && buffer.shape[0] == size && std::strcmp(buffer.format, "d") == 0;
+    if (ok){
+        Eigen::Map< const EigenDefs::Array1D<f64>, 0, Eigen::InnerStride<> >
+            map((const f64*) buffer.buf, size, Eigen::InnerStride<>(buffer.strides[0]/sizeof(f64)));
+        values = map;
+    } else {
+        PyErr_Format(PyExc_ValueError, "%s needs to be a float or a 1D float64 array of size %u", name, size);
+    }
+    PyBuffer_Release(&buffer);
+    return ok;
+}
+
+/**< Sets the value source from None (valueSource), a float, or a 2D float64 array f(j,i) sampled on the grid */
+static bool parseSource(PyObject* object, problemState &state){
+
+    // The new source is parsed aside, the current one (and the buffer it reads) is only replaced once it is valid
+    Mesh::sourceFunction source;
+    std::unique_ptr<Py_buffer> buffer;
+    if (object == nullptr || object == Py_None){
+        source = valueSource;
+    } else if (PyFloat_Check(object) || PyLong_Check(object)){
+        f64 f = PyFloat_AsDouble(object);
+        if (PyErr_Occurred()) return false;
+        source = [f](f64, f64){ return f; };
+    } else {
+        // The array is read in place: the buffer is held (so it cannot be resized or freed) until replaced or the problem dies
+        const u32 imax = state.grid.x.size();
+        const u32 jmax = state.grid.y.size();
+        buffer = std::make_unique<Py_buffer>();
+        if (PyObject_GetBuffer(object, buffer.get(), PyBUF_STRIDES | PyBUF_FORMAT) != 0) return false;
+        if (buffer->ndim != 2 || buffer->shape[0] != jmax || buffer->shape[1] != imax || std::strcmp(buffer->format, "d") != 0){
+            PyBuffer_Release(buffer.get());
+            PyErr_Format(PyExc_ValueError, "source needs to be a float or a float64 array of shape (jmax, imax) = (%u, %u)", jmax, imax);
+            return false;
+        }
+
+        // The assembly only evaluates f on the gridpoints, which are found back by bisection
+        const Mesh::gridStruct &grid = state.grid;
+        const Py_buffer* view = buffer.get();
+        source = [&grid, view](f64 x, f64 y){
+            Py_ssize_t i = std::lower_bound(grid.x.data(), grid.x.data() + grid.x.size(), x) - grid.x.data();
+            Py_ssize_t j = std::lower_bound(grid.y.data(), grid.y.data() + grid.y.size(), y) - grid.y.data();
+            return *(const f64*) ((const char*) view->buf + j*view->strides[0] + i*view->strides[1]);
+        };
+    }
+
+    if (state.sourceBuffer) PyBuffer_Release(state.sourceBuffer.get());
+    state.sourceBuffer = std::move(buffer);
+    state.source       = std::move(source);
+    return true;
+}
+
+/**< Marks the problem busy, raising if it already is */
+static bool acquire(problemObject* self){
+    if (self->state->busy){
+        PyErr_SetString(PyExc_RuntimeError, "problem is being solved (or assembled) in another thread");
+        return false;
+    }
+    self->state->busy = true;
+    return true;
+}
+
+static void problemDealloc(problemObject* self){
+    if (self->state != nullptr){
+        if (self->state->sourceBuffer) PyBuffer_Release(self->state->sourceBuffer.get());
+        delete self->state;
+    }
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static PyObject* problemNew(PyTypeObject* type, PyObject*, PyObject*){
+    problemObject* self = (problemObject*) type->tp_alloc(type, 0);
+    if (self != nullptr) self->state = nullptr;
+    return (PyObject*) self;
+}
+
+static int problemInit(problemObject* self, PyObject* args, PyObject* kwargs){
+
+    static const char* keywords[] = {"x", "y", "north", "south", "east", "west",
+                                     "northbc", "southbc", "eastbc", "westbc", "source", "stencil", nullptr};
+    PyObject *x, *y, *north = nullptr, *south = nullptr, *east = nullptr, *west = nullptr, *source = nullptr;
+    const char *northbc = "dirichlet", *southbc = "dirichlet", *eastbc = "dirichlet", *westbc = "dirichlet";
+    u32 stencilPoints = 5;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|$OOOOssssOI", (char**) keywords, &x, &y,
+                                     &north, &south, &east, &west, &northbc, &southbc, &eastbc, &westbc, &source, &stencilPoints)) return -1;
+
+    if (self->state != nullptr){
+        PyErr_SetString(PyExc_RuntimeError, "problem is already initialised");
+        return -1;
+    }
+    std::unique_ptr<problemState> state = std::make_unique<problemState>();
+
+    // Grid, the gridpoints need to be increasing (the sampled source is looked up by bisection)
+    Py_ssize_t imax = PyObject_Length(x), jmax = PyObject_Length(y);
+    if (imax < 0 || jmax < 0) return -1;
+    if (imax < 4 || jmax < 4){
+        PyErr_SetString(PyExc_ValueError, "x and y need at least 4 gridpoints each");
+        return -1;
+    }
+    if (!parseArray(x, imax, "x", state->grid.x) || !parseArray(y, jmax, "y", state->grid.y)) return -1;
+    for (const EigenDefs::Array1D<f64>* points : {&state->grid.x, &state->grid.y}){
+        for (Py_ssize_t i=1; i<points->size(); i++){
+            if ((*points)[i] > (*points)[i-1]) continue;
+            PyErr_SetString(PyExc_ValueError, "x and y need to be strictly increasing");
+            return -1;
+        }
+    }
+
+    // Boundaries, checked here since the C++ side treats inconsistent conditions as fatal
+    Mesh::boundaryStruct &boundaries = state->boundaries;
+    if (!parseArray(north, imax, "north", boundaries.North) || !parseArray(south, imax, "south", boundaries.South) ||
+        !parseArray(east,  jmax, "east",  boundaries.East)  || !parseArray(west,  jmax, "west",  boundaries.West)) return -1;
+    if (!parseCondition(northbc, boundaries.NorthBC) || !parseCondition(southbc, boundaries.SouthBC) ||
+        !parseCondition(eastbc,  boundaries.EastBC)  || !parseCondition(westbc,  boundaries.WestBC)){
+        PyErr_SetString(PyExc_ValueError, "boundary conditions are dirichlet, neumann, periodic or robin:<alpha>:<beta> (beta != 0)");
+        return -1;
+    }
+    if ((boundaries.WestBC.type  == Mesh::BC_PERIODIC) != (boundaries.EastBC.type  == Mesh::BC_PERIODIC) ||
+        (boundaries.SouthBC.type == Mesh::BC_PERIODIC) != (boundaries.NorthBC.type == Mesh::BC_PERIODIC)){
+        PyErr_SetString(PyExc_ValueError, "periodic conditions need to be set on opposite faces");
+        return -1;
+    }
+
+    // Stencil, the Mehrstellen one needs a uniform spacing and Dirichlet/periodic faces
+    if (stencilPoints != 5 && stencilPoints != 9){
+        PyErr_SetString(PyExc_ValueError, "stencil is 5 (2nd-order) or 9 (4th-order Mehrstellen)");
+        return -1;
+    }
+    state->stencil = stencilPoints == 9 ? Mesh::STENCIL_MEHRSTELLEN : Mesh::STENCIL_5POINT;
+    if (state->stencil == Mesh::STENCIL_MEHRSTELLEN){
+        for (const Mesh::faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+            if (face->type == Mesh::BC_DIRICHLET || face->type == Mesh::BC_PERIODIC) continue;
+            PyErr_SetString(PyExc_ValueError, "stencil=9 only supports dirichlet and periodic conditions");
+            return -1;
+        }
+        for (const EigenDefs::Array1D<f64>* points : {&state->grid.x, &state->grid.y}){
+            const f64 h = ((*points)[points->size()-1] - (*points)[0])/(points->size()-1);
+            for (Py_ssize_t i=1; i<points->size(); i++){
+                if (std::abs((*points)[i] - (*points)[i-1] - h) < 1e-8*h) continue;
+                PyErr_SetString(PyExc_ValueError, "stencil=9 needs a uniform spacing in x and in y");
+                return -1;
+            }
+        }
+    }
+
+    if (!parseSource(source, *state)) return -1;
+    self->state = state.release();
+
+    // Assembly
+    problemState &s = *self->state;
+    s.busy = true;
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        Mesh::assemblePoisson(s.grid, s.boundaries, s.source, s.A, s.b, s.stencil);
+        s.A.makeCompressed();
+        s.u.setZero(s.b.size());
+    } catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    s.busy = false;
+    if (failed) { PyErr_NoMemory(); return -1; }
+    return 0;
+}
+
+/**< Fails unless the problem went through __init__ */
+static problemState* initialised(problemObject* self){
+    if (self->state == nullptr) PyErr_SetString(PyExc_RuntimeError, "problem is not initialised");
+    return self->state;
+}
+
+/**< Same as above, failing as well while a solve (or assembly) writes to the vectors and the matrix */
+static problemState* idle(problemObject* self){
+    problemState* s = initialised(self);
+    if (s == nullptr || !s->busy) return s;
+    PyErr_SetString(PyExc_RuntimeError, "problem is being solved (or assembled) in another thread");
+    return nullptr;
+}
+
+static PyObject* problemAssemble(problemObject* self, PyObject* args, PyObject* kwargs){
+
+    static const char* keywords[] = {"source", nullptr};
+    PyObject* source = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char**) keywords, &source)) return nullptr;
+    problemState* s = initialised(self);
+    if (s == nullptr || !acquire(self)) return nullptr;
+    if (!parseSource(source, *s)) { s->busy = false; return nullptr; }
+
+    // Only the forcing vector depends on the source, b is refilled in place (views onto it stay valid)
+    Py_BEGIN_ALLOW_THREADS
+    Mesh::assembleForcing(s->grid, s->boundaries, s->source, s->b, s->stencil);
+    Py_END_ALLOW_THREADS
+    s->busy = false;
+    Py_RETURN_NONE;
+}
+
+static PyObject* problemSolve(problemObject* self, PyObject* args, PyObject* kwargs){
+
+    static const char* keywords[] = {"method", "tol", "rtol", "disc", "maxiter", "replacement", nullptr};
+    const char* method = "cg";
+    f64 tol = 1e-10, rtol = 0., disc = 0.;
+    u32 maxiter = 5000, replacement = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|s$dddII", (char**) keywords,
+                                     &method, &tol, &rtol, &disc, &maxiter, &replacement)) return nullptr;
+    problemState* s = initialised(self);
+    if (s == nullptr) return nullptr;
+    if (std::strcmp(method, "cg") != 0 && std::strcmp(method, "deflated") != 0 && std::strcmp(method, "bicgstab") != 0){
+        PyErr_Format(PyExc_ValueError, "unknown method '%s', expected cg, deflated or bicgstab", method);
+        return nullptr;
+    }
+    if (!acquire(self)) return nullptr;
+
+    KrylovSolver::convergenceCriteria criteria;
+    criteria.absolute    = tol;
+    criteria.relative    = rtol;
+    criteria.maxiter     = maxiter;
+    criteria.replacement = replacement;
+
+    // The solvers (with their workspaces, and the deflation space) are built once, and reused by the next solves
+    KrylovSolver::solveReport report;
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        if (disc > 0.) criteria.discretization = KrylovSolver::discretizationTolerance(s->grid, s->boundaries, s->source, disc, s->stencil);
+        if (method[0] == 'c'){
+            if (!s->cg) s->cg = std::make_unique<KrylovSolver::CG>(s->A);
+            report = s->cg->solve(s->u, s->b, criteria);
+        } else if (method[0] == 'd'){
+            if (!s->deflated) s->deflated = std::make_unique<KrylovSolver::DeflatedCG>(s->A);
+            report = s->deflated->solve(s->u, s->b, criteria);
+        } else {
+            if (!s->bicgstab) s->bicgstab = std::make_unique< KrylovSolver::BiCGstab<8> >(s->A);
+            report = s->bicgstab->solve(s->u, s->b, criteria);
+        }
+        if (Mesh::isSingular(s->boundaries)) Mesh::removeNullspace(s->u);
+    } catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    s->busy = false;
+    if (failed) return PyErr_NoMemory();
+
+    return Py_BuildValue("{s:I,s:d,s:s,s:d,s:d,s:d}", "iterations", report.iterations, "residual", report.residual,
+                         "status", KrylovSolver::statusName(report.status),
+                         "lambda_min", report.spectrum.lambdaMin, "lambda_max", report.spectrum.lambdaMax,
+                         "condition", report.spectrum.condition());
+}
+
+static PyObject* problemField(problemObject* self, PyObject*){
+    problemState* s = idle(self);
+    if (s == nullptr) return nullptr;
+
+    // Scattered into the field in place, so earlier views onto it see the latest solution as well
+    Mesh::scatterSolution(s->grid, s->boundaries, s->u, s->field);
+    return makeView((PyObject*) self, s->field.data(), s->field.rows(), s->field.cols());
+}
+
+static PyObject* problemMatrix(problemObject* self, PyObject*){
+    problemState* s = idle(self);
+    if (s == nullptr) return nullptr;
+
+    // Compressed sparse column arrays, e.g. scipy.sparse.csc_matrix((data, indices, indptr), shape=(n, n))
+    PyObject* data    = makeView((PyObject*) self, s->A.valuePtr(),      s->A.nonZeros());
+    PyObject* indices = makeView((PyObject*) self, s->A.innerIndexPtr(), s->A.nonZeros());
+    PyObject* indptr  = makeView((PyObject*) self, s->A.outerIndexPtr(), s->A.outerSize()+1);
+    if (data == nullptr || indices == nullptr || indptr == nullptr){
+        Py_XDECREF(data); Py_XDECREF(indices); Py_XDECREF(indptr);
+        return nullptr;
+    }
+    return Py_BuildValue("(NNN)", data, indices, indptr);
+}
+
+static PyObject* problemGetU(problemObject* self, void*){
+    problemState* s = idle(self);
+    return s == nullptr ? nullptr : makeView((PyObject*) self, s->u.data(), s->u.size());
+}
+
+static PyObject* problemGetB(problemObject* self, void*){
+    problemState* s = idle(self);
+    return s == nullptr ? nullptr : makeView((PyObject*) self, s->b.data(), s->b.size());
+}
+
+static PyObject* problemGetN(problemObject* self, void*){
+    problemState* s = initialised(self);
+    return s == nullptr ? nullptr : PyLong_FromLong(s->u.size());
+}
+
+static PyObject* problemGetShape(problemObject* self, void*){
+    problemState* s = initialised(self);
+    return s == nullptr ? nullptr : Py_BuildValue("(nn)", (Py_ssize_t) s->grid.y.size(), (Py_ssize_t) s->grid.x.size());
+}
+
+static PyMethodDef problemMethods[] = {
+    {"solve",    (PyCFunction)(void(*)(void)) problemSolve,    METH_VARARGS | METH_KEYWORDS,
+     "solve(method='cg', *, tol=1e-10, rtol=0, disc=0, maxiter=5000, replacement=0) -> dict\n\n"
+     "Solves Au = b in place, starting from the current u. method is cg, deflated or bicgstab. The solve stops below the\n"
+     "largest of tol, rtol*rms(b) and disc times the truncation error estimate (RMS residuals). cg also reports the\n"
+     "extreme eigenvalues of A it estimated (lambda_min, lambda_max, condition), 0 for the other methods."},
+    {"assemble", (PyCFunction)(void(*)(void)) problemAssemble, METH_VARARGS | METH_KEYWORDS,
+     "assemble(source=None)\n\nReassembles b for a new source (float, or float64 array f(j,i)), A is kept."},
+    {"field",    (PyCFunction) problemField,  METH_NOARGS,
+     "field() -> View\n\nScatters u onto the full grid, boundaries included, and returns a (jmax, imax) view of it."},
+    {"matrix",   (PyCFunction) problemMatrix, METH_NOARGS,
+     "matrix() -> (data, indices, indptr)\n\nViews onto the compressed sparse column arrays of A."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef problemGetSet[] = {
+    {"u",     (getter) problemGetU,     nullptr, "View onto the solution vector (the unknowns), writable to set an initial guess.", nullptr},
+    {"b",     (getter) problemGetB,     nullptr, "View onto the forcing vector.", nullptr},
+    {"n",     (getter) problemGetN,     nullptr, "Number of unknowns.", nullptr},
+    {"shape", (getter) problemGetShape, nullptr, "Grid shape (jmax, imax).", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PyTypeObject problemType = {
+    .ob_base      = PyVarObject_HEAD_INIT(nullptr, 0)
+    .tp_name      = "poisson.Problem",
+    .tp_basicsize = sizeof(problemObject),
+    .tp_dealloc   = (destructor) problemDealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Problem(x, y, *, north=0, south=0, east=0, west=0, northbc='dirichlet', southbc='dirichlet',\n"
+                    "        eastbc='dirichlet', westbc='dirichlet', source=None, stencil=5)\n\n"
+                    "Assembles -div(grad(u)) = f on the grid x, y (increasing float64 arrays). Boundary values are floats\n"
+                    "or float64 arrays (north/south of size imax, east/west of size jmax), conditions are dirichlet,\n"
+                    "neumann, periodic or robin:<alpha>:<beta>. The source is None (the built-in one), a float, or a\n"
+                    "float64 array f(j,i) of shape (jmax, imax), read in place. The stencil is 5 (2nd-order) or 9 (4th-order\n"
+                    "Mehrstellen, uniform spacing with dirichlet/periodic conditions only).",
+    .tp_methods   = problemMethods,
+    .tp_getset    = problemGetSet,
+    .tp_init      = (initproc) problemInit,
+    .tp_new       = problemNew,
+};
+
+
+
+// ------ //
+// module //
+// ------ //
+static PyObject* moduleVerbose(PyObject*, PyObject* args){
+    i32 verbose;
+    if (!PyArg_ParseTuple(args, "p", &verbose)) return nullptr;
+    logSetLevel(verbose ? LOG_LEVEL_TRACE : LOG_LEVEL_WARN);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef moduleMethods[] = {
+    {"verbose", moduleVerbose, METH_VARARGS, "verbose(flag)\n\nWrites the info/debug messages of the solvers (off by default)."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef moduleDef = {
+    .m_base    = PyModuleDef_HEAD_INIT,
+    .m_name    = "poisson",
+    .m_doc     = "Finite difference Poisson solver, sharing its vectors with NumPy through the buffer protocol.",
+    .m_size    = -1,
+    .m_methods = moduleMethods,
+};
+
+} // namespace PythonModule
+
+PyMODINIT_FUNC PyInit_poisson(void){
+    using namespace PythonModule;
+
+    // The per-iteration solver messages would flood the interpreter's stdout
+    logSetLevel(LOG_LEVEL_WARN);
+
+    if (PyType_Ready(&viewType) < 0 || PyType_Ready(&problemType) < 0) return nullptr;
+    PyObject* module = PyModule_Create(&moduleDef);
+    if (module == nullptr) return nullptr;
+    if (PyModule_AddObjectRef(module, "Problem", (PyObject*) &problemType) < 0 ||
+        PyModule_AddObjectRef(module, "View",    (PyObject*) &viewType)    < 0){
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
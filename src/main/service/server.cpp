@@ -0,0 +1,407 @@
+#include "CoreIncludes.hpp"
+#include "core/signature.hpp"
+#include "server.hpp"
+#include "mesh/assembly.hpp"
+#include "mesh/boundary.hpp"
+#include "mesh/valueSource.hpp"
+#include "post/derivedFields.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Service{
+
+/**< Simplistic structure describing the values on one face, value(s) = constant + amplitude*sin(s) */
+struct faceSpec{
+    f64 constant  = 0.;
+    f64 amplitude = 0.;
+    Mesh::faceCondition condition;
+};
+
+/**< Simplistic structure describing one solve request */
+struct problemSpec{
+    std::string id = "0";
+    u32 imax = 101, jmax = 101;
+    f64 lx = EIGEN_PI, ly = EIGEN_PI;
+    faceSpec north, south, east, west;
+    bool constantSource = false;
+    f64 source = 0.;
+    f64 tol = 1e-10;
+    f64 rtol = 0.;
+    f64 disc = 0.;
+    u32 maxiter = 5000;
+    Mesh::stencilType stencil = Mesh::STENCIL_5POINT;
+    InitialGuess::guessType guess = InitialGuess::GUESS_PROJECTED;
+    Preconditioner::preconditionerType precond = Preconditioner::PRECONDITIONER_NONE;
+    std::string out;
+    bool rows = false;
+};
+
+static const char* guessNames[4] = {"zero", "previous", "coarse", "projected"};
+static const char* preconditionerNames[4] = {"none", "jacobi", "ic", "chebyshev"};
+
+/**< Parses "dirichlet", "neumann", "periodic" or "robin:<alpha>:<beta>" */
+static bool parseCondition(const std::string &value, Mesh::faceCondition &condition){
+    condition = Mesh::faceCondition{};
+    if (value == "dirichlet") { condition.type = Mesh::BC_DIRICHLET; return true; }
+    if (value == "neumann")   { condition.type = Mesh::BC_NEUMANN;   return true; }
+    if (value == "periodic")  { condition.type = Mesh::BC_PERIODIC;  return true; }
+    condition.type = Mesh::BC_ROBIN;
+    return std::sscanf(value.c_str(), "robin:%lf:%lf", &condition.alpha, &condition.beta) == 2 && condition.beta != 0.;
+}
+
+/**< Parses "<c>", "sin" or "<c>*sin" */
+static bool parseFace(const std::string &value, faceSpec &face){
+    char* end;
+    face.constant  = 0.;
+    face.amplitude = 0.;
+    if (value == "sin") { face.amplitude = 1.; return true; }
+    f64 c = std::strtod(value.c_str(), &end);
+    if (end == value.c_str()) return false;
+    if (*end == '\0')                 { face.constant  = c; return true; }
+    if (std::strcmp(end, "*sin") == 0) { face.amplitude = c; return true; }
+    return false;
+}
+
+/**< Parses the key=value pairs of a solve request, returns an error message or an empty string */
+static std::string parseSpec(std::istringstream &tokens, problemSpec &spec){
+    std::string token;
+    while (tokens >> token){
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) return "expected key=value, got '" + token + "'";
+        std::string key   = token.substr(0, eq);
+        std::string value = token.substr(eq+1);
+        char* end;
+        bool ok = true;
+
+        if      (key == "id")      { spec.id = value; }
+        else if (key == "imax")    { spec.imax    = std::strtoul(value.c_str(), &end, 10); ok = *end == '\0' && spec.imax > 3; }
+        else if (key == "jmax")    { spec.jmax    = std::strtoul(value.c_str(), &end, 10); ok = *end == '\0' && spec.jmax > 3; }
+        else if (key == "lx")      { spec.lx      = std::strtod(value.c_str(), &end);      ok = *end == '\0' && spec.lx > 0.; }
+        else if (key == "ly")      { spec.ly      = std::strtod(value.c_str(), &end);      ok = *end == '\0' && spec.ly > 0.; }
+        else if (key == "tol")     { spec.tol     = std::strtod(value.c_str(), &end);      ok = *end == '\0' && spec.tol > 0.; }
+        else if (key == "rtol")    { spec.rtol    = std::strtod(value.c_str(), &end);      ok = *end == '\0' && spec.rtol >= 0.; }
+        else if (key == "disc")    { spec.disc    = std::strtod(value.c_str(), &end);      ok = *end == '\0' && spec.disc >= 0.; }
+        else if (key == "maxiter") { spec.maxiter = std::strtoul(value.c_str(), &end, 10); ok = *end == '\0'; }
+        else if (key == "source")  { spec.source  = std::strtod(value.c_str(), &end);      ok = *end == '\0'; spec.constantSource = true; }
+        else if (key == "north")   { ok = parseFace(value, spec.north); }
+        else if (key == "south")   { ok = parseFace(value, spec.south); }
+        else if (key == "east")    { ok = parseFace(value, spec.east);  }
+        else if (key == "west")    { ok = parseFace(value, spec.west);  }
+        else if (key == "northbc") { ok = parseCondition(value, spec.north.condition); }
+        else if (key == "southbc") { ok = parseCondition(value, spec.south.condition); }
+        else if (key == "eastbc")  { ok = parseCondition(value, spec.east.condition);  }
+        else if (key == "westbc")  { ok = parseCondition(value, spec.west.condition);  }
+        else if (key == "stencil") { ok = value == "5" || value == "9"; spec.stencil = value == "9" ? Mesh::STENCIL_MEHRSTELLEN : Mesh::STENCIL_5POINT; }
+        else if (key == "out")     { spec.out  = value; }
+        else if (key == "rows")    { spec.rows = value == "1"; }
+        else if (key == "guess")   {
+            ok = false;
+            for (u32 g=0; g<4; g++){
+                if (value == guessNames[g]) { spec.guess = (InitialGuess::guessType) g; ok = true; }
+            }
+        }
+        else if (key == "precond") {
+            ok = false;
+            for (u32 p=0; p<4; p++){
+                if (value == preconditionerNames[p]) { spec.precond = (Preconditioner::preconditionerType) p; ok = true; }
+            }
+        }
+        else return "unknown key '" + key + "'";
+
+        if (!ok) return "invalid value for '" + key + "'";
+    }
+    return "";
+}
+
+bool requested(i32 argc, char* argv[]){
+    for (i32 a=1; a<argc; a++){
+        if (std::strncmp(argv[a], "--server", 8) == 0) return true;
+    }
+    return false;
+}
+
+i32 run(i32 argc, char* argv[]){
+
+    const char* socketPath = nullptr;
+    u32  poolSize = 4;
+    u32  nThreads = 0;
+    bool verbose  = false;
+    for (i32 a=1; a<argc; a++){
+        if      (std::strncmp(argv[a], "--server=", 9) == 0) socketPath = argv[a] + 9;
+        else if (std::strncmp(argv[a], "--pool=",   7) == 0) poolSize   = std::strtoul(argv[a] + 7, nullptr, 10);
+        else if (std::strncmp(argv[a], "--threads=",10) == 0) nThreads   = std::strtoul(argv[a] + 10, nullptr, 10);
+        else if (std::strcmp (argv[a], "--verbose")    == 0) verbose    = true;
+    }
+    CHECK_FATAL_ASSERT(poolSize > 0, "Pool needs to hold at least one grid.")
+
+    // Log messages stay off the protocol stream, the per-iteration solver messages would drown stderr
+    logUseStderr(true);
+    if (!verbose) logSetLevel(LOG_LEVEL_WARN);
+
+    solveServer server(poolSize, nThreads);
+
+    // stdin/stdout
+    if (socketPath == nullptr){
+        server.serve(stdin, stdout);
+        return EXIT_SUCCESS;
+    }
+
+    // Unix domain socket, one client at a time
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    CHECK_FATAL_ASSERT(std::strlen(socketPath) < sizeof(address.sun_path), "Socket path is too long.")
+    std::strncpy(address.sun_path, socketPath, sizeof(address.sun_path)-1);
+
+    i32 listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK_FATAL_ASSERT(listener >= 0, "Could not create socket.")
+    unlink(socketPath);
+    CHECK_FATAL_ASSERT(bind(listener, (sockaddr*) &address, sizeof(address)) == 0, "Could not bind socket.")
+    CHECK_FATAL_ASSERT(listen(listener, 8) == 0, "Could not listen on socket.")
+    WARN_MSG("Serving on %s", socketPath);
+
+    bool running = true;
+    i32  status  = EXIT_SUCCESS;
+    while (running){
+        i32 client = accept(listener, nullptr, nullptr);
+        if (client < 0){
+            // Retrying a persistent error (EMFILE, EBADF, ...) would only spin
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            ERROR_MSG("Could not accept a client on %s: %s", socketPath, std::strerror(errno));
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        // Separate streams for reading and writing, each owning its own descriptor
+        i32   copy = dup(client);
+        FILE* in   = fdopen(client, "r");
+        FILE* out  = copy >= 0 ? fdopen(copy, "w") : nullptr;
+        if (in == nullptr || out == nullptr){
+            ERROR_MSG("Could not open the streams of a client on %s: %s", socketPath, std::strerror(errno));
+            if (in  != nullptr) fclose(in);  else close(client);
+            if (out != nullptr) fclose(out); else if (copy >= 0) close(copy);
+            continue;
+        }
+        running = server.serve(in, out);
+        fclose(out);
+        fclose(in);
+    }
+
+    close(listener);
+    unlink(socketPath);
+    return status;
+}
+
+solveServer::solveServer(u32 poolSize, u32 nThreads)
+    : poolSize(poolSize), exporter(IO::tileSettings{.codec = IO::CODEC_LOSSLESS}), policy(nThreads), requests(0), hits(0), misses(0) {}
+
+bool solveServer::serve(FILE* in, FILE* out){
+
+    char*  buffer   = nullptr;
+    size_t capacity = 0;
+    bool   running  = true;
+
+    while (getline(&buffer, &capacity, in) > 0){
+        std::istringstream tokens(buffer);
+        std::string command;
+        if (!(tokens >> command) || command[0] == '#') continue;
+
+        if (command == "solve"){
+            solve(buffer, out);
+        } else if (command == "stats"){
+            stats(out);
+        } else if (command == "sync"){
+            for (const IO::failedExport &failed : exporter.wait()){
+                fprintf(out, "error %s could not write '%s'\n", exportIds[failed.ticket].c_str(), failed.fileName.c_str());
+            }
+            exportIds.clear();
+            fprintf(out, "ok synced\n");
+        } else if (command == "drop"){
+            pool.clear();
+            cache.clear();
+            fprintf(out, "ok dropped\n");
+        } else if (command == "quit"){
+            break;
+        } else if (command == "shutdown"){
+            running = false;
+            break;
+        } else {
+            fprintf(out, "error 0 unknown command '%s'\n", command.c_str());
+        }
+        fflush(out);
+    }
+
+    free(buffer);
+    return running;
+}
+
+void solveServer::stats(FILE* out){
+
+    // Per-socket placement of the pooled workspaces
+    std::vector<u64> pages(policy.nodes()+1, 0), entryPages;
+    for (auto &[key, entry] : pool){
+        if (!entry->work || !policy.placement(entry->work->data(), entry->work->used(), entryPages)) continue;
+        for (u32 k=0; k<=policy.nodes(); k++) pages[k] += entryPages[k];
+    }
+
+    fprintf(out, "stats pools=%zu hits=%llu misses=%llu solves=%llu threads=%u pages=", 
+            pool.size(), hits, misses, requests, policy.threads());
+    for (u32 k=0; k<=policy.nodes(); k++) fprintf(out, k < policy.nodes() ? "%llu/" : "%llu\n", pages[k]);
+}
+
+solveServer::poolEntry& solveServer::acquire(const Mesh::gridStruct &grid, const Mesh::boundaryStruct &boundaries, 
+                                             Mesh::stencilType stencil, Preconditioner::preconditionerType precond, bool &pooled){
+
+    // The stencil and boundary condition types change A (and its size), the boundary values only b. The
+    // preconditioner decides which solver is set up for A
+    u64 key = hashBytes(grid.x.data(), grid.x.size()*sizeof(f64));
+    key     = hashBytes(grid.y.data(), grid.y.size()*sizeof(f64), key);
+    key     = hashBytes(&stencil, sizeof(stencil), key);
+    key     = hashBytes(&precond, sizeof(precond), key);
+    for (const Mesh::faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        key = hashBytes(&face->type,  sizeof(face->type),  key);
+        key = hashBytes(&face->alpha, sizeof(face->alpha), key);
+        key = hashBytes(&face->beta,  sizeof(face->beta),  key);
+    }
+
+    auto found = pool.find(key);
+    pooled = found != pool.end();
+    if (pooled){
+        hits++;
+        found->second->lastUsed = requests;
+        return *found->second;
+    }
+    misses++;
+
+    // Evict the least recently used grid
+    if (pool.size() >= poolSize){
+        auto oldest = pool.begin();
+        for (auto it = pool.begin(); it != pool.end(); it++){
+            if (it->second->lastUsed < oldest->second->lastUsed) oldest = it;
+        }
+        pool.erase(oldest);
+    }
+
+    std::unique_ptr<poolEntry> entry = std::make_unique<poolEntry>();
+    entry->grid     = grid;
+    entry->lastUsed = requests;
+    return *(pool[key] = std::move(entry));
+}
+
+void solveServer::solve(const std::string &line, FILE* out){
+
+    using clock = std::chrono::steady_clock;
+    clock::time_point start = clock::now();
+
+    // Parse request
+    std::istringstream tokens(line);
+    std::string command;
+    tokens >> command;
+    problemSpec spec;
+    std::string message = parseSpec(tokens, spec);
+    if (!message.empty()){
+        fprintf(out, "error %s %s\n", spec.id.c_str(), message.c_str());
+        return;
+    }
+    requests++;
+
+    // Problem setup
+    Mesh::gridStruct grid;
+    grid.x.setLinSpaced(spec.imax, 0., spec.lx);
+    grid.y.setLinSpaced(spec.jmax, 0., spec.ly);
+
+    Mesh::boundaryStruct boundaries;
+    boundaries.North = spec.north.constant + spec.north.amplitude*Eigen::sin(grid.x);
+    boundaries.South = spec.south.constant + spec.south.amplitude*Eigen::sin(grid.x);
+    boundaries.East  = spec.east.constant  + spec.east.amplitude *Eigen::sin(grid.y);
+    boundaries.West  = spec.west.constant  + spec.west.amplitude *Eigen::sin(grid.y);
+    boundaries.NorthBC = spec.north.condition;
+    boundaries.SouthBC = spec.south.condition;
+    boundaries.EastBC  = spec.east.condition;
+    boundaries.WestBC  = spec.west.condition;
+    if ((boundaries.WestBC.type  == Mesh::BC_PERIODIC) != (boundaries.EastBC.type  == Mesh::BC_PERIODIC) ||
+        (boundaries.SouthBC.type == Mesh::BC_PERIODIC) != (boundaries.NorthBC.type == Mesh::BC_PERIODIC)){
+        fprintf(out, "error %s periodic conditions need to be set on opposite faces\n", spec.id.c_str());
+        return;
+    }
+    for (const Mesh::faceCondition* face : {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC}){
+        if (spec.stencil != Mesh::STENCIL_MEHRSTELLEN || face->type == Mesh::BC_DIRICHLET || face->type == Mesh::BC_PERIODIC) continue;
+        fprintf(out, "error %s stencil=9 only supports dirichlet and periodic conditions\n", spec.id.c_str());
+        return;
+    }
+
+    Mesh::sourceFunction source = valueSource;
+    if (spec.constantSource) source = [f = spec.source](f64, f64){ return f; };
+
+    // Only the forcing vector changes between problems on the same grid
+    bool pooled;
+    poolEntry &entry = acquire(grid, boundaries, spec.stencil, spec.precond, pooled);
+    if (pooled){
+        Mesh::assembleForcing(grid, boundaries, source, entry.b, spec.stencil);
+    } else if (spec.precond == Preconditioner::PRECONDITIONER_NONE){
+        Mesh::assemblePoisson(grid, boundaries, source, entry.A, entry.b, spec.stencil);
+        entry.work   = std::make_unique<Workspace::arena>(KrylovSolver::DeflatedCG::workspaceBytes(entry.A.cols()), &policy);
+        entry.solver = std::make_unique<KrylovSolver::DeflatedCG>(entry.A, *entry.work);
+    } else {
+        // Deflated CG takes no preconditioner, preconditioned requests are solved by CG
+        Mesh::assemblePoisson(grid, boundaries, source, entry.A, entry.b, spec.stencil);
+        const Mesh::discretizationStruct problem{&entry.grid, &boundaries, spec.stencil};
+        entry.work = std::make_unique<Workspace::arena>(KrylovSolver::CG::workspaceBytes(entry.A.cols()), &policy);
+        entry.M    = std::make_unique<Preconditioner::preconditioner>(entry.A, spec.precond, &policy, Mesh::ORDERING_NATURAL, &problem);
+        entry.cg   = std::make_unique<KrylovSolver::CG>(entry.A, *entry.work);
+        entry.cg->precondition(entry.M.get());
+    }
+
+    InitialGuess::problemSignature signature = InitialGuess::signature(grid, entry.b);
+    InitialGuess::guessType guess = cache.fill(spec.guess, signature, grid, boundaries, entry.A, entry.b, entry.u);
+    clock::time_point setup = clock::now();
+
+    // Solve, the residual of CG can hover for about a grid width of iterations, which is not a stagnation
+    KrylovSolver::convergenceCriteria criteria;
+    criteria.absolute         = spec.tol;
+    criteria.relative         = spec.rtol;
+    criteria.maxiter          = spec.maxiter;
+    criteria.stagnationWindow = std::max({criteria.stagnationWindow, spec.imax, spec.jmax});
+    if (spec.disc > 0.) criteria.discretization = KrylovSolver::discretizationTolerance(grid, boundaries, source, spec.disc, spec.stencil);
+    KrylovSolver::solveReport report = entry.cg ? entry.cg->solve(entry.u, entry.b, criteria)
+                                                : entry.solver->solve(entry.u, entry.b, criteria);
+    if (Mesh::isSingular(boundaries)) Mesh::removeNullspace(entry.u);
+    cache.store(signature, grid, boundaries, entry.u);
+    clock::time_point solved = clock::now();
+
+    fprintf(out, "ok %s iterations=%u residual=%.6e status=%s guess=%s pooled=%d setup=%.6f solve=%.6f\n",
+            spec.id.c_str(), report.iterations, report.residual, KrylovSolver::statusName(report.status), guessNames[guess], pooled,
+            std::chrono::duration<f64>(setup  - start).count(),
+            std::chrono::duration<f64>(solved - setup).count());
+
+    // Results
+    if (spec.out.empty() && !spec.rows) return;
+    EigenDefs::Array2D<f64> field;
+    Mesh::scatterSolution(grid, boundaries, entry.u, field);
+    if (spec.rows){
+        for (u32 j=0; j<spec.jmax; j++){
+            fprintf(out, "row %s %u", spec.id.c_str(), j);
+            for (u32 i=0; i<spec.imax; i++) fprintf(out, " %.9e", field(j,i));
+            fprintf(out, "\n");
+        }
+        fprintf(out, "end %s\n", spec.id.c_str());
+    }
+
+    // Written by the exporter's thread while the next request is served, the fields are handed over
+    if (!spec.out.empty()){
+        PostProcess::derivedFields derived;
+        PostProcess::compute(grid, field, source, nullptr, derived, &policy, spec.stencil);
+        exportIds[exporter.submit(spec.out, grid, IO::solutionFields(std::move(field), std::move(derived)))] = spec.id;
+    }
+}
+
+} // namespace Service
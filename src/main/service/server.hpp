@@ -0,0 +1,160 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh/mesh.hpp"
+#include "solver/CG.hpp"
+#include "solver/DeflatedCG.hpp"
+#include "solver/initialGuess.hpp"
+#include "core/arena.hpp"
+#include "core/parallel.hpp"
+#include "io/tiledFile.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/************************************************************************************************************************
+ *  @brief The long-lived solve service is represented in this namespace.
+ *
+ *  @details
+ *  Running one process per case pays for process startup, page-faulting in every vector, assembly and deflation-space
+ *  construction every single time. In server mode, the executable stays resident and reads problems from stdin or a
+ *  Unix domain socket, one request per line, and answers on the same stream. Everything that only depends on the grid,
+ *  the boundary condition types and the preconditioner (the sparse matrix, the preconditioner, the solver with its
+ *  workspace and deflation space) is pooled by their signature, and previous solutions are kept to warm-start the next
+ *  request. The protocol is line-delimited text:
+ *
+ *  requests:
+ *    solve key=value ...   solve a problem, keys (all optional):
+ *                            id=<string>                   echoed in every response line, default 0
+ *                            imax=<u32> jmax=<u32>         #gridpoints, default 101
+ *                            lx=<f64> ly=<f64>             domain [0,lx]x[0,ly], default pi
+ *                            north|south|east|west=<face>  boundary values, <c> | sin | <c>*sin, default 0
+ *                            northbc|southbc|eastbc|westbc=dirichlet|neumann|robin:<alpha>:<beta>|periodic,
+ *                                                          boundary condition type, default dirichlet
+ *                            source=<f64>                  constant source, default valueSource(x,y)
+ *                            stencil=5|9                   2nd-order 5-point or 4th-order Mehrstellen stencil (dirichlet
+ *                                                          and periodic conditions only), default 5
+ *                            tol=<f64> maxiter=<u32>       solver settings, default 1e-10, 5000
+ *                            rtol=<f64>                    tolerance relative to the RMS of b, default 0 (off)
+ *                            disc=<f64>                    stop at this fraction of the truncation error, default 0 (off)
+ *                            guess=zero|previous|coarse|projected, default projected
+ *                            precond=none|jacobi|ic|chebyshev,
+ *                                                          preconditioner, pooled with A, default none (solved by
+ *                                                          deflated CG, by preconditioned CG otherwise)
+ *                            out=<path>                    write the solution (with its derived fields) as a losslessly
+ *                                                          compressed tiled file, in the background (see sync)
+ *                            rows=1                        stream the solution back, one grid row per line
+ *    stats                 pool and cache statistics
+ *    sync                  wait until every out= file requested so far is written, reporting the ones that failed
+ *    drop                  empty the pool and the solution cache
+ *    quit                  close this stream (stdin: stop the server)
+ *    shutdown              stop the server
+ *
+ *  responses:
+ *    ok <id> iterations=<u32> residual=<f64> status=converged|maxiter|stagnated|diverged guess=<type> pooled=<0|1> 
+ *       setup=<s> solve=<s>
+ *    row <id> <j> u(j,0) u(j,1) ... u(j,imax-1)   (only with rows=1, followed by: end <id>)
+ *    ok synced             (preceded by an error line for every out= file that could not be written)
+ *    stats pools=<n> hits=<n> misses=<n> solves=<n> threads=<n> pages=<node 0>/<node 1>/.../<untouched>
+ *    error <id> <message>
+ ************************************************************************************************************************/
+namespace Service{
+
+/************************************************************************************************************************
+ *  @brief Checks whether the command-line arguments ask for server mode (--server or --server=<socket path>).
+ *
+ *  @param argc number of command-line arguments.
+ *  @param argv command-line arguments.
+ *
+ *  @return true if server mode is requested.
+ ************************************************************************************************************************/
+bool requested(i32 argc, char* argv[]);
+
+/************************************************************************************************************************
+ *  @brief Runs the server until it is shut down.
+ *
+ *  @details
+ *  Command-line arguments:
+ *    --server              serve requests from stdin, respond on stdout.
+ *    --server=<path>       serve requests from a Unix domain socket bound at path, one client at a time.
+ *    --pool=<n>            max number of grids kept in the pool, default 4.
+ *    --threads=<n>         number of pinned solver threads, default 0 (one per available cpu).
+ *    --verbose             keep the info/debug log messages (every log message is written to stderr).
+ *
+ *  @param argc number of command-line arguments.
+ *  @param argv command-line arguments.
+ *
+ *  @return exit code.
+ ************************************************************************************************************************/
+i32 run(i32 argc, char* argv[]);
+
+
+
+/************************************************************************************************************************
+ *  @brief Serves line-delimited solve requests, pooling assembled operators and solvers by grid signature.
+ ************************************************************************************************************************/
+class solveServer{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction, keeping at most poolSize grids resident, solving with nThreads threads (0: every cpu) */
+        solveServer(u32 poolSize = 4, u32 nThreads = 0);
+
+        /**< Disabled construction using another server */
+        solveServer(const solveServer&) = delete;
+
+        /**< Disabled construction by equating to another server */
+        solveServer& operator =(const solveServer&) = delete;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Reads requests from a stream until it ends, or until quit/shutdown is received.
+         *
+         *  @param in  stream to read the requests from.
+         *  @param out stream to write the responses to, flushed after every response.
+         *
+         *  @return false if shutdown was requested, true otherwise.
+         ************************************************************************************************************************/
+        bool serve(FILE* in, FILE* out);
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        /**< Simplistic structure holding everything that only depends on the grid */
+        struct poolEntry{
+            Mesh::gridStruct grid;                              /**< gridpoints */
+            Eigen::SparseMatrix<f64> A;                         /**< assembled sparse matrix */
+            EigenDefs::Vector<f64> u, b;                        /**< solution and forcing vectors */
+            std::unique_ptr<Workspace::arena> work;             /**< solver workspace, first-touched by the policy */
+            std::unique_ptr<KrylovSolver::DeflatedCG> solver;   /**< precond=none: solver, keeps its workspace and deflation space */
+            std::unique_ptr<Preconditioner::preconditioner> M;  /**< otherwise: preconditioner of A */
+            std::unique_ptr<KrylovSolver::CG> cg;               /**< otherwise: preconditioned solver */
+            u64 lastUsed;                                       /**< request counter when last used, for eviction */
+        };
+
+        void solve(const std::string &line, FILE* out);
+        void stats(FILE* out);
+        poolEntry& acquire(const Mesh::gridStruct &grid, const Mesh::boundaryStruct &boundaries, Mesh::stencilType stencil,
+                           Preconditioner::preconditionerType precond, bool &pooled);
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        u32 poolSize;                                                   /**< max number of grids kept resident */
+        IO::asyncExport exporter;                                       /**< writes the out= files, started before the pinned threads */
+        std::unordered_map<u64, std::string> exportIds;                 /**< request id of every out= file not synced yet, by ticket */
+        Parallel::executionPolicy policy;                               /**< pinned threads running the solvers */
+        std::unordered_map< u64, std::unique_ptr<poolEntry> > pool;     /**< resident grids, by grid signature */
+        InitialGuess::solutionCache cache;                              /**< previous solutions, for warm starts */
+        u64 requests, hits, misses;                                     /**< statistics */
+
+};
+
+} // namespace Service
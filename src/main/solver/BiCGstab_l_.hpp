@@ -1,12 +1,17 @@
 #pragma once
 
 #include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+#include "convergence.hpp"
+#include "core/arena.hpp"
+
+#include <memory>
 
 /************************************************************************************************************************ 
  *  @brief All Krylov iterative solvers are stored underneath this namespace.
  * 
  *  @details
- *  This currently includes CG, BiCGstab(l).
+ *  This currently includes CG, deflated CG, BiCGstab(l).
  ************************************************************************************************************************/ 
 namespace KrylovSolver{
 /************************************************************************************************************************ 
@@ -53,8 +58,16 @@ template<u32 level> class BiCGstab{
         // member functions //
         // ---------------- // 
 
-        /**< Default construction takes a reference to the sparse A matrix, and resizes all internal vectors to the appropriate shape */
-        BiCGstab(Eigen::SparseMatrix<f64> &A);    
+        /**< Default construction takes a reference to the sparse A matrix, and maps all internal vectors into its own arena */
+        BiCGstab(Eigen::SparseMatrix<f64> &A)
+            : BiCGstab(A, new Workspace::arena(workspaceBytes(A.cols()))) {}
+
+        /**< Construction taking a reference to the sparse A matrix, and mapping all internal vectors into a shared arena */
+        BiCGstab(Eigen::SparseMatrix<f64> &A, Workspace::arena &work)
+            : BiCGstab(A, nullptr, work) {}
+
+        /**< Bytes of arena needed by a solver of size n */
+        static u64 workspaceBytes(u32 n) { return Workspace::vectorBytes(n) + 2*Workspace::matrixBytes(n, level+1); }
 
         /**< Disabled construction using another BiCGstab solver */
         BiCGstab(const BiCGstab&) = delete;             
@@ -65,22 +78,36 @@ template<u32 level> class BiCGstab{
 
 
         /************************************************************************************************************************ 
-         *  @brief Runs through the conjugate-gradient algorithm to find the solution to Au = b.
+         *  @brief Runs through the BiCGstab(l) algorithm to find the solution to Au = b.
          * 
          *  @details
          *  The details of this methodology can be found in the main class descriptor, and algorithms in the references provided.
+         *  Every update is written such that Eigen does not materialise temporaries, no allocation happens in the iterations.
          * 
          *  @param u       reference to the solution vector of the system Au = b.
          *  @param b       reference to the forcing vector of the system Au = b.
          *  @param tol     tolerance for convergence, default 1e-15.
          *  @param maxiter maximum number of iterations for convergence, default 5000.
          * 
-         *  @return None
+         *  @return report holding the number of iterations taken and the final residual.
+         ************************************************************************************************************************/ 
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          f64 tol = 1e-15,
+                          u32 maxiter = 5000);
+
+        /************************************************************************************************************************ 
+         *  @brief Same as above, stopping as decided by a convergence monitor applying the given criteria.
+         * 
+         *  @param u        reference to the solution vector of the system Au = b, holds the initial guess on entry.
+         *  @param b        reference to the forcing vector of the system Au = b.
+         *  @param criteria reference to the convergence criteria (tolerances, iteration cap, stagnation, divergence, ...).
+         * 
+         *  @return report holding the number of iterations taken, the final residual and why the solve ended.
          ************************************************************************************************************************/ 
-        void solve(EigenDefs::Vector<f64> &u,
-                   EigenDefs::Vector<f64> &b,
-                   f64 tol = 1e-15,
-                   u32 maxiter = 5000);
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          const convergenceCriteria &criteria);
 
 
 
@@ -88,36 +115,159 @@ template<u32 level> class BiCGstab{
         // ---------------- //
         // member functions //
         // ---------------- // 
+        BiCGstab(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned)
+            : BiCGstab(A, owned, *owned) {}
+
+        BiCGstab(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work)
+            : owned(owned), A(A), policy(work.policy()), tr0(work.vector(A.cols())),
+              hu(work.matrix(A.cols(), level+1)), hr(work.matrix(A.cols(), level+1)) {
+            CHECK_FATAL_ASSERT(A.rows()==A.cols(), "Number of rows and columns of sparse matrix A do not match.")
+        }
+
+        /**< Dot product, threaded (and as reproducible as its reduction mode) when the arena has an execution policy */
+        f64 dot(const f64* x, const f64* y) const {
+            const u64 n = A.cols();
+            if (policy != nullptr) return policy->dot(x, y, n);
+            return Eigen::Map<const EigenDefs::Vector<f64>>(x, n).dot(Eigen::Map<const EigenDefs::Vector<f64>>(y, n));
+        }
         
         // ---------------- //
         // member variables //
         // ---------------- // 
-        const u8 l = level;
-
-        EigenDefs::Vector<f64> rk;            /**< residual vector */
-        std::vector< EigenDefs::Vector<f64> > hu;
-        std::vector< EigenDefs::Vector<f64> > hr;
-
-        EigenDefs::Vector<f64> tr0;
+        std::unique_ptr<Workspace::arena> owned; /**< arena owned by the solver, if none was provided */
+        Eigen::SparseMatrix<f64> &A;             /**< Internal reference of the sparse matrix*/
+        const Parallel::executionPolicy* policy; /**< threads running the dots, those of the arena (nullptr: serial) */
+        Workspace::VectorMap<f64> tr0;           /**< shadow residual vector */
+        Workspace::MatrixMap<f64> hu;            /**< search directions and their images, one per column */
+        Workspace::MatrixMap<f64> hr;            /**< residual and its images, one per column, hr(:,0) is the residual */
         
-        f64 alpha, beta, omega; /**< update coefficients */
+        f64 alpha, beta, omega;      /**< update coefficients */
         f64 rho0, rho1;
-        f64 tau[level+1][level+1];  // ignore index 0, hence the +1;
-        f64 sigma[level+1];     // ignore index 0;
+        f64 tau[level+1][level+1];   // ignore index 0, hence the +1;
+        f64 sigma[level+1];          // ignore index 0;
         f64 gam;
         f64 gamma[level+1];
         f64 gammap[level+1];
         f64 gammapp[level+1];
-        
-        // Eigen::SparseMatrix<f64> A;      /**< Internal reference of the sparse matrix*/
-        // EigenDefs::Vector<f64> rk, rkp1; /**< residual vector */
-        // EigenDefs::Vector<f64> zk, zkp1; /**< preconditioned residual vector */
-        // EigenDefs::Vector<f64> pk;       /**< search/conjugate direction vector */
-        // EigenDefs::Vector<f64> qk;       /**< search/conjugate direction vector */
-        // f64 alphak, betak;               
     
 };
 
+template<u32 level> solveReport BiCGstab<level>::solve(EigenDefs::Vector<f64> &u,
+                                                       EigenDefs::Vector<f64> &b,
+                                                       f64 tol, u32 maxiter){
+    convergenceCriteria criteria;
+    criteria.absolute = tol;
+    criteria.maxiter  = maxiter;
+    return solve(u, b, criteria);
+}
+
+template<u32 level> solveReport BiCGstab<level>::solve(EigenDefs::Vector<f64> &u,
+                                                       EigenDefs::Vector<f64> &b,
+                                                       const convergenceCriteria &criteria){
+
+    // Initialization
+    convergenceMonitor monitor(criteria);
+    const u32 l = level;
+    u32 kappa   = 0;      /**< iterate number*/
+    f64 err     = 1./0.;  /**< residual error */
+
+    hu.setZero();
+    hr.setZero();
+    hr.col(0).noalias() = A*u;
+    hr.col(0) = b - hr.col(0);
+    tr0   = hr.col(0);
+    rho0  = 1.;
+    alpha = 0.;
+    omega = 1.;
+
+    // A warm start may already be converged, skip the iterations (alpha would be 0/0)
+    err = std::sqrt( dot(hr.col(0).data(), hr.col(0).data())/hr.rows() );
+    convergenceStatus status = monitor.start(err, std::sqrt( dot(b.data(), b.data())/b.size() ));
+    if (status == SOLVE_CONVERGED) return solveReport{kappa, err, status};
+
+    do {
+        rho0 = -omega*rho0;
+    
+        //## ---- ##//
+        //## BiCG ##//
+        //## ---- ##//
+        for (u32 j=0; j<=l-1; j++){
+            rho1 = dot(hr.col(j).data(), tr0.data());
+            beta = alpha * rho1/rho0;
+            rho0 = rho1;
+            for (u32 i=0; i<=j; i++){
+                hu.col(i) = hr.col(i) - beta*hu.col(i);
+            }
+            hu.col(j+1).noalias() = A*hu.col(j);
+            gam   = dot(hu.col(j+1).data(), tr0.data());
+            alpha = rho0/gam;
+            for (u32 i=0; i<=j; i++){
+                hr.col(i).noalias() -= alpha*hu.col(i+1);
+            }
+            hr.col(j+1).noalias() = A*hr.col(j);
+            u.noalias() += alpha*hu.col(0);
+        }
+            
+        //## ------- ##//
+        //## mod.G-S ##//
+        //## ------- ##//
+        sigma[1]  = dot(hr.col(1).data(), hr.col(1).data());
+        gammap[1] = 1/sigma[1] * dot(hr.col(0).data(), hr.col(1).data());
+        for (u32 j=2; j<=l; j++){
+            for (u32 i=1; i<=j-1; i++){
+                tau[i][j] = 1/sigma[i] * dot(hr.col(j).data(), hr.col(i).data());
+                hr.col(j).noalias() -= tau[i][j]*hr.col(i);
+            }
+            sigma[j]  = dot(hr.col(j).data(), hr.col(j).data());
+            gammap[j] = 1/sigma[j] * dot(hr.col(0).data(), hr.col(j).data()); 
+        }
+
+        gamma[l] = gammap[l];
+        omega    = gamma[l];
+
+        for (u32 j=l-1; j>=1; j--){
+            f64 sum = 0;
+            for (u32 i=j+1; i<=l; i++) sum += tau[j][i]*gamma[i];
+            gamma[j] = gammap[j] - sum;
+        }
+        for (u32 j=1; j<=l-1; j++){
+            f64 sum = 0;
+            for (u32 i=j+1; i<=l-1; i++) sum += tau[j][i]*gamma[i+1];
+            gammapp[j] = gamma[j+1] + sum;
+        }
+
+        //## ------ ##//
+        //## update ##//
+        //## ------ ##//
+        u.noalias()         += gamma[1]*hr.col(0);
+        hr.col(0).noalias() -= gammap[l]*hr.col(l);
+        hu.col(0).noalias() -= gamma[l]*hu.col(l);
+
+        for (u32 j=1; j<=l-1; j++){
+            hu.col(0).noalias() -= gamma[j]*hu.col(j);
+            u.noalias()         += gammapp[j]*hr.col(j);
+            hr.col(0).noalias() -= gammap[j]*hr.col(j);
+        }
+
+        err = std::sqrt( dot(hr.col(0).data(), hr.col(0).data())/hr.rows() );
+        CHECK_FATAL_ITERERROR(kappa, err);
+        INFO_MSG("kappa = %-5u err = %1.4e", kappa, err); 
+        kappa += l;
+
+        // Termination criteria, convergence is confirmed on the true residual, which then replaces the recursive one
+        status = monitor.check(kappa, err);
+        if (status == SOLVE_CONVERGED || monitor.replace(kappa)){
+            hr.col(0).noalias() = A*u;
+            hr.col(0) = b - hr.col(0);
+            err    = std::sqrt( dot(hr.col(0).data(), hr.col(0).data())/hr.rows() );
+            status = monitor.confirm(kappa, err);
+        }
+
+    } while (status == SOLVE_RUNNING); 
+
+    return solveReport{kappa, err, status};
+}
+
 } // end KrylovSolver
 
 
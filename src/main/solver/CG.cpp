@@ -1,65 +1,165 @@
 #include "CoreIncludes.hpp"
 #include "CG.hpp"
+#include "core/simd.hpp"
 
 namespace KrylovSolver{
 
-CG::CG(Eigen::SparseMatrix<f64> &A) : A(A) {
+CG::CG(Eigen::SparseMatrix<f64> &A) 
+    : CG(A, new Workspace::arena(workspaceBytes(A.cols()))) {}
 
-    // Set new vectors
+CG::CG(Eigen::SparseMatrix<f64> &A, Workspace::arena &work) 
+    : CG(A, nullptr, work) {}
+
+CG::CG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned) 
+    : CG(A, owned, *owned) {}
+
+CG::CG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work) 
+    : owned(owned), A(A), policy(work.policy()), symmetric(Parallel::isSymmetric(A)), M(nullptr), op(nullptr),
+      profiler(nullptr), kernels{},
+      rk(work.vector(A.cols())), rkp1(work.vector(A.cols())),
+      zk(work.vector(A.cols())), zkp1(work.vector(A.cols())),
+      pk(work.vector(A.cols())), qk(work.vector(A.cols())) {
+
+    // All internal vectors are mapped (zeroed) into the arena
     u32 n = A.rows();
     u32 m = A.cols();
     CHECK_FATAL_ASSERT(n==m, "Number of rows and columns of sparse matrix A do not match.")
+    if (!symmetric) WARN_MSG("CG needs a symmetric A, this one is not (e.g. the 5-point A of a stretched grid), use BiCGstab(l)");
+}
 
-    rk.setZero(m);
-    rkp1.setZero(m);
-    zk.setZero(m);
-    zkp1.setZero(m);
-    pk.setZero(m);
-    qk.setZero(m);  
+solveReport CG::solve(EigenDefs::Vector<f64> &u,
+                      EigenDefs::Vector<f64> &b,
+                      f64 tol, u32 iterMax){
+    convergenceCriteria criteria;
+    criteria.absolute = tol;
+    criteria.maxiter  = iterMax;
+    return solve(u, b, criteria);
 }
 
-void CG::solve(EigenDefs::Vector<f64> &u,
-               EigenDefs::Vector<f64> &b,
-               f64 tol, u32 iterMax){
+solveReport CG::solve(EigenDefs::Vector<f64> &u,
+                      EigenDefs::Vector<f64> &b,
+                      const convergenceCriteria &criteria){
 
-    // Initialization
+    // Initialization, the Lanczos matrix only allocates on the first solve (or a larger iteration cap)
+    convergenceMonitor monitor(criteria);
+    lanczos.reset(criteria.maxiter);
+    if (profiler != nullptr) registerKernels();
     u32 iter = 0;     /**< Iterate count */
     f64 err = 1./0.;  /**< residual error */
-    rk = b - A*u;     // Initial guess
-    // zk = Mm1*rk;
-    zk = rk;
+    product(u.data(), rk); // Initial guess, written without temporaries (as are all expressions below)
+    rk     = b - rk;
+    if (M != nullptr) M->apply(rk.data(), zk.data());
+    else              zk = rk;
     pk = zk;
 
+    // A warm start may already be converged, skip the iterations (alphak would be 0/0)
+    err = std::sqrt( dot(rk.data(), rk.data())/rk.size() );
+    convergenceStatus status = monitor.start(err, std::sqrt( dot(b.data(), b.data())/b.size() ));
+    if (status == SOLVE_CONVERGED) return solveReport{iter, err, status};
+
     // N.B. We write it this way to skip the if-else statement in Figure 5.2 of Henk van der Vorst 2003
     do {
         // Update iterate
-        qk     = A*pk;
-        alphak = rk.dot(zk) / pk.dot(qk);
-        u      = u + alphak*pk;
-
-        // Update residual
-        rkp1   = rk - alphak*qk;
-        err    = std::sqrt( rk.dot(rk)/rk.size() );
+        product(pk.data(), qk);
+        {
+            Profiling::scope region(profiler, kernels.dot, 2.);
+            alphak = dot(rk.data(), zk.data()) / dot(pk.data(), qk.data());
+        }
+        {
+            Profiling::scope region(profiler, kernels.axpy);
+            u.noalias() += alphak*pk;
+        }
+        lanczos.recordAlpha(alphak);
+
+        // Update residual, and its norm in the same pass
+        {
+            Profiling::scope region(profiler, kernels.axpyNorm);
+            err = std::sqrt( axpyNorm(rkp1.data(), rk.data(), -alphak, qk.data())/rkp1.size() );
+        }
+        iter++;
 
-        // Termination criteria
+        // Termination criteria, convergence is confirmed on the true residual, which then replaces the recursive one
         CHECK_FATAL_ITERERROR(iter, err);
         INFO_MSG("iter = %-5u err = %1.4e", iter, err); 
-        if (tol > err) break;
+        status = monitor.check(iter, err);
+        if (status == SOLVE_CONVERGED || monitor.replace(iter)){
+            product(u.data(), rkp1);
+            rkp1   = b - rkp1;
+            err    = std::sqrt( dot(rkp1.data(), rkp1.data())/rkp1.size() );
+            status = monitor.confirm(iter, err);
+        }
+        if (status != SOLVE_RUNNING) break;
 
         // Calculate preconditioning residual vector
-        // zkp1 = Mm1*rkp1;                
-        zkp1   = rkp1;         
+        if (M != nullptr){
+            Profiling::scope region(profiler, kernels.precond);
+            M->apply(rkp1.data(), zkp1.data());
+        } else {
+            Profiling::scope region(profiler, kernels.copy);
+            zkp1 = rkp1;
+        }
 
         // Update search direction
-        betak  = rkp1.dot(zkp1) / rk.dot(zk);
-        pk     = zkp1 + betak*pk;    
+        {
+            Profiling::scope region(profiler, kernels.dot, 2.);
+            betak = dot(rkp1.data(), zkp1.data()) / dot(rk.data(), zk.data());
+        }
+        {
+            Profiling::scope region(profiler, kernels.axpy);
+            pk = zkp1 + betak*pk;
+        }
+        lanczos.recordBeta(betak);
 
         // Update iteration
-        iter++;
-        rk     = rkp1; 
-        zk     = zkp1;
+        {
+            Profiling::scope region(profiler, kernels.copy, 2.);
+            rk = rkp1;
+            zk = zkp1;
+        }
+
+    } while (true); 
+
+    return solveReport{iter, err, status, lanczos.estimate()};
+}
+
+void CG::product(const f64* x, Workspace::VectorMap<f64> &y){
+
+    // Threaded over the row partition the workspace was first-touched with, when the arena has an execution policy and
+    // A is symmetric (the threads compute A^T x, see executionPolicy::symmetricProduct)
+    Profiling::scope region(profiler, kernels.spmv);
+    if (op != nullptr)                       op->apply(x, y.data(), policy);
+    else if (policy != nullptr && symmetric) policy->symmetricProduct(A, x, y.data());
+    else                                     y.noalias() = A*Eigen::Map<const EigenDefs::Vector<f64>>(x, A.cols());
+}
+
+f64 CG::dot(const f64* x, const f64* y) const{
+
+    // Threaded over the same row partition, as reproducible as the reduction mode of the policy asks for
+    const u64 n = A.cols();
+    if (policy != nullptr) return policy->dot(x, y, n);
+    return Eigen::Map<const EigenDefs::Vector<f64>>(x, n).dot(Eigen::Map<const EigenDefs::Vector<f64>>(y, n));
+}
+
+f64 CG::axpyNorm(f64* z, const f64* x, f64 a, const f64* y) const{
+    const u64 n = A.cols();
+    if (policy != nullptr) return policy->axpyNorm(z, x, a, y, n);
+    return Simd::kernels().axpyNorm(z, x, a, y, n);
+}
 
-    } while (iter < iterMax); 
+void CG::registerKernels(){
+
+    // Traffic and flops of one call of every kernel, per f64 vector of n rows streamed once: a matrix-free product only
+    // reads x and writes y, the sparse product also streams the values, row indices and column offsets of A
+    const f64 n      = A.cols();
+    const f64 nnz    = A.nonZeros();
+    const f64 vector = n*sizeof(f64);
+    const f64 matrix = op != nullptr ? 0. : nnz*(sizeof(f64) + sizeof(i32)) + (n+1)*sizeof(i32);
+    kernels.spmv     = profiler->region("spmv",      matrix + 2.*vector, 2.*nnz);
+    kernels.precond  = profiler->region("precond",   0., 0.);
+    kernels.dot      = profiler->region("dot",       2.*vector, 2.*n);
+    kernels.axpy     = profiler->region("axpy",      3.*vector, 2.*n);
+    kernels.axpyNorm = profiler->region("axpy+norm", 3.*vector, 4.*n);
+    kernels.copy     = profiler->region("copy",      2.*vector, 0.);
 }
 
 } // end KrylovSolver
@@ -1,12 +1,21 @@
 #pragma once
 
 #include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+#include "convergence.hpp"
+#include "lanczos.hpp"
+#include "core/arena.hpp"
+#include "core/profiler.hpp"
+#include "preconditioner/preconditioners.hpp"
+#include "mesh/stencilOperator.hpp"
+
+#include <memory>
 
 /************************************************************************************************************************ 
  *  @brief All Krylov iterative solvers are stored underneath this namespace.
  * 
  *  @details
- *  This currently includes CG, BiCGstab(l).
+ *  This currently includes CG, deflated CG, BiCGstab(l).
  ************************************************************************************************************************/ 
 namespace KrylovSolver{
 
@@ -41,6 +50,12 @@ namespace KrylovSolver{
  *  As it turns out, the 'search' vectors that lead to orthogonal residual vectors are conjugate (A-orthogonal), hence
  *  the name of the method.
  * 
+ *  Given a (symmetric positive-definite) preconditioner M, the same recursion runs on z = M^-1 r instead of r, which
+ *  is CG applied to the system preconditioned from both sides with the factors of M.
+ * 
+ *  The coefficients alpha and beta of every iteration are kept in the Lanczos tridiagonal matrix they define, whose
+ *  extreme eigenvalues estimate those of M^-1 A (see lanczosTridiagonal), returned in the spectrum of the report.
+ * 
  *  * see "Iterative Krylov Methods for Large Linear Systems" by Henk van der Vorst 2003
  *  * see "A Brief Introduction to Krylov Space Methods for Solving Linear Systems" by Martin H. Gutknecht 2007
  *  * see Section 3.1 https://homepage.tudelft.nl/d2b4e/burgers/lin_notes.pdf
@@ -54,15 +69,30 @@ class CG{
         // member functions //
         // ---------------- // 
 
-        /**< Default construction takes a reference to the sparse A matrix, and resizes all internal vectors to the appropriate shape */
+        /**< Default construction takes a reference to the sparse A matrix, and maps all internal vectors into its own arena */
         CG(Eigen::SparseMatrix<f64> &A);    
 
+        /**< Construction taking a reference to the sparse A matrix, and mapping all internal vectors into a shared arena */
+        CG(Eigen::SparseMatrix<f64> &A, Workspace::arena &work);
+
+        /**< Bytes of arena needed by a solver of size n */
+        static u64 workspaceBytes(u32 n) { return 6*Workspace::vectorBytes(n); }
+
         /**< Disabled construction using another CG solver */
         CG(const CG&) = delete;             
 
         /**< Disabled construction by equating to another CG solver */
         CG& operator =(const CG&) = delete; 
 
+        /**< Sets the preconditioner applied to every residual, which outlives the solves, nullptr for none (the default) */
+        void precondition(const Preconditioner::preconditioner* M) { this->M = M; }
+
+        /**< Sets an operator computing the products A x instead of A, which outlives the solves, nullptr for none (the default) */
+        void matrixFree(const Mesh::linearOperator* op) { this->op = op; }
+
+        /**< Sets a profiler counting the kernels of the solves (regions spmv, precond, dot, axpy, axpy+norm, copy), nullptr for none */
+        void profile(Profiling::profiler* profiler) { this->profiler = profiler; }
+
 
 
         /************************************************************************************************************************ 
@@ -76,12 +106,25 @@ class CG{
          *  @param tol     tolerance for convergence, default 1e-15.
          *  @param maxiter maximum number of iterations for convergence, default 5000.
          * 
-         *  @return None
+         *  @return report holding the number of iterations taken and the final residual.
          ************************************************************************************************************************/ 
-        void solve(EigenDefs::Vector<f64> &u,
-                   EigenDefs::Vector<f64> &b,
-                   f64 tol = 1e-15,
-                   u32 maxiter = 5000);
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          f64 tol = 1e-15,
+                          u32 maxiter = 5000);
+
+        /************************************************************************************************************************ 
+         *  @brief Same as above, stopping as decided by a convergence monitor applying the given criteria.
+         * 
+         *  @param u        reference to the solution vector of the system Au = b, holds the initial guess on entry.
+         *  @param b        reference to the forcing vector of the system Au = b.
+         *  @param criteria reference to the convergence criteria (tolerances, iteration cap, stagnation, divergence, ...).
+         * 
+         *  @return report holding the number of iterations taken, the final residual and why the solve ended.
+         ************************************************************************************************************************/ 
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          const convergenceCriteria &criteria);
 
 
 
@@ -89,16 +132,35 @@ class CG{
         // ---------------- //
         // member functions //
         // ---------------- // 
+        CG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned);
+        CG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work);
+        void product(const f64* x, Workspace::VectorMap<f64> &y);
+        f64 dot(const f64* x, const f64* y) const;
+        f64 axpyNorm(f64* z, const f64* x, f64 a, const f64* y) const;
+        void registerKernels();
+
+        /**< Simplistic structure holding the profiler regions of the kernels */
+        struct kernelRegions{
+            u32 spmv, precond, dot, axpy, axpyNorm, copy;
+        };
         
         // ---------------- //
         // member variables //
         // ---------------- // 
-        Eigen::SparseMatrix<f64> &A;     /**< Internal reference of the sparse matrix*/
-        EigenDefs::Vector<f64> rk, rkp1; /**< residual vector */
-        EigenDefs::Vector<f64> zk, zkp1; /**< preconditioned residual vector */
-        EigenDefs::Vector<f64> pk;       /**< search/conjugate direction vector */
-        EigenDefs::Vector<f64> qk;       /**< search/conjugate direction vector */
-        f64 alphak, betak;               /**< update coefficients */
+        std::unique_ptr<Workspace::arena> owned; /**< arena owned by the solver, if none was provided */
+        Eigen::SparseMatrix<f64> &A;             /**< Internal reference of the sparse matrix*/
+        const Parallel::executionPolicy* policy; /**< threads running the products and dots, those of the arena (nullptr: serial) */
+        bool symmetric;                          /**< whether A is symmetric, which the threaded product relies on */
+        const Preconditioner::preconditioner* M; /**< preconditioner, nullptr for none */
+        const Mesh::linearOperator* op;          /**< matrix-free products, nullptr to multiply by A */
+        Profiling::profiler* profiler;           /**< profiler of the kernels, nullptr for none */
+        kernelRegions kernels;                   /**< regions of the kernels in the profiler */
+        lanczosTridiagonal lanczos;              /**< Lanczos matrix of the coefficients alphak, betak */
+        Workspace::VectorMap<f64> rk, rkp1;      /**< residual vector */
+        Workspace::VectorMap<f64> zk, zkp1;      /**< preconditioned residual vector */
+        Workspace::VectorMap<f64> pk;            /**< search/conjugate direction vector */
+        Workspace::VectorMap<f64> qk;            /**< search/conjugate direction vector */
+        f64 alphak, betak;                       /**< update coefficients */
     
 };
 
@@ -0,0 +1,125 @@
+#include "CoreIncludes.hpp"
+#include "Chebyshev.hpp"
+
+#include <cmath>
+
+namespace KrylovSolver{
+
+Chebyshev::Chebyshev(Eigen::SparseMatrix<f64> &A)
+    : Chebyshev(A, new Workspace::arena(workspaceBytes(A.cols()))) {}
+
+Chebyshev::Chebyshev(Eigen::SparseMatrix<f64> &A, Workspace::arena &work)
+    : Chebyshev(A, nullptr, work) {}
+
+Chebyshev::Chebyshev(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned)
+    : Chebyshev(A, owned, *owned) {}
+
+Chebyshev::Chebyshev(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work)
+    : owned(owned), A(A), policy(work.policy()), symmetric(Parallel::isSymmetric(A)), op(nullptr), lower(0.), upper(0.), interval(10),
+      rk(work.vector(A.cols())), dk(work.vector(A.cols())), qk(work.vector(A.cols())) {
+
+    // All internal vectors are mapped (zeroed) into the arena
+    u32 n = A.rows();
+    u32 m = A.cols();
+    CHECK_FATAL_ASSERT(n==m, "Number of rows and columns of sparse matrix A do not match.")
+    if (!symmetric) WARN_MSG("Chebyshev iteration needs a symmetric A, this one is not (e.g. the 5-point A of a stretched grid)");
+}
+
+void Chebyshev::bounds(f64 lower, f64 upper){
+    CHECK_FATAL_ASSERT(lower > 0. && upper > lower, "The Chebyshev interval needs 0 < lower < upper.")
+    this->lower = lower;
+    this->upper = upper;
+}
+
+solveReport Chebyshev::solve(EigenDefs::Vector<f64> &u,
+                             EigenDefs::Vector<f64> &b,
+                             const convergenceCriteria &criteria){
+
+    CHECK_FATAL_ASSERT(upper > 0., "Chebyshev iteration needs the eigenvalue bounds of A, see bounds().")
+
+    // Initialization
+    convergenceMonitor monitor(criteria);
+    Preconditioner::chebyshevRecurrence recurrence(lower, upper);
+    u32 iter = 0;     /**< Iterate count */
+    f64 err = 1./0.;  /**< residual error */
+    f64 a, c;         /**< direction update coefficients */
+    product(u.data(), rk);
+    rk  = b - rk;
+    err = std::sqrt( dot(rk.data(), rk.data())/rk.size() );
+    convergenceStatus status = monitor.start(err, std::sqrt( dot(b.data(), b.data())/b.size() ));
+    if (status == SOLVE_CONVERGED) return solveReport{iter, err, status};
+    dk = rk/recurrence.theta;
+
+    f64* x = u.data();
+    f64* r = rk.data();
+    f64* d = dk.data();
+    const f64* q = qk.data();
+    do {
+        // Update iterate and residual, the only synchronisation being the product
+        product(d, qk);
+        rows([&](u64 begin, u64 end){
+            for (u64 i=begin; i<end; i++){
+                x[i] += d[i];
+                r[i] -= q[i];
+            }
+        });
+        iter++;
+
+        // Termination criteria, checked every interval iterations (and at the cap), confirmed on the true residual
+        if (iter % interval == 0 || iter >= criteria.maxiter){
+            err = std::sqrt( dot(rk.data(), rk.data())/rk.size() );
+            CHECK_FATAL_ITERERROR(iter, err);
+            INFO_MSG("iter = %-5u err = %1.4e", iter, err);
+            status = monitor.check(iter, err);
+            if (status == SOLVE_CONVERGED || monitor.replace(iter)){
+                product(u.data(), rk);
+                rk     = b - rk;
+                err    = std::sqrt( dot(rk.data(), rk.data())/rk.size() );
+                status = monitor.confirm(iter, err);
+            }
+            if (status != SOLVE_RUNNING) break;
+        }
+
+        // Update direction
+        recurrence.next(a, c);
+        rows([&](u64 begin, u64 end){
+            for (u64 i=begin; i<end; i++) d[i] = a*d[i] + c*r[i];
+        });
+
+    } while (true);
+
+    return solveReport{iter, err, status};
+}
+
+void Chebyshev::product(const f64* x, Workspace::VectorMap<f64> &y){
+
+    // Threaded over the row partition the workspace was first-touched with, when the arena has an execution policy and
+    // A is symmetric (the threads compute A^T x, see executionPolicy::symmetricProduct)
+    if (op != nullptr)                       op->apply(x, y.data(), policy);
+    else if (policy != nullptr && symmetric) policy->symmetricProduct(A, x, y.data());
+    else                                     y.noalias() = A*Eigen::Map<const EigenDefs::Vector<f64>>(x, A.cols());
+}
+
+f64 Chebyshev::dot(const f64* x, const f64* y) const{
+    const u64 n = A.cols();
+    if (policy != nullptr) return policy->dot(x, y, n);
+    return Eigen::Map<const EigenDefs::Vector<f64>>(x, n).dot(Eigen::Map<const EigenDefs::Vector<f64>>(y, n));
+}
+
+template<typename Update> void Chebyshev::rows(const Update &update){
+
+    // Every thread updates the rows it owns (those it first-touched and computes the products of)
+    const u64 n = A.cols();
+    if (policy == nullptr){
+        update(0, n);
+        return;
+    }
+    auto task = [&](u32 t){
+        u64 begin, end;
+        policy->range(t, n, begin, end);
+        update(begin, end);
+    };
+    policy->run(task);
+}
+
+} // end KrylovSolver
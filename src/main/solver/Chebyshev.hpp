@@ -0,0 +1,110 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+#include "convergence.hpp"
+#include "core/arena.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/stencilOperator.hpp"
+#include "preconditioner/preconditioners.hpp"
+
+#include <memory>
+
+namespace KrylovSolver{
+
+/************************************************************************************************************************
+ *  @brief Chebyshev iteration: a Krylov solver for symmetric positive-definite A whose spectrum bounds are known.
+ *
+ *  @details
+ *  CG picks the polynomial of every iteration from the inner products it computes, i.e. from global reductions that
+ *  every thread (or process) has to wait for. Given an interval [lower, upper] holding the eigenvalues of A, the
+ *  polynomial minimising the error over that interval is known beforehand: the scaled and shifted Chebyshev polynomial
+ *  T_k((upper + lower - 2 lambda)/(upper - lower)), whose three-term recurrence gives the iterates. Every iteration is
+ *  thus one product with A and a fused update of u, r and the direction d, without any inner product:
+ *    u <- u + d,   r <- r - A d,   d <- a_k d + c_k r   (see Preconditioner::chebyshevRecurrence)
+ *  The error shrinks by about (sqrt(K)-1)/(sqrt(K)+1) per iteration, K = upper/lower, like CG's worst case. Bounds that
+ *  are too tight make the iteration diverge (upper below lambdaMax), or converge slower (lower above lambdaMin), and
+ *  looser bounds only slow it down. They come from Preconditioner::analyticBounds on uniform Dirichlet grids (as the
+ *  autotuner sets them), or from the spectrum estimate of a previous CG solve (see solveReport::spectrum) widened by a
+ *  few percent.
+ *
+ *  The residual norm is only computed every checkInterval iterations (it is the one reduction left), and convergence
+ *  is confirmed on the true residual as in the other solvers.
+ *
+ *  * see Section 12.3 of "Iterative Methods for Sparse Linear Systems" by Yousef Saad 2003
+ *  * see Section 8.3 of "Templates for the Solution of Linear Systems" by Barrett et al. 1994
+ ************************************************************************************************************************/
+class Chebyshev{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction takes a reference to the sparse A matrix, and maps all internal vectors into its own arena */
+        Chebyshev(Eigen::SparseMatrix<f64> &A);
+
+        /**< Construction taking a reference to the sparse A matrix, and mapping all internal vectors into a shared arena */
+        Chebyshev(Eigen::SparseMatrix<f64> &A, Workspace::arena &work);
+
+        /**< Bytes of arena needed by a solver of size n */
+        static u64 workspaceBytes(u32 n) { return 3*Workspace::vectorBytes(n); }
+
+        /**< Disabled construction using another Chebyshev solver */
+        Chebyshev(const Chebyshev&) = delete;
+
+        /**< Disabled construction by equating to another Chebyshev solver */
+        Chebyshev& operator =(const Chebyshev&) = delete;
+
+        /**< Sets the interval [lower, upper] holding the eigenvalues of A, needed before solving */
+        void bounds(f64 lower, f64 upper);
+
+        /**< Sets an operator computing the products A x instead of A, which outlives the solves, nullptr for none (the default) */
+        void matrixFree(const Mesh::linearOperator* op) { this->op = op; }
+
+        /**< Sets how many iterations pass between two residual norms (reductions), default 10 */
+        void checkInterval(u32 interval) { this->interval = interval > 0 ? interval : 1; }
+
+
+
+        /************************************************************************************************************************
+         *  @brief Runs Chebyshev iteration to find the solution to Au = b.
+         *
+         *  @param u        reference to the solution vector of the system Au = b, holds the initial guess on entry.
+         *  @param b        reference to the forcing vector of the system Au = b.
+         *  @param criteria reference to the convergence criteria, the stagnation and divergence checks seeing the
+         *                  residual every checkInterval iterations only.
+         *
+         *  @return report holding the number of iterations taken, the final residual and why the solve ended.
+         ************************************************************************************************************************/
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          const convergenceCriteria &criteria);
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        Chebyshev(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned);
+        Chebyshev(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work);
+        void product(const f64* x, Workspace::VectorMap<f64> &y);
+        f64 dot(const f64* x, const f64* y) const;
+        template<typename Update> void rows(const Update &update);
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        std::unique_ptr<Workspace::arena> owned; /**< arena owned by the solver, if none was provided */
+        Eigen::SparseMatrix<f64> &A;             /**< Internal reference of the sparse matrix*/
+        const Parallel::executionPolicy* policy; /**< threads running the products, dots and updates, those of the arena (nullptr: serial) */
+        bool symmetric;                          /**< whether A is symmetric, which the threaded product relies on */
+        const Mesh::linearOperator* op;          /**< matrix-free products, nullptr to multiply by A */
+        f64 lower, upper;                        /**< interval holding the eigenvalues of A */
+        u32 interval;                            /**< iterations between two residual norms */
+        Workspace::VectorMap<f64> rk;            /**< residual vector */
+        Workspace::VectorMap<f64> dk;            /**< update direction vector */
+        Workspace::VectorMap<f64> qk;            /**< product of A and the direction */
+
+};
+
+} // end KrylovSolver
@@ -0,0 +1,237 @@
+#include "CoreIncludes.hpp"
+#include "DeflatedCG.hpp"
+
+#include "Eigen/LU"
+
+namespace KrylovSolver{
+
+DeflatedCG::DeflatedCG(Eigen::SparseMatrix<f64> &A, u32 nDeflate, u32 nEigen, u32 nWindow)
+    : DeflatedCG(A, new Workspace::arena(workspaceBytes(A.cols(), nDeflate, nEigen, nWindow)), nDeflate, nEigen, nWindow) {}
+
+DeflatedCG::DeflatedCG(Eigen::SparseMatrix<f64> &A, Workspace::arena &work, u32 nDeflate, u32 nEigen, u32 nWindow)
+    : DeflatedCG(A, nullptr, work, nDeflate, nEigen, nWindow) {}
+
+DeflatedCG::DeflatedCG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, u32 nDeflate, u32 nEigen, u32 nWindow)
+    : DeflatedCG(A, owned, *owned, nDeflate, nEigen, nWindow) {}
+
+DeflatedCG::DeflatedCG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work, 
+                       u32 nDeflate, u32 nEigen, u32 nWindow)
+    : owned(owned), A(A), policy(work.policy()), symmetric(Parallel::isSymmetric(A)),
+      nDeflate(nDeflate), nEigen(nEigen), nWindow(nWindow),
+      W(work.matrix(A.cols(), nDeflate)), AW(work.matrix(A.cols(), nDeflate)), Einv(work.matrix(nDeflate, nDeflate)),
+      V(work.matrix(A.cols(), nWindow)), Vtmp(work.matrix(A.cols(), 2*nEigen)), T(work.matrix(nWindow, nWindow)),
+      Y(work.matrix(nWindow, 2*nEigen)), Q(work.matrix(nWindow, 2*nEigen)), H(work.matrix(2*nEigen, 2*nEigen)),
+      eigT(nWindow), eigTm1(nWindow-1), eigH(2*nEigen), qrY(nWindow, 2*nEigen), qrWork(2*nEigen),
+      rk(work.vector(A.cols())), rkp1(work.vector(A.cols())), pk(work.vector(A.cols())), qk(work.vector(A.cols())),
+      wr(work.vector(nDeflate)), mu(work.vector(nDeflate)) {
+
+    // All internal vectors are mapped (zeroed) into the arena
+    u32 n = A.rows();
+    u32 m = A.cols();
+    CHECK_FATAL_ASSERT(n==m, "Number of rows and columns of sparse matrix A do not match.")
+    CHECK_FATAL_ASSERT(nEigen > 0 && nWindow > 2*nEigen, "Lanczos window needs to hold more than 2*nEigen vectors.")
+    if (!symmetric) WARN_MSG("Deflated CG needs a symmetric A, this one is not (e.g. the 5-point A of a stretched grid)");
+    reset();
+}
+
+u64 DeflatedCG::workspaceBytes(u32 n, u32 nDeflate, u32 nEigen, u32 nWindow){
+    return 4*Workspace::vectorBytes(n) + 2*Workspace::vectorBytes(nDeflate)
+         + 2*Workspace::matrixBytes(n, nDeflate) + Workspace::matrixBytes(nDeflate, nDeflate)
+         + Workspace::matrixBytes(n, nWindow) + Workspace::matrixBytes(n, 2*nEigen) 
+         + Workspace::matrixBytes(nWindow, nWindow) + 2*Workspace::matrixBytes(nWindow, 2*nEigen)
+         + Workspace::matrixBytes(2*nEigen, 2*nEigen);
+}
+
+void DeflatedCG::reset(){
+    kW = 0;
+    theta.resize(0);
+}
+
+solveReport DeflatedCG::solve(EigenDefs::Vector<f64> &u,
+                              EigenDefs::Vector<f64> &b,
+                              f64 tol, u32 iterMax){
+    convergenceCriteria criteria;
+    criteria.absolute = tol;
+    criteria.maxiter  = iterMax;
+    return solve(u, b, criteria);
+}
+
+solveReport DeflatedCG::solve(EigenDefs::Vector<f64> &u,
+                              EigenDefs::Vector<f64> &b,
+                              const convergenceCriteria &criteria){
+
+    // Initialization
+    convergenceMonitor monitor(criteria);
+    u32 iter = 0;     /**< Iterate count */
+    f64 err = 1./0.;  /**< residual error */
+    f64 rr;           /**< squared norm of the residual */
+    product(u.data(), rk); // Initial guess, written without temporaries (as are all expressions below)
+    rk     = b - rk;
+    vs     = 0;
+
+    // Solve the deflated modes directly, such that W^T r0 = 0
+    if (kW > 0){
+        wr.head(kW).noalias() = W.leftCols(kW).transpose()*rk;
+        mu.head(kW).noalias() = Einv.topLeftCorner(kW, kW)*wr.head(kW);
+        u.noalias()  += W.leftCols(kW)*mu.head(kW);
+        rk.noalias() -= AW.leftCols(kW)*mu.head(kW);
+    }
+
+    // A warm start may already be converged, skip the iterations (alphak would be 0/0)
+    err = std::sqrt( dot(rk.data(), rk.data())/rk.size() );
+    convergenceStatus status = monitor.start(err, std::sqrt( dot(b.data(), b.data())/b.size() ));
+    if (status == SOLVE_CONVERGED) return solveReport{iter, err, status};
+
+    // p0 = r0 - W E^-1 (AW)^T r0
+    pk = rk;
+    deflate(rk);
+
+    do {
+        // Update iterate
+        rr     = dot(rk.data(), rk.data());
+        product(pk.data(), qk);
+        alphak = rr / dot(pk.data(), qk.data());
+        u.noalias() += alphak*pk;
+
+        // Extend the Lanczos window with v = rk/|rk|
+        lanczos(iter, rr);
+
+        // Update residual
+        rkp1   = rk - alphak*qk;
+        err    = std::sqrt( dot(rkp1.data(), rkp1.data())/rkp1.size() );
+
+        // Termination criteria, convergence is confirmed on the true residual, which then replaces the recursive one
+        CHECK_FATAL_ITERERROR(iter, err);
+        INFO_MSG("iter = %-5u err = %1.4e", iter, err);
+        iter++;
+        status = monitor.check(iter, err);
+        if (status == SOLVE_CONVERGED || monitor.replace(iter)){
+            product(u.data(), rkp1);
+            rkp1   = b - rkp1;
+            err    = std::sqrt( dot(rkp1.data(), rkp1.data())/rkp1.size() );
+            status = monitor.confirm(iter, err);
+        }
+        if (status != SOLVE_RUNNING) break;
+
+        // Update search direction, A-orthogonal to W
+        betak  = dot(rkp1.data(), rkp1.data()) / rr;
+        pk     = rkp1 + betak*pk;
+        deflate(rkp1);
+
+        // Update iteration
+        alphakm1 = alphak;
+        betakm1  = betak;
+        rk       = rkp1;
+
+    } while (true);
+
+    harvest();
+
+    return solveReport{iter, err, status};
+}
+
+void DeflatedCG::deflate(const Workspace::VectorMap<f64> &r){
+
+    // pk -= W E^-1 (AW)^T r
+    if (kW == 0) return;
+    wr.head(kW).noalias() = AW.leftCols(kW).transpose()*r;
+    mu.head(kW).noalias() = Einv.topLeftCorner(kW, kW)*wr.head(kW);
+    pk.noalias() -= W.leftCols(kW)*mu.head(kW);
+}
+
+void DeflatedCG::lanczos(u32 iter, f64 rr){
+
+    // T_{j,j} = 1/alpha_j + beta_{j-1}/alpha_{j-1}, T_{j-1,j} = -sqrt(beta_{j-1})/alpha_{j-1}
+    if (vs == nWindow) {
+        restart();
+    } else if (vs > 0) {
+        T(vs-1, vs) = -std::sqrt(betakm1)/alphakm1;
+        T(vs, vs-1) = T(vs-1, vs);
+    }
+    T(vs, vs) = 1./alphak + (iter > 0 ? betakm1/alphakm1 : 0.);
+    V.col(vs) = rk/std::sqrt(rr);
+    vs++;
+}
+
+void DeflatedCG::restart(){
+
+    const u32 m = nWindow;
+    const u32 k = nEigen;
+
+    // Smallest Ritz vectors of T and of T without its last row/column, the latter padded with a zero row
+    eigT.compute(T);
+    eigTm1.compute(T.topLeftCorner(m-1, m-1));
+    Y.setZero();
+    Y.leftCols(k)         = eigT.eigenvectors().leftCols(k);
+    Y.block(0, k, m-1, k) = eigTm1.eigenvectors().leftCols(k);
+
+    // Orthonormalise as Q, and diagonalise T in that basis (Y is reused as scratch from here on)
+    qrY.compute(Y);
+    Q.setIdentity();
+    qrY.householderQ().applyThisOnTheLeft(Q, qrWork);
+    Y.noalias() = T*Q;
+    H.noalias() = Q.transpose()*Y;
+    eigH.compute(H);
+    Y.noalias() = Q*eigH.eigenvectors();
+
+    // Restarted window, the next Lanczos vector only couples with the last vector of the old window
+    Vtmp.noalias()  = V*Y;
+    V.leftCols(2*k) = Vtmp;
+    T.setZero();
+    T.diagonal().head(2*k) = eigH.eigenvalues();
+    T.col(2*k).head(2*k)   = -std::sqrt(betakm1)/alphakm1 * Y.row(m-1).transpose();
+    T.row(2*k).head(2*k)   = T.col(2*k).head(2*k).transpose();
+    vs = 2*k;
+}
+
+void DeflatedCG::harvest(){
+
+    // N.B. Once per solve, so the (small) dense temporaries below are allowed to allocate
+    if (vs == 0) return;
+
+    // Smallest Ritz vectors of this solve
+    Eigen::SelfAdjointEigenSolver< EigenDefs::Matrix<f64> > eigV(T.topLeftCorner(vs, vs));
+    const u32 kEig = std::min(nEigen, vs);
+
+    // Search space S = [W, V Y], orthonormalised as Qs
+    const u32 n = A.cols();
+    const u32 c = kW + kEig;
+    EigenDefs::Matrix<f64> S(n, c);
+    S.leftCols(kW)    = W.leftCols(kW);
+    S.rightCols(kEig) = V.leftCols(vs) * eigV.eigenvectors().leftCols(kEig);
+
+    Eigen::HouseholderQR< EigenDefs::Matrix<f64> > qr(S);
+    EigenDefs::Matrix<f64> Qs  = qr.householderQ() * EigenDefs::Matrix<f64>::Identity(n, c);
+    EigenDefs::Matrix<f64> AQs = A*Qs;
+
+    // Rayleigh-Ritz: eigenpairs of the projected (symmetric) matrix, sorted by increasing Ritz value
+    EigenDefs::Matrix<f64> Hs = Qs.transpose()*AQs;
+    Eigen::SelfAdjointEigenSolver< EigenDefs::Matrix<f64> > eigS(0.5*(Hs + Hs.transpose()));
+
+    // Keep the Ritz vectors of the smallest Ritz values
+    kW = std::min(nDeflate, c);
+    W.leftCols(kW)  = Qs  * eigS.eigenvectors().leftCols(kW);
+    AW.leftCols(kW) = AQs * eigS.eigenvectors().leftCols(kW);
+    theta = eigS.eigenvalues().head(kW);
+
+    EigenDefs::Matrix<f64> E = W.leftCols(kW).transpose()*AW.leftCols(kW);
+    Einv.topLeftCorner(kW, kW) = E.inverse();
+
+    DEBUG_MSG("Deflation space updated, k = %u, smallest Ritz value = %1.4e", kW, theta[0]);
+}
+
+void DeflatedCG::product(const f64* x, Workspace::VectorMap<f64> &y){
+
+    // Threaded over the row partition the workspace was first-touched with, when the arena has an execution policy and
+    // A is symmetric (the threads compute A^T x, see executionPolicy::symmetricProduct)
+    if (policy != nullptr && symmetric) policy->symmetricProduct(A, x, y.data());
+    else                                y.noalias() = A*Eigen::Map<const EigenDefs::Vector<f64>>(x, A.cols());
+}
+
+f64 DeflatedCG::dot(const f64* x, const f64* y) const{
+    const u64 n = A.cols();
+    if (policy != nullptr) return policy->dot(x, y, n);
+    return Eigen::Map<const EigenDefs::Vector<f64>>(x, n).dot(Eigen::Map<const EigenDefs::Vector<f64>>(y, n));
+}
+
+} // end KrylovSolver
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+#include "convergence.hpp"
+#include "core/arena.hpp"
+
+#include "Eigen/QR"
+#include "Eigen/Eigenvalues"
+
+#include <memory>
+
+/************************************************************************************************************************
+ *  @brief All Krylov iterative solvers are stored underneath this namespace.
+ *
+ *  @details
+ *  This currently includes CG, deflated CG, BiCGstab(l).
+ ************************************************************************************************************************/
+namespace KrylovSolver{
+
+/************************************************************************************************************************
+ *  @brief A deflated conjugate-gradient solver that recycles spectral information between solves. Used only with
+ *         symmetric positive-definite A, for sequences of systems sharing the same A.
+ *
+ *  @details
+ *  The convergence of CG is governed by the effective condition number of A. For the Dirichlet Laplacian, the smallest
+ *  eigenvalues shrink like h^2, and it is exactly these few smooth modes that keep CG iterating at fine resolution.
+ *  If we knew a basis W of the eigenvectors belonging to the k smallest eigenvalues, we could solve for those modes
+ *  directly (a small k x k system E = W^T A W) and let CG work in the A-orthogonal complement of W only. The effective
+ *  condition number then becomes lambda_max/lambda_{k+1} instead of lambda_max/lambda_1.
+ *
+ *  Deflated CG does exactly this: the initial guess is corrected such that W^T r0 = 0, and every search direction is
+ *  A-orthogonalised against W, i.e. p_{j+1} = beta_j p_j + r_{j+1} - W E^{-1} (AW)^T r_{j+1}.
+ *
+ *  We do not know W in advance, but the CG coefficients alphak, betak of every solve define the Lanczos tridiagonal
+ *  matrix T of the normalised residuals v_j = r_j/|r_j|, whose Ritz pairs approximate the eigenpairs of A. Storing all
+ *  residuals is out of the question, so we use the eigCG windowing: only a window of nWindow Lanczos vectors is kept,
+ *  and whenever it is full it is restarted (thick restart) with the 2*nEigen Ritz vectors belonging to the smallest Ritz
+ *  values of T and of T without its last row/column. Since the residual of the next iteration only couples with the
+ *  last Lanczos vector, the restarted T stays available without any extra SpMV. At the end of a solve, the nEigen
+ *  smallest Ritz vectors of the window are merged with the current W through a Rayleigh-Ritz procedure, and the
+ *  nDeflate vectors with the smallest Ritz values are kept. Every solve therefore improves the deflation space of the
+ *  next one, which (being deflated) resolves the next part of the spectrum.
+ *
+ *  * see "A deflated version of the conjugate gradient algorithm" by Saad, Yeung, Erhel, Guyomarc'h 2000
+ *  * see "Computing and deflating eigenvalues while solving multiple right hand side linear systems with an
+ *    application to quantum chromodynamics" by Stathopoulos, Orginos 2010
+ *  * see "Recycling Krylov subspaces for sequences of linear systems" by Parks, de Sturler et al. 2006
+ *  * see "Theoretical comparison of two-level preconditioners" by Tang, Nabben, Vuik, Erlangga 2009
+ ************************************************************************************************************************/
+class DeflatedCG{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction takes a reference to the sparse A matrix, the number of deflation vectors to keep, the
+             number of Ritz vectors computed per solve, and the size of the Lanczos window (at least 2*nEigen+1) */
+        DeflatedCG(Eigen::SparseMatrix<f64> &A, u32 nDeflate = 16, u32 nEigen = 8, u32 nWindow = 24);
+
+        /**< Same as the default construction, but maps all internal vectors into a shared arena */
+        DeflatedCG(Eigen::SparseMatrix<f64> &A, Workspace::arena &work, u32 nDeflate = 16, u32 nEigen = 8, u32 nWindow = 24);
+
+        /**< Bytes of arena needed by a solver of size n */
+        static u64 workspaceBytes(u32 n, u32 nDeflate = 16, u32 nEigen = 8, u32 nWindow = 24);
+
+        /**< Disabled construction using another DeflatedCG solver */
+        DeflatedCG(const DeflatedCG&) = delete;
+
+        /**< Disabled construction by equating to another DeflatedCG solver */
+        DeflatedCG& operator =(const DeflatedCG&) = delete;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Runs through the deflated conjugate-gradient algorithm to find the solution to Au = b, and updates the
+         *         deflation space from the Krylov subspace built on the way.
+         *
+         *  @param u       reference to the solution vector of the system Au = b, holds the initial guess on entry.
+         *  @param b       reference to the forcing vector of the system Au = b.
+         *  @param tol     tolerance for convergence, default 1e-15.
+         *  @param maxiter maximum number of iterations for convergence, default 5000.
+         *
+         *  @return report holding the number of iterations taken and the final residual.
+         ************************************************************************************************************************/
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          f64 tol = 1e-15,
+                          u32 maxiter = 5000);
+
+        /************************************************************************************************************************ 
+         *  @brief Same as above, stopping as decided by a convergence monitor applying the given criteria.
+         * 
+         *  @param u        reference to the solution vector of the system Au = b, holds the initial guess on entry.
+         *  @param b        reference to the forcing vector of the system Au = b.
+         *  @param criteria reference to the convergence criteria (tolerances, iteration cap, stagnation, divergence, ...).
+         * 
+         *  @return report holding the number of iterations taken, the final residual and why the solve ended.
+         ************************************************************************************************************************/ 
+        solveReport solve(EigenDefs::Vector<f64> &u,
+                          EigenDefs::Vector<f64> &b,
+                          const convergenceCriteria &criteria);
+
+        /**< Forgets the deflation space, e.g. when the entries of A changed */
+        void reset();
+
+        /**< Ritz values belonging to the current deflation vectors, approximations of the smallest eigenvalues of A */
+        const EigenDefs::Vector<f64>& ritzValues() const { return theta; }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        DeflatedCG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, u32 nDeflate, u32 nEigen, u32 nWindow);
+        DeflatedCG(Eigen::SparseMatrix<f64> &A, Workspace::arena *owned, Workspace::arena &work, u32 nDeflate, u32 nEigen, u32 nWindow);
+        void product(const f64* x, Workspace::VectorMap<f64> &y);
+        f64 dot(const f64* x, const f64* y) const;
+        void deflate(const Workspace::VectorMap<f64> &r);
+        void lanczos(u32 iter, f64 rr);
+        void restart();
+        void harvest();
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        std::unique_ptr<Workspace::arena> owned; /**< arena owned by the solver, if none was provided */
+        Eigen::SparseMatrix<f64> &A;             /**< Internal reference of the sparse matrix*/
+        const Parallel::executionPolicy* policy; /**< threads running the products and dots, those of the arena (nullptr: serial) */
+        bool symmetric;                          /**< whether A is symmetric, which the threaded product relies on */
+        u32 nDeflate;                            /**< max number of deflation vectors */
+        u32 nEigen;                              /**< number of Ritz vectors computed per solve */
+        u32 nWindow;                             /**< max number of Lanczos vectors stored */
+
+        Workspace::MatrixMap<f64> W;             /**< deflation vectors, approximate eigenvectors of the smallest eigenvalues */
+        Workspace::MatrixMap<f64> AW;            /**< A*W, kept to avoid SpMVs */
+        Workspace::MatrixMap<f64> Einv;          /**< (W^T A W)^-1, tiny and dense */
+        EigenDefs::Vector<f64> theta;            /**< Ritz values of the deflation vectors */
+        u32 kW;                                  /**< number of deflation vectors currently in W */
+
+        Workspace::MatrixMap<f64> V, Vtmp;       /**< Lanczos window: normalised residuals and restarted Ritz vectors */
+        Workspace::MatrixMap<f64> T;             /**< projection of A onto the Lanczos window, V^T A V */
+        Workspace::MatrixMap<f64> Y, Q, H;       /**< restart: Ritz vectors of T, their orthonormalised basis, projected T */
+        u32 vs;                                  /**< number of vectors currently in the Lanczos window */
+        f64 alphakm1, betakm1;                   /**< update coefficients of the previous iteration, to extend T */
+
+        /**< small dense factorisations of the restart, preallocated such that compute() does not allocate */
+        Eigen::SelfAdjointEigenSolver< EigenDefs::Matrix<f64> > eigT, eigTm1, eigH;
+        Eigen::HouseholderQR< EigenDefs::Matrix<f64> >          qrY;
+        Eigen::Matrix<f64, 1, Eigen::Dynamic>                   qrWork;
+
+        Workspace::VectorMap<f64> rk, rkp1;      /**< residual vector */
+        Workspace::VectorMap<f64> pk;            /**< search/conjugate direction vector */
+        Workspace::VectorMap<f64> qk;            /**< search/conjugate direction vector */
+        Workspace::VectorMap<f64> wr, mu;        /**< (AW)^T r, and coefficients of the deflation correction */
+        f64 alphak, betak;                       /**< update coefficients */
+
+};
+
+} // end KrylovSolver
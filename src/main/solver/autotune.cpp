@@ -0,0 +1,327 @@
+#include "CoreIncludes.hpp"
+#include "autotune.hpp"
+#include "CG.hpp"
+#include "DeflatedCG.hpp"
+#include "BiCGstab_l_.hpp"
+#include "Chebyshev.hpp"
+
+#include "Eigen/SparseLU"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+namespace Autotune{
+
+/**< Names of the configurations, in the order of candidates() */
+static const struct { configuration config; const char* name; } names[] = {
+    {{SOLVER_CG,          Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "cg"},
+    {{SOLVER_CG,          Preconditioner::PRECONDITIONER_JACOBI,    Mesh::ORDERING_NATURAL},              "cg+jacobi"},
+    {{SOLVER_CG,          Preconditioner::PRECONDITIONER_IC,        Mesh::ORDERING_NATURAL},              "cg+ic"},
+    {{SOLVER_CG,          Preconditioner::PRECONDITIONER_IC,        Mesh::ORDERING_RCM},                  "cg+ic+rcm"},
+    {{SOLVER_CG,          Preconditioner::PRECONDITIONER_IC,        Mesh::ORDERING_MULTICOLOUR},          "cg+ic+multicolour"},
+    {{SOLVER_CG,          Preconditioner::PRECONDITIONER_CHEBYSHEV, Mesh::ORDERING_NATURAL},              "cg+chebyshev"},
+    {{SOLVER_DEFLATED_CG, Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "deflatedcg"},
+    {{SOLVER_BICGSTAB_2,  Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "bicgstab2"},
+    {{SOLVER_BICGSTAB_4,  Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "bicgstab4"},
+    {{SOLVER_BICGSTAB_8,  Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "bicgstab8"},
+    {{SOLVER_SPARSE_LU,   Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "sparselu"},
+    {{SOLVER_SPARSE_LU,   Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NESTED_DISSECTION},    "sparselu+nd"},
+    {{SOLVER_CHEBYSHEV,   Preconditioner::PRECONDITIONER_NONE,      Mesh::ORDERING_NATURAL},              "chebyshev"},
+};
+
+std::string name(const configuration &config){
+    for (const auto &known : names){
+        if (known.config.solver == config.solver && known.config.preconditioner == config.preconditioner &&
+            known.config.ordering == config.ordering) return known.name;
+    }
+    return "unknown";
+}
+
+bool parse(const std::string &text, configuration &config){
+    for (const auto &known : names){
+        if (text != known.name) continue;
+        config = known.config;
+        return true;
+    }
+    return false;
+}
+
+/**< Whether a solver needs a symmetric (positive-definite) A */
+static bool needsSymmetry(solverType solver){
+    return solver == SOLVER_CG || solver == SOLVER_DEFLATED_CG || solver == SOLVER_CHEBYSHEV;
+}
+
+std::vector<configuration> candidates(bool singular, bool symmetric){
+    std::vector<configuration> list;
+    for (const auto &known : names){
+        if (singular && known.config.solver == SOLVER_SPARSE_LU) continue;
+        if (!symmetric && needsSymmetry(known.config.solver)) continue;
+        list.push_back(known.config);
+    }
+    return list;
+}
+
+std::string signature(const Mesh::gridStruct &grid, const Mesh::boundaryStruct &boundaries, Mesh::stencilType stencil, u32 threads){
+
+    // Spacing uniformity, per direction
+    bool uniform = true;
+    for (const EigenDefs::Array1D<f64>* points : {&grid.x, &grid.y}){
+        const u32 n = points->size();
+        const f64 h = ((*points)[n-1] - (*points)[0])/(n-1);
+        for (u32 i=1; i<n; i++) uniform = uniform && std::abs((*points)[i] - (*points)[i-1] - h) < 1e-8*std::abs(h);
+    }
+
+    // Boundary condition types, north, west, south, east
+    const char letters[4] = {'d', 'n', 'r', 'p'};
+    const char faces[5]   = {letters[boundaries.NorthBC.type], letters[boundaries.WestBC.type],
+                             letters[boundaries.SouthBC.type], letters[boundaries.EastBC.type], '\0'};
+
+    char key[128];
+    snprintf(key, sizeof(key), "%ux%u:%s:%s:%s:%ut", (u32) grid.x.size(), (u32) grid.y.size(), uniform ? "uniform" : "stretched",
+             faces, stencil == Mesh::STENCIL_MEHRSTELLEN ? "9pt" : "5pt", threads);
+    return key;
+}
+
+u64 workspaceBytes(const configuration &config, u32 n){
+    switch (config.solver){
+        case SOLVER_CG:          return KrylovSolver::CG::workspaceBytes(n);
+        case SOLVER_DEFLATED_CG: return KrylovSolver::DeflatedCG::workspaceBytes(n);
+        case SOLVER_BICGSTAB_2:  return KrylovSolver::BiCGstab<2>::workspaceBytes(n);
+        case SOLVER_BICGSTAB_4:  return KrylovSolver::BiCGstab<4>::workspaceBytes(n);
+        case SOLVER_BICGSTAB_8:  return KrylovSolver::BiCGstab<8>::workspaceBytes(n);
+        case SOLVER_CHEBYSHEV:   return KrylovSolver::Chebyshev::workspaceBytes(n);
+        case SOLVER_SPARSE_LU:   break;
+    }
+    return Workspace::vectorBytes(1);
+}
+
+/**< Exact spectrum of A from the discretization it was assembled from, returns false if unknown */
+static bool spectrum(const Mesh::discretizationStruct* problem, f64 &lower, f64 &upper){
+    return problem != nullptr && Preconditioner::analyticBounds(*problem->grid, *problem->boundaries, problem->stencil, lower, upper);
+}
+
+/**< Factorises M with a sparse LU solver and solves M x = y, setup being the seconds since start once factorised */
+template<typename Solver>
+static bool factoriseAndSolve(Solver &solver, const Eigen::SparseMatrix<f64> &M, const EigenDefs::Vector<f64> &y,
+                              EigenDefs::Vector<f64> &x, std::chrono::steady_clock::time_point start, f64 &setup){
+    solver.analyzePattern(M); // Compute the column permutation to minimize the fill-in
+    solver.factorize(M);      // Compute the numerical factorization
+    setup = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    if (solver.info() != Eigen::Success){
+        WARN_MSG("Sparse LU factorisation failed: %s", solver.lastErrorMessage().c_str());
+        return false;
+    }
+    x = solver.solve(y);
+    return true;
+}
+
+/**< Solves with a configuration, and returns the seconds its setup (preconditioner, factorisation) took */
+static KrylovSolver::solveReport run(const configuration &config,
+                                     Eigen::SparseMatrix<f64> &A,
+                                     EigenDefs::Vector<f64> &u,
+                                     EigenDefs::Vector<f64> &b,
+                                     const KrylovSolver::convergenceCriteria &criteria,
+                                     Workspace::arena &work,
+                                     const Mesh::linearOperator* op,
+                                     Profiling::profiler* profiler,
+                                     const Mesh::discretizationStruct* problem,
+                                     f64 &setup){
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    setup = 0.;
+    switch (config.solver){
+        case SOLVER_CG: {
+            std::unique_ptr<Preconditioner::preconditioner> M;
+            if (config.preconditioner != Preconditioner::PRECONDITIONER_NONE){
+                M = std::make_unique<Preconditioner::preconditioner>(A, config.preconditioner, work.policy(), config.ordering, problem);
+            }
+            KrylovSolver::CG solver(A, work);
+            solver.precondition(M.get());
+            solver.matrixFree(op);
+            solver.profile(profiler);
+            setup = std::chrono::duration<f64>(clock::now() - start).count();
+            return solver.solve(u, b, criteria);
+        }
+        case SOLVER_DEFLATED_CG: { KrylovSolver::DeflatedCG  solver(A, work); return solver.solve(u, b, criteria); }
+        case SOLVER_BICGSTAB_2:  { KrylovSolver::BiCGstab<2> solver(A, work); return solver.solve(u, b, criteria); }
+        case SOLVER_BICGSTAB_4:  { KrylovSolver::BiCGstab<4> solver(A, work); return solver.solve(u, b, criteria); }
+        case SOLVER_BICGSTAB_8:  { KrylovSolver::BiCGstab<8> solver(A, work); return solver.solve(u, b, criteria); }
+        case SOLVER_CHEBYSHEV: {
+            f64 lower, upper;
+            if (!spectrum(problem, lower, upper)){
+                WARN_MSG("Chebyshev iteration needs the spectrum of A, only known on uniform grids with Dirichlet faces");
+                return KrylovSolver::solveReport{0, std::numeric_limits<f64>::infinity(), KrylovSolver::SOLVE_DIVERGED};
+            }
+            KrylovSolver::Chebyshev solver(A, work);
+            solver.bounds(lower, upper);
+            solver.matrixFree(op);
+            return solver.solve(u, b, criteria);
+        }
+        case SOLVER_SPARSE_LU:   break;
+    }
+
+    // - see https://eigen.tuxfamily.org/dox/classEigen_1_1SparseLU.html
+    bool factorised;
+    if (config.ordering == Mesh::ORDERING_NATURAL){
+        Eigen::SparseLU<Eigen::SparseMatrix<f64>> solver;
+        factorised = factoriseAndSolve(solver, A, b, u, start, setup);
+    }
+    else {
+        // Renumbered by the ordering of the configuration, which the factorisation keeps as its column ordering
+        const Mesh::ordering order = Mesh::makeOrdering(A, config.ordering);
+        Eigen::SparseMatrix<f64> PA;
+        Mesh::permute(order, A, PA);
+        EigenDefs::Vector<f64> pb(b.size()), pu;
+        Mesh::gather(order, b.data(), pb.data(), b.size());
+        Eigen::SparseLU<Eigen::SparseMatrix<f64>, Eigen::NaturalOrdering<i32>> solver;
+        factorised = factoriseAndSolve(solver, PA, pb, pu, start, setup);
+        if (factorised) Mesh::scatter(order, pu.data(), u.data(), u.size());
+    }
+    if (!factorised) return KrylovSolver::solveReport{1, std::numeric_limits<f64>::infinity(), KrylovSolver::SOLVE_DIVERGED};
+    const f64 err = std::sqrt( (b - A*u).squaredNorm()/u.size() );
+    return KrylovSolver::solveReport{1, err, KrylovSolver::SOLVE_CONVERGED};
+}
+
+KrylovSolver::solveReport solve(const configuration &config,
+                                Eigen::SparseMatrix<f64> &A,
+                                EigenDefs::Vector<f64> &u,
+                                EigenDefs::Vector<f64> &b,
+                                const KrylovSolver::convergenceCriteria &criteria,
+                                Workspace::arena &work,
+                                const Mesh::linearOperator* op,
+                                Profiling::profiler* profiler,
+                                const Mesh::discretizationStruct* problem){
+    f64 setup;
+    return run(config, A, u, b, criteria, work, op, profiler, problem, setup);
+}
+
+
+
+autotuner::autotuner(const std::string &fileName, const Parallel::executionPolicy* policy, const trialSettings &settings)
+    : fileName(fileName), policy(policy), settings(settings) {
+
+    // A missing database is an empty one, lines that do not parse are skipped
+    std::ifstream file(fileName);
+    std::string line;
+    while (std::getline(file, line)){
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key, config;
+        entry stored;
+        if (!(fields >> key >> config >> stored.seconds) || !parse(config, stored.config)){
+            WARN_MSG("Skipping unreadable line of %s: %s", fileName.c_str(), line.c_str());
+            continue;
+        }
+        entries[key] = stored;
+    }
+    DEBUG_MSG("Autotune database %s holds %u entries", fileName.c_str(), (u32) entries.size());
+}
+
+bool autotuner::lookup(const std::string &key, configuration &config) const{
+    auto found = entries.find(key);
+    if (found == entries.end()) return false;
+    config = found->second.config;
+    return true;
+}
+
+void autotuner::record(const std::string &key, const configuration &config, f64 seconds){
+    entries[key] = entry{config, seconds};
+
+    // Written aside and renamed over the database, such that an interrupted run never leaves half a file
+    const std::string temporary = fileName + ".tmp";
+    std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+    file << "# signature configuration seconds\n";
+    for (const auto &[stored, value] : entries){
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%1.4e", value.seconds);
+        file << stored << " " << name(value.config) << " " << seconds << "\n";
+    }
+    file.close();
+    if (file.fail() || std::rename(temporary.c_str(), fileName.c_str()) != 0){
+        WARN_MSG("Could not write the autotune database %s", fileName.c_str());
+    }
+}
+
+configuration autotuner::select(const std::string &key,
+                                Eigen::SparseMatrix<f64> &A,
+                                EigenDefs::Vector<f64> &b,
+                                const KrylovSolver::convergenceCriteria &criteria,
+                                bool singular,
+                                const Mesh::linearOperator* op,
+                                const Mesh::discretizationStruct* problem){
+
+    // A stored CG configuration of a non-symmetric A (written before such ones were left out) is tuned again
+    configuration config;
+    const bool symmetric = Parallel::isSymmetric(A);
+    if (lookup(key, config) && (symmetric || !needsSymmetry(config.solver))){
+        INFO_MSG("Autotune: %s uses %s (from %s)", key.c_str(), name(config).c_str(), fileName.c_str());
+        return config;
+    }
+
+    // Every candidate is timed with the per-iteration messages of the solvers silenced
+    INFO_MSG("Autotune: no entry for %s in %s, timing trial runs", key.c_str(), fileName.c_str());
+    const logLevel level = logGetLevel();
+    f64 best = std::numeric_limits<f64>::infinity(), lower, upper;
+    const bool bounded = spectrum(problem, lower, upper);
+    for (const configuration &candidate : candidates(singular, symmetric)){
+        if (candidate.solver == SOLVER_SPARSE_LU && A.cols() > settings.directLimit) continue;
+        if (candidate.solver == SOLVER_CHEBYSHEV && !bounded) continue;
+        logSetLevel(level < LOG_LEVEL_WARN ? level : LOG_LEVEL_WARN);
+        const f64 seconds = trial(candidate, A, b, criteria, op, problem);
+        logSetLevel(level);
+        INFO_MSG("Autotune: %-12s %1.4e s (estimated)", name(candidate).c_str(), seconds);
+        if (seconds < best){
+            best   = seconds;
+            config = candidate;
+        }
+    }
+
+    // Nothing made progress: keep the default, and do not store it, such that the next run tries again
+    if (!std::isfinite(best)){
+        WARN_MSG("Autotune: no candidate reduced the residual, using %s", name(configuration{}).c_str());
+        return configuration{};
+    }
+    INFO_MSG("Autotune: %s uses %s, stored in %s", key.c_str(), name(config).c_str(), fileName.c_str());
+    record(key, config, best);
+    return config;
+}
+
+f64 autotuner::trial(const configuration &config,
+                     Eigen::SparseMatrix<f64> &A,
+                     EigenDefs::Vector<f64> &b,
+                     const KrylovSolver::convergenceCriteria &criteria,
+                     const Mesh::linearOperator* op,
+                     const Mesh::discretizationStruct* problem) const{
+
+    const u32 n = A.cols();
+    EigenDefs::Vector<f64> u = EigenDefs::Vector<f64>::Zero(n);
+    Workspace::arena work(workspaceBytes(config, n), policy);
+
+    // A short run of the real criteria, without residual replacement (it would only add SpMVs to the short run)
+    KrylovSolver::convergenceCriteria limited = criteria;
+    limited.maxiter     = settings.iterations;
+    limited.replacement = 0;
+
+    using clock = std::chrono::steady_clock;
+    f64 setup;
+    const clock::time_point start = clock::now();
+    const KrylovSolver::solveReport report = run(config, A, u, b, limited, work, op, nullptr, problem, setup);
+    const f64 seconds = std::chrono::duration<f64>(clock::now() - start).count();
+
+    if (report.status == KrylovSolver::SOLVE_CONVERGED) return seconds;
+    if (report.status == KrylovSolver::SOLVE_DIVERGED)  return std::numeric_limits<f64>::infinity();
+
+    // Iterations needed to reach the tolerance, at the reduction rate of the trial
+    const f64 r0     = std::sqrt( b.squaredNorm()/n );
+    const f64 target = std::max({criteria.absolute, criteria.relative*r0, criteria.discretization});
+    if (!(report.residual < r0) || !(target < r0)) return std::numeric_limits<f64>::infinity();
+    return setup + (seconds - setup)*std::log(r0/target)/std::log(r0/report.residual);
+}
+
+} // namespace Autotune
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+#include "convergence.hpp"
+#include "core/arena.hpp"
+#include "core/profiler.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/ordering.hpp"
+#include "mesh/stencilOperator.hpp"
+#include "preconditioner/preconditioners.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/************************************************************************************************************************
+ *  @brief Picking the solver (and its preconditioner) of a problem is represented in this namespace.
+ *
+ *  @details
+ *  Which of CG, BiCGstab(l) or a sparse LU factorisation is fastest depends on the size of the grid, on its boundary
+ *  conditions (which decide e.g. whether A is singular) and on the machine. Rather than hard-coding one, the autotuner
+ *  times a short trial run of every candidate configuration, extrapolates it to the full solve, and keeps the fastest.
+ *  The winner is stored in an on-disk database keyed by the problem signature, such that later runs on the same kind
+ *  of problem pick it without any trial.
+ ************************************************************************************************************************/
+namespace Autotune{
+
+/* list of solvers the autotuner picks from */
+typedef enum solverType{
+    SOLVER_CG          = 0, /**< conjugate gradients, optionally preconditioned */
+    SOLVER_DEFLATED_CG = 1, /**< deflated conjugate gradients */
+    SOLVER_BICGSTAB_2  = 2, /**< BiCGstab(2) */
+    SOLVER_BICGSTAB_4  = 3, /**< BiCGstab(4) */
+    SOLVER_BICGSTAB_8  = 4, /**< BiCGstab(8) */
+    SOLVER_SPARSE_LU   = 5, /**< sparse LU factorisation (Eigen::SparseLU), direct */
+    SOLVER_CHEBYSHEV   = 6, /**< Chebyshev iteration, on the exact spectrum of A (uniform Dirichlet grids only) */
+} solverType;
+
+/**< Simplistic structure holding one solver configuration */
+struct configuration{
+    solverType solver = SOLVER_BICGSTAB_8;                                                 /**< solver */
+    Preconditioner::preconditionerType preconditioner = Preconditioner::PRECONDITIONER_NONE; /**< preconditioner (CG only) */
+    Mesh::orderingType ordering = Mesh::ORDERING_NATURAL;  /**< numbering of the IC factor or of the sparse LU, natural: as assembled */
+};
+
+/**< Simplistic structure holding how the trial runs are done */
+struct trialSettings{
+    u32 iterations  = 60;       /**< iterations of every iterative trial, extrapolated to the tolerance */
+    u32 directLimit = 250000;   /**< largest number of unknowns a sparse LU factorisation is tried for */
+};
+
+/**< Name of a configuration, e.g. cg+ic, cg+ic+rcm or bicgstab8, as stored in the database */
+std::string name(const configuration &config);
+
+/**< Configuration of a name, returns false if the name is unknown */
+bool parse(const std::string &text, configuration &config);
+
+/**< Candidate configurations, sparse LU excluded for singular problems (pure Neumann/periodic), and the CG ones
+     (plain, deflated, Chebyshev iteration) for a non-symmetric A, e.g. the 5-point one of a stretched grid. Chebyshev
+     iteration is only tried when the spectrum of A is known as well (see autotuner::select) */
+std::vector<configuration> candidates(bool singular, bool symmetric = true);
+
+
+
+/************************************************************************************************************************
+ *  @brief Computes the signature the database is keyed by: what decides the best solver, but not the data itself.
+ *
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary conditions, only their types are used.
+ *  @param stencil    discretization the system is assembled with.
+ *  @param threads    number of threads the solver runs on.
+ *
+ *  @return signature, e.g. 1001x1001:uniform:dddd:5pt:1t (faces north, west, south, east).
+ ************************************************************************************************************************/
+std::string signature(const Mesh::gridStruct &grid, const Mesh::boundaryStruct &boundaries, Mesh::stencilType stencil, u32 threads);
+
+/**< Bytes of arena needed by the solver of a configuration of size n */
+u64 workspaceBytes(const configuration &config, u32 n);
+
+
+
+/************************************************************************************************************************
+ *  @brief Solves Au = b with the solver (and preconditioner) of a configuration.
+ *
+ *  @param config   reference to the configuration.
+ *  @param A        reference to the sparse matrix of the system Au = b.
+ *  @param u        reference to the solution vector of the system Au = b, holds the initial guess on entry.
+ *  @param b        reference to the forcing vector of the system Au = b.
+ *  @param criteria reference to the convergence criteria, ignored by the direct solver.
+ *  @param work     reference to the arena the solver maps its vectors into, at least workspaceBytes(config, n) free.
+ *  @param op       matrix-free operator of A (see Mesh::makeOperator) used for the products of CG, nullptr to use A.
+ *  @param profiler profiler counting the kernels of CG (see Profiling::profiler), nullptr for none.
+ *  @param problem  discretization A was assembled from, giving Chebyshev iteration (and the Chebyshev preconditioner)
+ *                  the exact spectrum of A (see Preconditioner::analyticBounds), nullptr if unknown.
+ *
+ *  @return report of the solve, the direct solver reports a single iteration (diverged if the factorisation failed), as
+ *          does Chebyshev iteration (without any) when the spectrum of A is not known.
+ *
+ *  @details
+ *  A configuration with an ordering renumbers the system internally only: the incomplete Cholesky factor, or the sparse
+ *  LU factorisation, works on P A P^T, while u, b and the operator stay in the numbering they were assembled in. The
+ *  sparse LU of the natural ordering picks its own column ordering (COLAMD), the one of nested dissection keeps it.
+ ************************************************************************************************************************/
+KrylovSolver::solveReport solve(const configuration &config,
+                                Eigen::SparseMatrix<f64> &A,
+                                EigenDefs::Vector<f64> &u,
+                                EigenDefs::Vector<f64> &b,
+                                const KrylovSolver::convergenceCriteria &criteria,
+                                Workspace::arena &work,
+                                const Mesh::linearOperator* op = nullptr,
+                                Profiling::profiler* profiler = nullptr,
+                                const Mesh::discretizationStruct* problem = nullptr);
+
+
+
+/************************************************************************************************************************
+ *  @brief Picks the solver of a problem from the database, or by timing trial runs when the database has no entry.
+ *
+ *  @details
+ *  The database is a text file, one line per signature: the signature, the name of the winning configuration, and
+ *  its estimated solve time in seconds. It is read at construction, and rewritten whenever a winner is recorded. Lines
+ *  that do not parse are ignored, hence a stale or hand-edited database never stops a run; deleting a line (or the
+ *  file) makes the next run tune that signature again.
+ *
+ *  A trial starts from u = 0 and runs a fixed number of iterations. Its time, including the setup of the preconditioner,
+ *  is extrapolated to the tolerance of the criteria from the residual reduction it achieved, assuming the reduction
+ *  per second stays the same. A sparse LU trial is the full factorisation and solve, and is only run below a size limit.
+ *  Deflated CG only pays off over a sequence of solves with the same A, a single trial does not show that.
+ ************************************************************************************************************************/
+class autotuner{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction reads the database (if it exists), trials run on the threads of the policy */
+        autotuner(const std::string &fileName = "autotune.db",
+                  const Parallel::executionPolicy* policy = nullptr,
+                  const trialSettings &settings = trialSettings{});
+
+        /**< Disabled construction using another autotuner */
+        autotuner(const autotuner&) = delete;
+
+        /**< Disabled construction by equating to another autotuner */
+        autotuner& operator =(const autotuner&) = delete;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Returns the configuration stored for a signature, or tunes it (and stores the winner) if there is none.
+         *
+         *  @param key      signature of the problem, see signature().
+         *  @param A        reference to the sparse matrix of the system Au = b.
+         *  @param b        reference to the forcing vector of the system Au = b.
+         *  @param criteria reference to the convergence criteria of the real solve, the trials extrapolate to them.
+         *  @param singular whether A is singular (pure Neumann/periodic), which rules out the direct solver.
+         *  @param op       matrix-free operator of A the CG trials multiply with, nullptr to use A.
+         *  @param problem  discretization A was assembled from, Chebyshev iteration is only tried when it gives the
+         *                  spectrum of A, nullptr if unknown.
+         *
+         *  @return configuration to solve with.
+         ************************************************************************************************************************/
+        configuration select(const std::string &key,
+                             Eigen::SparseMatrix<f64> &A,
+                             EigenDefs::Vector<f64> &b,
+                             const KrylovSolver::convergenceCriteria &criteria,
+                             bool singular,
+                             const Mesh::linearOperator* op = nullptr,
+                             const Mesh::discretizationStruct* problem = nullptr);
+
+        /**< Looks a signature up in the database, returns false if it has no entry */
+        bool lookup(const std::string &key, configuration &config) const;
+
+        /**< Stores the winner of a signature, and rewrites the database */
+        void record(const std::string &key, const configuration &config, f64 seconds);
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        /**< Simplistic structure holding one database entry */
+        struct entry{
+            configuration config;
+            f64 seconds;
+        };
+
+        f64 trial(const configuration &config,
+                  Eigen::SparseMatrix<f64> &A,
+                  EigenDefs::Vector<f64> &b,
+                  const KrylovSolver::convergenceCriteria &criteria,
+                  const Mesh::linearOperator* op,
+                  const Mesh::discretizationStruct* problem) const;
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        std::string fileName;                      /**< database file */
+        const Parallel::executionPolicy* policy;   /**< threads of the trial runs, nullptr: serial */
+        trialSettings settings;                    /**< trial iterations and size limit of the direct solver */
+        std::map<std::string, entry> entries;      /**< database, by signature */
+
+};
+
+} // namespace Autotune
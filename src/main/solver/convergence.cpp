@@ -0,0 +1,117 @@
+#include "CoreIncludes.hpp"
+#include "convergence.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace KrylovSolver{
+
+f64 discretizationTolerance(const Mesh::gridStruct &grid,
+                            const Mesh::boundaryStruct &boundaries,
+                            const Mesh::sourceFunction &source,
+                            f64 safety,
+                            Mesh::stencilType stencil){
+
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    const EigenDefs::Array1D<f64> &x = grid.x;
+    const EigenDefs::Array1D<f64> &y = grid.y;
+
+    // Largest grid spacing, and lowest mode of the domain
+    f64 h = 0.;
+    for (u32 i=1; i<imax; i++) h = std::max(h, x[i] - x[i-1]);
+    for (u32 j=1; j<jmax; j++) h = std::max(h, y[j] - y[j-1]);
+    const f64 k = EIGEN_PI / std::min(x[imax-1] - x[0], y[jmax-1] - y[0]);
+
+    // |f| and |lap(f)| (non-uniform 3-point differences) over the grid
+    EigenDefs::Array2D<f64> f(jmax, imax);
+    for (u32 j=0; j<jmax; j++){
+        for (u32 i=0; i<imax; i++) f(j,i) = source(x[i], y[j]);
+    }
+    f64 maxF    = f.abs().maxCoeff();
+    f64 maxLapF = 0.;
+    for (u32 j=1; j<jmax-1; j++){
+        for (u32 i=1; i<imax-1; i++){
+            f64 dx1 = x[i] - x[i-1], dx2 = x[i+1] - x[i];
+            f64 dy1 = y[j] - y[j-1], dy2 = y[j+1] - y[j];
+            f64 fxx = 2.*( dx1*f(j,i+1) - (dx1+dx2)*f(j,i) + dx2*f(j,i-1) )/( dx1*dx2*(dx1+dx2) );
+            f64 fyy = 2.*( dy1*f(j+1,i) - (dy1+dy2)*f(j,i) + dy2*f(j-1,i) )/( dy1*dy2*(dy1+dy2) );
+            maxLapF = std::max(maxLapF, std::abs(fxx + fyy));
+        }
+    }
+
+    // Boundary data, values (Dirichlet) scale with k^4, fluxes (Neumann/Robin) with k^3
+    f64 boundaryScale = 0.;
+    const Mesh::faceCondition*     face[4]  = {&boundaries.NorthBC, &boundaries.WestBC, &boundaries.SouthBC, &boundaries.EastBC};
+    const EigenDefs::Array1D<f64>* value[4] = {&boundaries.North,   &boundaries.West,   &boundaries.South,   &boundaries.East};
+    for (u32 d=0; d<4; d++){
+        if (face[d]->type == Mesh::BC_PERIODIC || value[d]->size() == 0) continue;
+        f64 g = value[d]->abs().maxCoeff();
+        boundaryScale = std::max(boundaryScale, face[d]->type == Mesh::BC_DIRICHLET ? k*k*k*k*g : k*k*k*g);
+    }
+
+    const f64 fourth = std::max({maxLapF, k*k*maxF, boundaryScale}); /**< estimate of the fourth derivatives of u */
+    const f64 tau    = stencil == Mesh::STENCIL_MEHRSTELLEN ? h*h*h*h/90. * k*k*fourth : h*h/12. * fourth;
+    DEBUG_MSG("Truncation error estimate = %1.4e (h = %1.4e)", tau, h);
+    return safety*tau;
+}
+
+convergenceMonitor::convergenceMonitor(const convergenceCriteria &criteria)
+    : criteria(criteria), tol(criteria.absolute), best(std::numeric_limits<f64>::infinity()), mark(std::numeric_limits<f64>::infinity()), markIter(0), replaced(0) {}
+
+convergenceStatus convergenceMonitor::start(f64 r0, f64 b){
+    tol      = std::max({criteria.absolute, criteria.relative*b, criteria.discretization});
+    best     = r0;
+    mark     = r0;
+    markIter = 0;
+    replaced = 0;
+    return tol > r0 ? SOLVE_CONVERGED : SOLVE_RUNNING;
+}
+
+convergenceStatus convergenceMonitor::check(u32 iter, f64 err){
+    if (tol > err) return SOLVE_CONVERGED;
+    return progress(iter, err);
+}
+
+convergenceStatus convergenceMonitor::confirm(u32 iter, f64 err){
+    if (tol > err) return SOLVE_CONVERGED;
+    DEBUG_MSG("True residual %1.4e above tolerance %1.4e at iter = %u, continuing", err, tol, iter);
+
+    // The recursive residual drifts below the true one, hence the true one is not tested for divergence against the
+    // best recursive one. The solver goes on from the true residual, the next ones are measured against it instead. A
+    // true residual that no longer improves leaves mark behind, and ends the solve as stagnated
+    best = err;
+    return stagnation(iter, err);
+}
+
+bool convergenceMonitor::replace(u32 iter){
+    if (criteria.replacement == 0 || iter - replaced < criteria.replacement) return false;
+    replaced = iter;
+    return true;
+}
+
+convergenceStatus convergenceMonitor::progress(u32 iter, f64 err){
+
+    if (criteria.divergenceFactor > 0. && err > criteria.divergenceFactor*best) {
+        WARN_MSG("Solve diverged at iter = %u, err = %1.4e (best = %1.4e)", iter, err, best);
+        return SOLVE_DIVERGED;
+    }
+
+    best = std::min(best, err);
+    return stagnation(iter, err);
+}
+
+convergenceStatus convergenceMonitor::stagnation(u32 iter, f64 err){
+
+    // Stagnation: the best residual needs to improve by 1% every stagnationWindow iterations
+    if (best < 0.99*mark) { mark = best; markIter = iter; }
+    if (criteria.stagnationWindow > 0 && iter - markIter >= criteria.stagnationWindow) {
+        WARN_MSG("Solve stagnated at iter = %u, err = %1.4e", iter, err);
+        return SOLVE_STAGNATED;
+    }
+
+    if (iter >= criteria.maxiter) return SOLVE_MAXITER;
+    return SOLVE_RUNNING;
+}
+
+} // end KrylovSolver
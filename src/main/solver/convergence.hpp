@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/assembly.hpp"
+
+namespace KrylovSolver{
+
+/**< Simplistic structure holding when a solve should stop, every tolerance is on the RMS residual sqrt(r.r/n) */
+struct convergenceCriteria{
+    f64 absolute          = 1e-15;  /**< absolute tolerance */
+    f64 relative          = 0.;     /**< tolerance relative to the RMS of b, 0 disables it */
+    f64 discretization    = 0.;     /**< tolerance at which the algebraic error drowns in the truncation error, 0 disables it */
+    u32 maxiter           = 5000;   /**< iteration cap */
+    u32 stagnationWindow  = 200;    /**< iterations without a 1% improvement of the best residual that count as stagnation, 0 disables it */
+    f64 divergenceFactor  = 1e4;    /**< growth over the best residual that counts as divergence, 0 disables it */
+    u32 replacement       = 0;      /**< replace the recursive residual by the true one every this many iterations, 0 disables it */
+};
+
+/************************************************************************************************************************
+ *  @brief Estimates the residual below which iterating further no longer improves the solution of the continuous problem.
+ *
+ *  @details
+ *  The 5-point stencil has a truncation error tau = -h^2/12 (u_xxxx + u_yyyy). Since -lap(u) = f, the fourth derivatives
+ *  are estimated from the discrete Laplacian of f, and, where f is (nearly) harmonic, from the lowest mode the domain
+ *  supports, k = pi/min(Lx,Ly), acting on f (k^2 |f|) and on the boundary values (k^4 |g|). The returned tolerance is
+ *  a fraction (safety) of the largest of these estimates. The Mehrstellen stencil has a truncation error of order 
+ *  h^4/90 times the sixth derivatives of u, estimated as k^2 times the fourth ones. It is a heuristic: it is meant to 
+ *  stop the solve once the algebraic error is well below the discretization error, not to bound the discretization error.
+ *
+ *  @param grid       reference to the gridpoints.
+ *  @param boundaries reference to the boundary values.
+ *  @param source     value source f(x,y).
+ *  @param safety     fraction of the truncation error estimate, default 0.1.
+ *  @param stencil    discretization the system was assembled with, default the 5-point stencil.
+ *
+ *  @return RMS residual tolerance.
+ ************************************************************************************************************************/
+f64 discretizationTolerance(const Mesh::gridStruct &grid,
+                            const Mesh::boundaryStruct &boundaries,
+                            const Mesh::sourceFunction &source,
+                            f64 safety = 0.1,
+                            Mesh::stencilType stencil = Mesh::STENCIL_5POINT);
+
+
+
+/************************************************************************************************************************
+ *  @brief Decides, iteration by iteration, whether a Krylov solve should go on.
+ *
+ *  @details
+ *  The tolerance is the largest of the absolute, relative and discretization tolerances. Next to it, the monitor stops
+ *  a solve that stagnates (no 1% improvement of the best residual within a window of iterations) or diverges (residual
+ *  far above the best one). The residual the solvers track is a recursion, which drifts away from the true residual
+ *  b - Au in finite precision. Convergence is therefore only declared once the true residual is below the tolerance
+ *  as well (the solvers compute it and replace the recursive one when asked to, see replace). The true residual is
+ *  only tested for stagnation: once the recursion drifted below it, a plateau of it is not a divergence.
+ ************************************************************************************************************************/
+class convergenceMonitor{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction, taking the criteria to apply */
+        convergenceMonitor(const convergenceCriteria &criteria);
+
+
+
+        /************************************************************************************************************************
+         *  @brief Starts monitoring a solve.
+         *
+         *  @param r0 RMS of the initial residual.
+         *  @param b  RMS of the forcing vector.
+         *
+         *  @return SOLVE_CONVERGED if the initial residual already satisfies the tolerance, SOLVE_RUNNING otherwise.
+         ************************************************************************************************************************/
+        convergenceStatus start(f64 r0, f64 b);
+
+        /************************************************************************************************************************
+         *  @brief Checks a new (recursive) residual.
+         *
+         *  @param iter number of iterations done.
+         *  @param err  RMS of the residual.
+         *
+         *  @return status of the solve, SOLVE_CONVERGED still needs to be confirmed on the true residual.
+         ************************************************************************************************************************/
+        convergenceStatus check(u32 iter, f64 err);
+
+        /************************************************************************************************************************
+         *  @brief Checks the true residual b - Au, after check returned SOLVE_CONVERGED or replace returned true.
+         *
+         *  @param iter number of iterations done.
+         *  @param err  RMS of the true residual.
+         *
+         *  @return status of the solve.
+         ************************************************************************************************************************/
+        convergenceStatus confirm(u32 iter, f64 err);
+
+        /**< Whether the solver should compute the true residual (and continue with it) at this iteration */
+        bool replace(u32 iter);
+
+        /**< Tolerance in use */
+        f64 tolerance() const { return tol; }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        convergenceStatus progress(u32 iter, f64 err);
+        convergenceStatus stagnation(u32 iter, f64 err);
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        convergenceCriteria criteria;   /**< criteria to apply */
+        f64 tol;                        /**< tolerance in use, the largest of the absolute/relative/discretization ones */
+        f64 best;                       /**< smallest residual seen */
+        f64 mark;                       /**< residual the stagnation window is measured against */
+        u32 markIter;                   /**< iteration at which mark was set */
+        u32 replaced;                   /**< iteration at which the residual was last replaced */
+
+};
+
+} // end KrylovSolver
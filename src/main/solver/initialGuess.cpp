@@ -0,0 +1,171 @@
+#include "CoreIncludes.hpp"
+#include "core/signature.hpp"
+#include "initialGuess.hpp"
+#include "mesh/assembly.hpp"
+#include "mesh/boundary.hpp"
+
+#include "Eigen/QR"
+
+#include <algorithm>
+
+namespace InitialGuess{
+
+problemSignature signature(const Mesh::gridStruct &grid, const EigenDefs::Vector<f64> &b){
+
+    u64 gridHash = hashBytes(grid.x.data(), grid.x.size()*sizeof(f64));
+    gridHash     = hashBytes(grid.y.data(), grid.y.size()*sizeof(f64), gridHash);
+
+    u64 problemHash = hashBytes(b.data(), b.size()*sizeof(f64));
+
+    return problemSignature{gridHash, problemHash};
+}
+
+solutionCache::solutionCache(u32 depth) : depth(depth) {
+    CHECK_FATAL_ASSERT(depth > 0, "Solution cache needs to hold at least one solution per grid.")
+}
+
+guessType solutionCache::fill(guessType type,
+                              const problemSignature &signature,
+                              const Mesh::gridStruct &grid,
+                              const Mesh::boundaryStruct &boundaries,
+                              const Eigen::SparseMatrix<f64> &A,
+                              const EigenDefs::Vector<f64> &b,
+                              EigenDefs::Vector<f64> &u) const{
+
+    u.resize(A.cols());
+
+    // Try the requested guess, and fall back to cheaper ones if the cache cannot provide it
+    switch (type){
+        case GUESS_PROJECTED: if (fillProjected(signature, boundaries, A, b, u))  return GUESS_PROJECTED; [[fallthrough]];
+        case GUESS_PREVIOUS:  if (fillPrevious(signature, boundaries, u))       return GUESS_PREVIOUS;  [[fallthrough]];
+        case GUESS_COARSE:    if (fillCoarse(signature, grid, boundaries, u))   return GUESS_COARSE;    [[fallthrough]];
+        case GUESS_ZERO:      break;
+    }
+
+    u.setZero();
+    return GUESS_ZERO;
+}
+
+void solutionCache::store(const problemSignature &signature,
+                          const Mesh::gridStruct &grid,
+                          const Mesh::boundaryStruct &boundaries,
+                          const EigenDefs::Vector<f64> &u){
+
+    // Full-grid solution, same layout as the exported solution
+    EigenDefs::Array2D<f64> field;
+    Mesh::scatterSolution(grid, boundaries, u, field);
+
+    entry &hist = entries[signature.grid];
+    if (hist.fields.empty()) hist.grid = grid;
+
+    // The same problem solved again replaces its older solution rather than duplicating it
+    for (u32 k=0; k<hist.problems.size(); k++){
+        if (hist.problems[k] == signature.problem){
+            hist.problems.erase(hist.problems.begin() + k);
+            hist.fields.erase(hist.fields.begin() + k);
+            break;
+        }
+    }
+
+    hist.problems.push_front(signature.problem);
+    hist.fields.push_front(std::move(field));
+    if (hist.fields.size() > depth){
+        hist.problems.pop_back();
+        hist.fields.pop_back();
+    }
+}
+
+void solutionCache::clear(){
+    entries.clear();
+}
+
+bool solutionCache::fillPrevious(const problemSignature &signature, const Mesh::boundaryStruct &boundaries, 
+                                 EigenDefs::Vector<f64> &u) const{
+
+    auto found = entries.find(signature.grid);
+    if (found == entries.end()) return false;
+    const entry &hist = found->second;
+
+    // Prefer the solution of the exact same problem, else the newest one
+    u32 k = 0;
+    for (u32 kk=0; kk<hist.problems.size(); kk++){
+        if (hist.problems[kk] == signature.problem) { k = kk; break; }
+    }
+
+    Mesh::gatherSolution(hist.grid, boundaries, hist.fields[k], u);
+    return true;
+}
+
+bool solutionCache::fillCoarse(const problemSignature &signature, const Mesh::gridStruct &grid, 
+                               const Mesh::boundaryStruct &boundaries, EigenDefs::Vector<f64> &u) const{
+
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    const f64 eps  = 1e-12*std::max( grid.x[imax-1]-grid.x[0], grid.y[jmax-1]-grid.y[0] );
+
+    // Pick the finest stored grid spanning the same domain
+    const entry *source = nullptr;
+    for (const auto &[gridHash, hist] : entries){
+        if (gridHash == signature.grid) continue;
+        const EigenDefs::Array1D<f64> &xs = hist.grid.x;
+        const EigenDefs::Array1D<f64> &ys = hist.grid.y;
+        if (std::abs(xs[0] - grid.x[0]) > eps || std::abs(xs[xs.size()-1] - grid.x[imax-1]) > eps) continue;
+        if (std::abs(ys[0] - grid.y[0]) > eps || std::abs(ys[ys.size()-1] - grid.y[jmax-1]) > eps) continue;
+        if (source == nullptr || xs.size()*ys.size() > source->grid.x.size()*source->grid.y.size()) source = &hist;
+    }
+    if (source == nullptr) return false;
+
+    // Bilinear interpolation of the newest solution on that grid, works for non-uniform grids too
+    const EigenDefs::Array1D<f64> &xs = source->grid.x;
+    const EigenDefs::Array1D<f64> &ys = source->grid.y;
+    const EigenDefs::Array2D<f64> &field = source->fields.front();
+
+    // Locates the interval [s[k], s[k+1]] holding p, and the weight of s[k+1]
+    auto locate = [](const EigenDefs::Array1D<f64> &s, f64 p, u32 &k, f64 &w){
+        const f64* pos = std::upper_bound(s.data(), s.data()+s.size(), p);
+        i64 kk = (pos - s.data()) - 1;
+        k = (u32) std::clamp<i64>(kk, 0, s.size()-2);
+        w = std::clamp( (p - s[k])/(s[k+1] - s[k]), 0., 1. );
+    };
+
+    EigenDefs::Array2D<f64> interpolated(jmax, imax);
+    for (u32 j=0; j<jmax; j++){
+        u32 js; f64 wy;
+        locate(ys, grid.y[j], js, wy);
+        for (u32 i=0; i<imax; i++){
+            u32 is; f64 wx;
+            locate(xs, grid.x[i], is, wx);
+            interpolated(j,i) = (1.-wy)*( (1.-wx)*field(js  ,is) + wx*field(js  ,is+1) )
+                              +     wy *( (1.-wx)*field(js+1,is) + wx*field(js+1,is+1) );
+        }
+    }
+    Mesh::gatherSolution(grid, boundaries, interpolated, u);
+    return true;
+}
+
+bool solutionCache::fillProjected(const problemSignature &signature, const Mesh::boundaryStruct &boundaries, 
+                                  const Eigen::SparseMatrix<f64> &A, const EigenDefs::Vector<f64> &b, 
+                                  EigenDefs::Vector<f64> &u) const{
+
+    auto found = entries.find(signature.grid);
+    if (found == entries.end()) return false;
+    const entry &hist = found->second;
+    if (hist.fields.size() < 2) return false; // a single vector is no better than the previous solution
+
+    // Gather the unknowns of the previous solutions as the columns of W
+    const u32 k = hist.fields.size();
+    EigenDefs::Matrix<f64> W(A.cols(), k);
+    EigenDefs::Vector<f64> w;
+    for (u32 c=0; c<k; c++){
+        Mesh::gatherSolution(hist.grid, boundaries, hist.fields[c], w);
+        W.col(c) = w;
+    }
+
+    // Minimise ||b - A W y||, rank-revealing since previous solutions can be (nearly) linearly dependent
+    EigenDefs::Matrix<f64> AW = A*W;
+    EigenDefs::Vector<f64> y  = AW.colPivHouseholderQr().solve(b);
+    u.noalias() = W*y;
+    return true;
+}
+
+} // end InitialGuess
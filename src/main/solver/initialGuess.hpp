@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh/mesh.hpp"
+
+#include <deque>
+#include <unordered_map>
+
+/************************************************************************************************************************
+ *  @brief Everything related to picking the starting vector u0 of an iterative solve is stored in this namespace.
+ *
+ *  @details
+ *  Krylov solvers only ever correct u0, so the closer u0 is to u*, the fewer iterations are needed. In parameter sweeps
+ *  and time-stepping, consecutive problems are nearly identical, so the previous solution (or a combination of previous
+ *  solutions) is a far better u0 than zero. The options are:
+ *    - zero:      u0 = 0, always available.
+ *    - previous:  u0 = the last solution computed on the same grid (the exact one, if the same problem was solved).
+ *    - coarse:    u0 = bilinear interpolation of a solution computed on a different grid spanning the same domain.
+ *    - projected: u0 = W y, where the columns of W are the previous solutions on the same grid, and y minimises
+ *                 ||b - A W y||. This is a projection onto the subspace recycled from previous solves (see Fischer 1998,
+ *                 "Projection techniques for iterative solution of Ax = b with successive right-hand sides").
+ ************************************************************************************************************************/
+namespace InitialGuess{
+
+/* list of initial guess types */
+typedef enum guessType{
+    GUESS_ZERO      = 0, /**< u0 = 0 */
+    GUESS_PREVIOUS  = 1, /**< u0 = last solution on the same grid */
+    GUESS_COARSE    = 2, /**< u0 = interpolated solution from another grid on the same domain */
+    GUESS_PROJECTED = 3, /**< u0 = residual-minimising combination of previous solutions on the same grid */
+} guessType;
+
+/**< Simplistic structure identifying a problem: which grid it lives on, and which system is solved on that grid */
+struct problemSignature{
+    u64 grid;    /**< hash of the gridpoints */
+    u64 problem; /**< hash of the forcing vector b, which holds both the source term and the lifted boundary values */
+};
+
+/************************************************************************************************************************
+ *  @brief Computes the signature of the system Au = b on a given grid.
+ *
+ *  @param grid reference to the grid the system is assembled on.
+ *  @param b    reference to the forcing vector of the system Au = b.
+ *
+ *  @return signature of the problem.
+ ************************************************************************************************************************/
+problemSignature signature(const Mesh::gridStruct &grid, const EigenDefs::Vector<f64> &b);
+
+
+
+/************************************************************************************************************************
+ *  @brief In-process cache of previous solutions, keyed by grid signature, used to build initial guesses.
+ *
+ *  @details
+ *  Every grid keeps a short history (newest first) of full-grid solutions, i.e. including the boundary values, so that
+ *  they can be interpolated onto other grids as well. The history depth bounds the memory used per grid.
+ ************************************************************************************************************************/
+class solutionCache{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction, keeping at most depth solutions per grid */
+        solutionCache(u32 depth = 4);
+
+        /**< Disabled construction using another cache */
+        solutionCache(const solutionCache&) = delete;
+
+        /**< Disabled construction by equating to another cache */
+        solutionCache& operator =(const solutionCache&) = delete;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Fills u with an initial guess of the requested type. Falls back to a cheaper type when the cache does not
+         *         hold what is required (projected -> previous -> coarse -> zero).
+         *
+         *  @param type      requested type of initial guess.
+         *  @param signature reference to the signature of the problem about to be solved.
+         *  @param grid       reference to the grid the problem is assembled on.
+         *  @param boundaries reference to the boundary conditions, which decide the unknowns of the grid.
+         *  @param A         reference to the sparse matrix of the system Au = b.
+         *  @param b         reference to the forcing vector of the system Au = b.
+         *  @param u         reference to the solution vector, resized and overwritten.
+         *
+         *  @return type of initial guess that was actually used.
+         ************************************************************************************************************************/
+        guessType fill(guessType type,
+                       const problemSignature &signature,
+                       const Mesh::gridStruct &grid,
+                       const Mesh::boundaryStruct &boundaries,
+                       const Eigen::SparseMatrix<f64> &A,
+                       const EigenDefs::Vector<f64> &b,
+                       EigenDefs::Vector<f64> &u) const;
+
+
+
+        /************************************************************************************************************************
+         *  @brief Stores a converged solution in the cache.
+         *
+         *  @param signature  reference to the signature of the solved problem.
+         *  @param grid       reference to the grid the problem is assembled on.
+         *  @param boundaries reference to the boundary values the problem was solved with.
+         *  @param u          reference to the solution vector of the unknowns.
+         *
+         *  @return None
+         ************************************************************************************************************************/
+        void store(const problemSignature &signature,
+                   const Mesh::gridStruct &grid,
+                   const Mesh::boundaryStruct &boundaries,
+                   const EigenDefs::Vector<f64> &u);
+
+        /**< Removes all stored solutions */
+        void clear();
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        bool fillPrevious (const problemSignature &signature, const Mesh::boundaryStruct &boundaries, 
+                           EigenDefs::Vector<f64> &u) const;
+        bool fillCoarse   (const problemSignature &signature, const Mesh::gridStruct &grid, 
+                           const Mesh::boundaryStruct &boundaries, EigenDefs::Vector<f64> &u) const;
+        bool fillProjected(const problemSignature &signature, const Mesh::boundaryStruct &boundaries, 
+                           const Eigen::SparseMatrix<f64> &A, const EigenDefs::Vector<f64> &b, EigenDefs::Vector<f64> &u) const;
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        /**< Simplistic structure holding the solution history of one grid */
+        struct entry{
+            Mesh::gridStruct grid;                       /**< copy of the gridpoints, used for interpolation */
+            std::deque<u64> problems;                    /**< problem hashes, newest first */
+            std::deque< EigenDefs::Array2D<f64> > fields; /**< full-grid solutions u(j,i), newest first */
+        };
+
+        u32 depth;                                  /**< max number of solutions stored per grid */
+        std::unordered_map<u64, entry> entries;     /**< history per grid signature */
+
+};
+
+} // end InitialGuess
@@ -0,0 +1,87 @@
+#include "CoreIncludes.hpp"
+#include "lanczos.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace KrylovSolver{
+
+void lanczosTridiagonal::reset(u32 steps){
+    diagonal.clear();
+    offSquared.clear();
+    diagonal.reserve(steps);
+    offSquared.reserve(steps);
+    alphaPrev = 0.;
+    betaPrev  = 0.;
+    valid     = true;
+}
+
+void lanczosTridiagonal::recordAlpha(f64 alpha){
+    valid = valid && std::isfinite(alpha) && alpha > 0.;
+    if (diagonal.empty()){
+        diagonal.push_back(1./alpha);
+        offSquared.push_back(0.);
+    } else {
+        diagonal.push_back(1./alpha + betaPrev/alphaPrev);
+        offSquared.push_back(betaPrev/(alphaPrev*alphaPrev));
+    }
+    alphaPrev = alpha;
+}
+
+void lanczosTridiagonal::recordBeta(f64 beta){
+    valid    = valid && std::isfinite(beta) && beta >= 0.;
+    betaPrev = beta;
+}
+
+u32 lanczosTridiagonal::below(f64 x) const {
+
+    // Negative pivots of the LDL^T factorisation of T - x I, i.e. eigenvalues of T below x (Sylvester's law of inertia)
+    const f64 tiny = 1e-300;
+    u32 count = 0;
+    f64 pivot = 1.;
+    for (u32 j=0; j<diagonal.size(); j++){
+        pivot = diagonal[j] - x - (j > 0 ? offSquared[j]/pivot : 0.);
+        if (std::abs(pivot) < tiny) pivot = -tiny;
+        if (pivot < 0.) count++;
+    }
+    return count;
+}
+
+spectrumEstimate lanczosTridiagonal::estimate(f64 tol) const {
+
+    spectrumEstimate spectrum;
+    const u32 k = diagonal.size();
+    if (k == 0 || !valid) return spectrum;
+
+    // Gershgorin interval holding every eigenvalue
+    f64 lo =  1./0., hi = -1./0.;
+    for (u32 j=0; j<k; j++){
+        const f64 radius = (j > 0 ? std::sqrt(offSquared[j]) : 0.) + (j+1 < k ? std::sqrt(offSquared[j+1]) : 0.);
+        lo = std::min(lo, diagonal[j] - radius);
+        hi = std::max(hi, diagonal[j] + radius);
+    }
+
+    // Bisection on the Sturm counts, for the smallest (count reaching 1) and the largest (count reaching k) eigenvalue
+    auto bisect = [&](u32 target){
+        f64 a = lo, b = hi;
+        while (b - a > tol*std::max(std::abs(a), std::abs(b))){
+            const f64 mid = 0.5*(a + b);
+            if (mid <= a || mid >= b) break;
+            if (below(mid) >= target) b = mid;
+            else                      a = mid;
+        }
+        return 0.5*(a + b);
+    };
+    spectrum.steps     = k;
+    spectrum.lambdaMin = bisect(1);
+    spectrum.lambdaMax = bisect(k);
+    return spectrum;
+}
+
+u32 predictIterations(const spectrumEstimate &spectrum, f64 reduction){
+    const f64 condition = spectrum.condition();
+    if (condition <= 0. || !(reduction > 0.) || reduction >= 1.) return 0;
+    return (u32) std::ceil( 0.5*std::sqrt(condition)*std::log(2./reduction) );
+}
+
+} // end KrylovSolver
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "solveReport.hpp"
+
+#include <vector>
+
+namespace KrylovSolver{
+
+/************************************************************************************************************************
+ *  @brief The Lanczos tridiagonal matrix hidden in the coefficients of CG, and the extreme eigenvalues it estimates.
+ *
+ *  @details
+ *  CG is the Lanczos process in disguise: its normalised residuals are the Lanczos vectors of the (preconditioned)
+ *  operator M^-1 A, and the tridiagonal matrix T_k = V_k^T A V_k of that process is spelled out by the step lengths
+ *  alpha_j and direction updates beta_j CG computes anyway:
+ *    T(j,j)   = 1/alpha_j + beta_{j-1}/alpha_{j-1}        (the second term dropped for j = 0)
+ *    T(j-1,j) = T(j,j-1) = -sqrt(beta_{j-1})/alpha_{j-1}
+ *  The eigenvalues of T_k (Ritz values) approach those of M^-1 A, the extreme ones first: after a few tens of
+ *  iterations, the largest and smallest Ritz values estimate lambdaMax (from below) and lambdaMin (from above). They
+ *  are found by bisection on Sturm sequence counts, O(k) per count and without any allocation, hence estimating them
+ *  costs a few hundred k flops, next to the k sparse products the k iterations took.
+ *
+ *  Residual replacement (see convergenceMonitor::replace) perturbs the recursion slightly, and in finite precision
+ *  the Ritz values of a long run come back as duplicates ("ghosts"); neither moves the extreme estimates noticeably.
+ *
+ *  * see Section 6.7.3 of "Iterative Methods for Sparse Linear Systems" by Yousef Saad 2003
+ *  * see Section 8.5 of "Matrix Computations" by Golub, Van Loan 2013
+ ************************************************************************************************************************/
+class lanczosTridiagonal{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction, empty */
+        lanczosTridiagonal() = default;
+
+        /**< Disabled construction using another tridiagonal matrix */
+        lanczosTridiagonal(const lanczosTridiagonal&) = delete;
+
+        /**< Disabled construction by equating to another tridiagonal matrix */
+        lanczosTridiagonal& operator =(const lanczosTridiagonal&) = delete;
+
+        /**< Empties the matrix and makes room for steps iterations, such that recording them does not allocate */
+        void reset(u32 steps);
+
+        /**< Records the step length alpha_j of iteration j */
+        void recordAlpha(f64 alpha);
+
+        /**< Records the direction update beta_j of iteration j (computed after alpha_j) */
+        void recordBeta(f64 beta);
+
+        /**< Number of rows of T, the iterations recorded */
+        u32 size() const { return diagonal.size(); }
+
+
+
+        /************************************************************************************************************************
+         *  @brief Computes the extreme eigenvalues of T, i.e. the estimates of those of the operator CG ran on.
+         *
+         *  @param tol relative accuracy of the bisection, default 1e-10 (the estimates themselves are much rougher).
+         *
+         *  @return the estimates, with steps = 0 if nothing was recorded or a coefficient was not that of an SPD operator.
+         ************************************************************************************************************************/
+        spectrumEstimate estimate(f64 tol = 1e-10) const;
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        u32 below(f64 x) const;
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        std::vector<f64> diagonal;   /**< T(j,j) */
+        std::vector<f64> offSquared; /**< T(j-1,j)^2, offSquared[0] unused (0) */
+        f64 alphaPrev = 0.;          /**< alpha_{j-1} */
+        f64 betaPrev  = 0.;          /**< beta_{j-1} */
+        bool valid    = true;        /**< every coefficient was finite and positive */
+
+};
+
+
+
+/************************************************************************************************************************
+ *  @brief Predicts the CG iterations a residual reduction takes, from the condition number of the operator.
+ *
+ *  @details
+ *  The classic bound ||e_k||_A <= 2 ((sqrt(K)-1)/(sqrt(K)+1))^k ||e_0||_A gives k = ceil(sqrt(K)/2 ln(2/reduction)).
+ *  It is an upper bound: CG usually converges faster on operators whose spectrum is not spread evenly.
+ *
+ *  @param spectrum  reference to the eigenvalue estimates, see lanczosTridiagonal::estimate.
+ *  @param reduction residual reduction to reach, in (0,1).
+ *
+ *  @return predicted number of iterations, 0 if the spectrum holds no estimate.
+ ************************************************************************************************************************/
+u32 predictIterations(const spectrumEstimate &spectrum, f64 reduction);
+
+} // end KrylovSolver
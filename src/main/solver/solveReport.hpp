@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+
+namespace KrylovSolver{
+
+/* list of ways a solve can end */
+typedef enum convergenceStatus{
+    SOLVE_RUNNING   = 0, /**< not terminated (yet) */
+    SOLVE_CONVERGED = 1, /**< the (true) residual is below the tolerance */
+    SOLVE_MAXITER   = 2, /**< the iteration cap was hit first */
+    SOLVE_STAGNATED = 3, /**< the residual stopped decreasing */
+    SOLVE_DIVERGED  = 4, /**< the residual grew far beyond the best one seen */
+} convergenceStatus;
+
+/**< Simplistic structure holding estimates of the extreme eigenvalues of the (preconditioned) operator of a solve */
+struct spectrumEstimate{
+    u32 steps     = 0;  /**< Lanczos steps the estimates come from, 0 if the solver does not estimate them */
+    f64 lambdaMin = 0.; /**< smallest eigenvalue, an upper bound converging from above */
+    f64 lambdaMax = 0.; /**< largest eigenvalue, a lower bound converging from below */
+
+    /**< Estimated condition number lambdaMax/lambdaMin, 0 if there is no estimate */
+    f64 condition() const { return steps > 0 && lambdaMin > 0. ? lambdaMax/lambdaMin : 0.; }
+};
+
+/**< Simplistic structure summarising how a solve went, returned by every Krylov solver */
+struct solveReport{
+    u32 iterations = 0;                        /**< number of iterations taken */
+    f64 residual   = 0.;                       /**< final RMS residual, sqrt(r.r/n) */
+    convergenceStatus status = SOLVE_CONVERGED; /**< why the solve ended */
+    spectrumEstimate  spectrum = {};            /**< eigenvalue estimates of the operator (CG only) */
+};
+
+/**< Name of a convergence status, for reporting */
+inline const char* statusName(convergenceStatus status){
+    static const char* names[5] = {"running", "converged", "maxiter", "stagnated", "diverged"};
+    return names[status];
+}
+
+} // end KrylovSolver
@@ -0,0 +1,129 @@
+#include "CoreIncludes.hpp"
+#include "heat.hpp"
+#include "mesh/boundary.hpp"
+
+namespace Transient{
+
+heatSolver::heatSolver(const Mesh::gridStruct &grid,
+                       const Mesh::boundaryStruct &boundaries,
+                       const Mesh::sourceFunction &source,
+                       const heatSettings &settings,
+                       const Parallel::executionPolicy* policy)
+    : grid(grid), boundaries(boundaries), settings(settings), policy(policy),
+      theta(settings.scheme == SCHEME_BACKWARD_EULER ? 1. : 0.5), t(0.), nSteps(0) {
+
+    CHECK_FATAL_ASSERT(settings.dt > 0., "The time step needs to be positive.")
+
+    // Assembled once, as for the steady problem
+    const Mesh::dofRectangle rect = Mesh::dofs(grid, boundaries);
+    const u32 n = rect.size();
+    EigenDefs::Vector<f64> b(n);
+    A.resize(n, n);
+    Mesh::assemblePoisson(grid, boundaries, source, A, b);
+    load = settings.dt*b;
+
+    // Row scaling S of the assembly: halved once per Neumann/Robin face the unknown lies on
+    const u32 imax = grid.x.size();
+    const u32 jmax = grid.y.size();
+    auto ghost = [](const Mesh::faceCondition &face){ return face.type == Mesh::BC_NEUMANN || face.type == Mesh::BC_ROBIN; };
+    mass.resize(n);
+    for (u32 j=rect.j0; j<=rect.j1; j++){
+        for (u32 i=rect.i0; i<=rect.i1; i++){
+            f64 scale = 1.;
+            if (i == 0      && ghost(boundaries.WestBC))  scale *= 0.5;
+            if (i == imax-1 && ghost(boundaries.EastBC))  scale *= 0.5;
+            if (j == 0      && ghost(boundaries.SouthBC)) scale *= 0.5;
+            if (j == jmax-1 && ghost(boundaries.NorthBC)) scale *= 0.5;
+            mass[rect.index(i,j)] = scale;
+        }
+    }
+    shift();
+    symmetric = Parallel::isSymmetric(A);
+
+    u.setZero(n);
+    previous.setZero(n);
+    next.setZero(n);
+    rhs.setZero(n);
+
+    // Solver of the steps, set up once for all of them
+    if (settings.solver == STEP_CHOLESKY){
+        cholesky = std::make_unique< Eigen::SimplicialLDLT<Eigen::SparseMatrix<f64>> >(A);
+        CHECK_FATAL_ASSERT(cholesky->info() == Eigen::Success, "Cholesky factorisation of the heat operator failed.")
+    } else {
+        work = std::make_unique<Workspace::arena>(KrylovSolver::CG::workspaceBytes(n), policy);
+        cg   = std::make_unique<KrylovSolver::CG>(A, *work);
+        if (settings.preconditioner != Preconditioner::PRECONDITIONER_NONE){
+            M = std::make_unique<Preconditioner::preconditioner>(A, settings.preconditioner, policy);
+            cg->precondition(M.get());
+        }
+    }
+    INFO_MSG("Heat solver: %u unknowns, dt = %1.4e, %s, %s", n, settings.dt,
+             settings.scheme == SCHEME_BACKWARD_EULER ? "backward Euler" : "Crank-Nicolson",
+             settings.solver == STEP_CHOLESKY ? "Cholesky" : "CG");
+}
+
+void heatSolver::shift(){
+
+    // A <- S + theta dt A, on the values of the assembled matrix (the pattern, holding every diagonal, is unchanged)
+    A.makeCompressed();
+    Eigen::Map<EigenDefs::Vector<f64>>(A.valuePtr(), A.nonZeros()) *= theta*settings.dt;
+    for (i32 k=0; k<A.outerSize(); k++){
+        bool found = false;
+        for (Eigen::SparseMatrix<f64>::InnerIterator it(A, k); it; ++it){
+            if (it.row() != k) continue;
+            it.valueRef() += mass[k];
+            found = true;
+        }
+        CHECK_FATAL_ASSERT(found, "The assembled matrix misses a diagonal entry.")
+    }
+}
+
+void heatSolver::initial(const Mesh::sourceFunction &u0, f64 t0){
+    const Mesh::dofRectangle rect = Mesh::dofs(grid, boundaries);
+    for (u32 j=rect.j0; j<=rect.j1; j++){
+        for (u32 i=rect.i0; i<=rect.i1; i++) u[rect.index(i,j)] = u0(grid.x[i], grid.y[j]);
+    }
+    previous = u;
+    t        = t0;
+    nSteps   = 0;
+}
+
+KrylovSolver::solveReport heatSolver::step(){
+
+    // Right-hand side S u - (1-theta) dt L u + dt b, with (1-theta) dt L u = c (A u - S u) and c = (1-theta)/theta
+    if (theta < 1.){
+        const f64 c = (1. - theta)/theta;
+        if (policy != nullptr && symmetric) policy->symmetricProduct(A, u.data(), rhs.data());
+        else                                rhs.noalias() = A*u;
+        rhs = (1. + c)*mass.cwiseProduct(u) - c*rhs + load;
+    } else {
+        rhs = mass.cwiseProduct(u) + load;
+    }
+
+    // Warm start from the linear extrapolation of the last two steps (u itself after the initial condition)
+    next = 2.*u - previous;
+
+    KrylovSolver::solveReport report;
+    if (cholesky != nullptr){
+        next = cholesky->solve(rhs);
+        report.iterations = 1;
+    } else {
+        report = cg->solve(next, rhs, settings.criteria);
+    }
+
+    // u^{n-1} <- u^n <- u^{n+1}, by swapping the buffers
+    previous.swap(u);
+    u.swap(next);
+    t += settings.dt;
+    nSteps++;
+    return report;
+}
+
+void heatSolver::snapshot(IO::asyncExport &exporter, const std::string &fileName) const{
+    std::vector<IO::namedField> fields(1);
+    fields[0].name = "u";
+    Mesh::scatterSolution(grid, boundaries, u, fields[0].values);
+    exporter.submit(fileName, grid, std::move(fields));
+}
+
+} // namespace Transient
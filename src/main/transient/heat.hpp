@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CoreIncludes.hpp"
+#include "mesh/mesh.hpp"
+#include "mesh/assembly.hpp"
+#include "core/arena.hpp"
+#include "core/parallel.hpp"
+#include "solver/CG.hpp"
+#include "preconditioner/preconditioners.hpp"
+#include "io/tiledFile.hpp"
+
+#include "Eigen/SparseCholesky"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/************************************************************************************************************************
+ *  @brief Time-dependent problems reusing the Poisson assembly as their implicit operator are represented in this namespace.
+ ************************************************************************************************************************/
+namespace Transient{
+
+/* list of time-stepping schemes */
+typedef enum timeScheme{
+    SCHEME_BACKWARD_EULER  = 0, /**< theta = 1, 1st order, L-stable */
+    SCHEME_CRANK_NICOLSON  = 1, /**< theta = 1/2, 2nd order, A-stable (stiff modes are damped slowly) */
+} timeScheme;
+
+/* list of the ways the implicit system of every step is solved */
+typedef enum stepSolver{
+    STEP_CG       = 0, /**< preconditioned CG, the preconditioner set up once */
+    STEP_CHOLESKY = 1, /**< sparse LDL^T (Eigen::SimplicialLDLT), factorised once, direct */
+} stepSolver;
+
+/**< Simplistic structure holding how the heat equation is stepped */
+struct heatSettings{
+    f64 dt = 1e-3;                                                                          /**< time step */
+    timeScheme scheme = SCHEME_CRANK_NICOLSON;                                              /**< time-stepping scheme */
+    stepSolver solver = STEP_CG;                                                            /**< solver of every step */
+    Preconditioner::preconditionerType preconditioner = Preconditioner::PRECONDITIONER_IC;  /**< STEP_CG: preconditioner */
+    KrylovSolver::convergenceCriteria criteria = {.absolute = 0., .relative = 1e-10};       /**< STEP_CG: convergence criteria */
+};
+
+
+
+/************************************************************************************************************************
+ *  @brief Steps du/dt = div(grad(u)) + f with an implicit theta-scheme, the spatial operator being Mesh::assemblePoisson.
+ *
+ *  @details
+ *  The assembly gives S L u = S f, L the 5-point -div(grad(.)) and S the diagonal row scaling of its Neumann/Robin rows
+ *  (halved per ghost point, to keep A = S L symmetric). With b = S f (boundary values lifted in), a step of the
+ *  theta-scheme reads
+ *      (S + theta dt A) u^{n+1} = S u^n - (1-theta) dt A u^n + dt b
+ *  whose matrix is symmetric positive-definite (even where A is singular). It is formed once, by scaling the values of
+ *  the assembled A by theta dt and adding S to its diagonal in place, without rebuilding any triplet. The preconditioner
+ *  (or the Cholesky factorisation) is then set up once for all steps. A step computes the right-hand side (one product
+ *  for Crank-Nicolson, none for backward Euler), and solves from the linear extrapolation 2u^n - u^{n-1} of the
+ *  previous steps, hence costs the Krylov iterations (or triangular solves) and nothing else: no assembly, no setup,
+ *  and with CG no allocation either.
+ *
+ *  The boundary values and f are constant in time. Since assemblePoisson removes the mean of b when A is singular
+ *  (Neumann/periodic everywhere), so does the driver: u then tends to the zero-source solution plus its initial mean.
+ *  Only the 5-point stencil is supported, the Mehrstellen stencil having a non-diagonal mass matrix.
+ *
+ *  * see Section 9.1 of "Numerical Solution of Partial Differential Equations" by Morton, Mayers 2005
+ ************************************************************************************************************************/
+class heatSolver{
+
+    public:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+
+        /**< Default construction assembles and shifts the operator, and sets up the solver of the steps, u starting at 0 */
+        heatSolver(const Mesh::gridStruct &grid,
+                   const Mesh::boundaryStruct &boundaries,
+                   const Mesh::sourceFunction &source,
+                   const heatSettings &settings = heatSettings{},
+                   const Parallel::executionPolicy* policy = nullptr);
+
+        /**< Disabled construction using another heat solver */
+        heatSolver(const heatSolver&) = delete;
+
+        /**< Disabled construction by equating to another heat solver */
+        heatSolver& operator =(const heatSolver&) = delete;
+
+        /**< Sets u (and the previous step, such that the next guess is u) from an initial condition u0(x,y) at time t0 */
+        void initial(const Mesh::sourceFunction &u0, f64 t0 = 0.);
+
+
+
+        /************************************************************************************************************************
+         *  @brief Advances u by one time step.
+         *
+         *  @return report of the solve of the step (a single iteration for the direct solver).
+         ************************************************************************************************************************/
+        KrylovSolver::solveReport step();
+
+        /************************************************************************************************************************
+         *  @brief Queues a snapshot of u (boundaries included, as field "u") on an exporter, which writes it in the background.
+         *
+         *  @param exporter reference to the exporter, which needs to outlive the export.
+         *  @param fileName name of the tiled file.
+         *
+         *  @return None
+         ************************************************************************************************************************/
+        void snapshot(IO::asyncExport &exporter, const std::string &fileName) const;
+
+        /**< Solution vector of the unknowns, numbered as in Mesh::dofRectangle */
+        const EigenDefs::Vector<f64>& solution() const { return u; }
+
+        /**< Time of the current solution */
+        f64 time() const { return t; }
+
+        /**< Number of steps taken */
+        u32 steps() const { return nSteps; }
+
+    private:
+        // ---------------- //
+        // member functions //
+        // ---------------- //
+        void shift();
+
+        // ---------------- //
+        // member variables //
+        // ---------------- //
+        Mesh::gridStruct grid;                                       /**< gridpoints */
+        Mesh::boundaryStruct boundaries;                             /**< boundary values */
+        heatSettings settings;                                       /**< time step, scheme and solver */
+        const Parallel::executionPolicy* policy;                     /**< threads of the products, nullptr: serial */
+        f64 theta;                                                   /**< implicitness of the scheme */
+        f64 t;                                                       /**< time of u */
+        u32 nSteps;                                                  /**< steps taken */
+
+        Eigen::SparseMatrix<f64> A;                                  /**< S + theta dt A, shifted in place */
+        bool symmetric;                                              /**< whether A is symmetric, as the threaded product needs */
+        EigenDefs::Vector<f64> mass;                                 /**< diagonal of S */
+        EigenDefs::Vector<f64> load;                                 /**< dt b */
+        EigenDefs::Vector<f64> u, previous, next, rhs;               /**< u^n, u^{n-1}, u^{n+1} and right-hand side */
+
+        std::unique_ptr<Workspace::arena> work;                      /**< STEP_CG: arena of the CG vectors */
+        std::unique_ptr<Preconditioner::preconditioner> M;           /**< STEP_CG: preconditioner, nullptr for none */
+        std::unique_ptr<KrylovSolver::CG> cg;                        /**< STEP_CG: solver */
+        std::unique_ptr< Eigen::SimplicialLDLT<Eigen::SparseMatrix<f64>> > cholesky; /**< STEP_CHOLESKY: factorisation */
+
+};
+
+} // namespace Transient
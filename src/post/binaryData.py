@@ -1,16 +1,55 @@
-import struct
+import zlib
 import numpy as np
 import numpy.typing as npt
 
-## @brief Reads output of main.cpp executable, a binary data file, and outputs 2d arrays.
+## @brief Reads every field of the output of main.cpp executable, a binary data file, as 2d arrays.
 #
 #  @details
 #  The binary file holds data in the form:
 #
-#  u32  u32    f32  f32  f32    f32  f32  f32    ...   f32  f32  f32
-#  jmax imax   x[0] y[0] u[0]   x[1] y[1] u[1]   ...   x[K] y[K] u[K],
+#  char[4] u32     u32  u32  u32       char[16]   ...  char[16]     f32[jmax*imax]  ...  f32[jmax*imax]
+#  "FDMP"  version jmax imax nFields   name[0]    ...  name[N-1]    field[0]        ...  field[N-1],
+#
+#  where every field is stored row by row, i.e. field[j,i]. The fields are x, y, u, and (when written) dudx, dudy,
+#  residual (f + lap(u)), curl (curl(grad(u))) and error (u - u_exact). Files of the older layout
+#
+#  u32  u32    f32  f32  f32    ...   f32  f32  f32
+#  jmax imax   x[0] y[0] u[0]   ...   x[K] y[K] u[K]
 #
-#  where K = (jmax-1)*(imax-1). Reshapes x,y,u to (jmax,imax)
+#  are read as well, holding x, y and u only. No copies are made beyond reading the file: the arrays are views.
+#  Tiled files (written by the asynchronous export, see readRegion) are read as a whole.
+#
+#  @param fileName Name of the binary file to read
+#
+#  @return fields dict of 2D numpy arrays of shape (jmax,imax), by field name
+def readFields(fileName: str) -> dict[str, npt.NDArray[np.float32]]:
+
+    # Tiled files are read tile by tile
+    with open(fileName, mode='rb') as file: # b is important -> binary
+        if file.read(4) == b"FDMT":
+            return readRegion(fileName)
+        file.seek(0)
+        fileContent = file.read()
+
+    ## ================ ##
+    ## Read Older Files ##
+    ## ================ ##
+    if fileContent[0:4] != b"FDMP":
+        jmax, imax = np.frombuffer(fileContent, dtype=np.uint32, count=2)
+        data = np.frombuffer(fileContent, dtype=np.float32, offset=8).reshape((jmax,imax,3))
+        return {"x": data[:,:,0], "y": data[:,:,1], "u": data[:,:,2]}
+
+    ## ========= ##
+    ## Read Data ##
+    ## ========= ##
+    version, jmax, imax, nFields = np.frombuffer(fileContent, dtype=np.uint32, count=4, offset=4)
+    assert version == 2, f"unsupported data file version {version}"
+    names = [fileContent[20+16*k:36+16*k].rstrip(b"\0").decode() for k in range(nFields)]
+    data  = np.frombuffer(fileContent, dtype=np.float32, offset=20+16*nFields).reshape((nFields,jmax,imax))
+
+    return {name: data[k] for k, name in enumerate(names)}
+
+## @brief Reads output of main.cpp executable, a binary data file, and outputs 2d arrays.
 #
 #  @param fileName Name of the binary file to read
 #
@@ -21,23 +60,95 @@ def read(fileName: str) -> tuple[npt.NDArray[np.float32],
                                  npt.NDArray[np.float32],
                                  npt.NDArray[np.float32]]:
 
-    # Open file
+    fields = readFields(fileName)
+    return fields["x"], fields["y"], fields["u"] # u[j,i], not u[i,j]
+
+# Index entry of a tiled file, see src/main/io/tiledFile.hpp
+_tileEntry = np.dtype([("field", "<u4"), ("tile", "<u4"), ("codec", "<u4"), ("padding", "<u4"),
+                       ("offset", "<u8"), ("bytes", "<u8"), ("base", "<f8"), ("step", "<f8")])
+
+## @brief Decodes one tile of a tiled file.
+#
+#  @param data  bytes of the tile
+#  @param entry index entry of the tile
+#  @param shape (rows, cols) of the tile
+#
+#  @return tile 2D numpy array of the tile values
+def _decodeTile(data: bytes, entry: np.void, shape: tuple[int, int]) -> npt.NDArray[np.float32]:
+
+    codec = int(entry["codec"])
+    if codec == 0: # raw f32
+        return np.frombuffer(data, dtype=np.float32).reshape(shape)
+
+    # Undo the deflate and the byte shuffle, byte k of value v was stored at k*n + v
+    n     = shape[0]*shape[1]
+    shuffled = np.frombuffer(zlib.decompress(data), dtype=np.uint8).reshape((4,n)).T.copy()
+    if codec == 1: # lossless f32
+        return shuffled.view(np.float32).reshape(shape)
+
+    # quantized: q is delta-coded (mod 2^32) row by row
+    q = np.cumsum(shuffled.view(np.uint32).ravel(), dtype=np.uint32)
+    return (entry["base"] + q*entry["step"]).astype(np.float32).reshape(shape)
+
+## @brief Reads (a sub-region of) the fields of a tiled file, only reading the tiles overlapping the region.
+#
+#  @details
+#  The tiled file holds a header (with the gridpoints x, y), every field cut in tiles, and an index telling where every
+#  tile starts (see src/main/io/tiledFile.hpp). Only the header, the index and the tiles overlapping [j0,j1)x[i0,i1)
+#  are read from disk.
+#
+#  @param fileName Name of the tiled file to read
+#  @param names    fields to read, default all of them
+#  @param rows     slice of gridpoints in y (j), default all of them
+#  @param cols     slice of gridpoints in x (i), default all of them
+#
+#  @return fields dict of 2D numpy arrays of the region, by field name, x and y included
+def readRegion(fileName: str,
+               names: list[str] = None,
+               rows : slice = slice(None),
+               cols : slice = slice(None)) -> dict[str, npt.NDArray[np.float32]]:
+
     with open(fileName, mode='rb') as file: # b is important -> binary
-        fileContent = file.read()
+        ## =========== ##
+        ## Read Header ##
+        ## =========== ##
+        header = file.read(40)
+        assert header[0:4] == b"FDMT", "not a tiled data file"
+        version, jmax, imax, nFields, tileRows, tileCols, codec = np.frombuffer(header, dtype=np.uint32, count=7, offset=4)
+        indexOffset = int(np.frombuffer(header, dtype=np.uint64, count=1, offset=32)[0])
+        assert version == 1, f"unsupported tiled file version {version}"
+        fieldNames = [file.read(16).rstrip(b"\0").decode() for k in range(nFields)]
+        x = np.frombuffer(file.read(8*int(imax)), dtype=np.float64)
+        y = np.frombuffer(file.read(8*int(jmax)), dtype=np.float64)
 
-    ## ========= ##
-    ## Read Data ##
-    ## ========= ##
-    # see link for more details on data types: https://docs.python.org/3/library/struct.html
-    # Read jmax, imax as u32
-    jmax = struct.unpack("I", fileContent[0:4])[0]
-    imax = struct.unpack("I", fileContent[4:8])[0]
-
-    # Read rest of data as f32, reshape it to the correct size.
-    data = list( struct.unpack('f'*((len(fileContent) - 8) // 4), fileContent[8:]) )
-    data = np.asarray(data, dtype=np.float32)
-    data = data.reshape((-1,3))
-
-    return  data[:,0].reshape((jmax,imax)), \
-            data[:,1].reshape((jmax,imax)), \
-            data[:,2].reshape((jmax,imax))  # (x,y,u)
+        file.seek(indexOffset)
+        nTileRows = (int(jmax) + tileRows-1)//tileRows
+        nTileCols = (int(imax) + tileCols-1)//tileCols
+        index = np.frombuffer(file.read(int(nFields)*nTileRows*nTileCols*_tileEntry.itemsize), dtype=_tileEntry)
+
+        ## ========== ##
+        ## Read Tiles ##
+        ## ========== ##
+        j0, j1, _ = rows.indices(int(jmax))
+        i0, i1, _ = cols.indices(int(imax))
+        X, Y = np.meshgrid(x[i0:i1], y[j0:j1])
+        fields = {"x": X.astype(np.float32), "y": Y.astype(np.float32)}
+        for f, name in enumerate(fieldNames):
+            if names is not None and name not in names:
+                continue
+            region = np.empty((j1-j0, i1-i0), dtype=np.float32)
+            for tr in range(j0//tileRows, (j1-1)//tileRows + 1):
+                for tc in range(i0//tileCols, (i1-1)//tileCols + 1):
+                    entry = index[f*nTileRows*nTileCols + tr*nTileCols + tc]
+                    tj0, tj1 = tr*tileRows, min((tr+1)*tileRows, int(jmax))
+                    ti0, ti1 = tc*tileCols, min((tc+1)*tileCols, int(imax))
+                    file.seek(int(entry["offset"]))
+                    tile = _decodeTile(file.read(int(entry["bytes"])), entry, (tj1-tj0, ti1-ti0))
+
+                    # Overlap of the tile with the region
+                    a0, a1 = max(tj0, j0), min(tj1, j1)
+                    b0, b1 = max(ti0, i0), min(ti1, i1)
+                    region[a0-j0:a1-j0, b0-i0:b1-i0] = tile[a0-tj0:a1-tj0, b0-ti0:b1-ti0]
+            fields[name] = region
+
+    return fields